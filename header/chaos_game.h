@@ -0,0 +1,115 @@
+#pragma once
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+#include "config.h"
+#include "thread_pool.h"
+
+struct ScreenInstance;
+
+// PCG32; each stream gets its own increment so the sequences never overlap
+struct ChaosRandom {
+    uint64_t state;
+    uint64_t increment;
+
+    ChaosRandom(uint64_t seed = 0, uint64_t stream = 0) : state(0x853c49e6748fea9bULL + seed), increment(2 * stream + 1) {}
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + increment;
+        uint32_t shifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        uint32_t rotation = static_cast<uint32_t>(old >> 59);
+        return (shifted >> rotation) | (shifted << ((0u - rotation) & 31));
+    }
+
+    // Uniform in [0, 1)
+    float unit() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+// A screen as the affine map that places the whole frame inside it, plus its color
+struct IfsMap {
+    float xx, xy, xOffset;
+    float yx, yy, yOffset;
+    float r, g, b, alpha;
+};
+
+namespace IfsMaps {
+    // Skips degenerate screens and returns running selection weights alongside the maps.
+    // Colors are taken with their ColorAnimation applied at colorTime seconds. That is a
+    // snapshot: the maps keep those colors until the next build, which FractalManager only
+    // runs when the scene revision changes, so animated colors do not move in between.
+    void build(const std::vector<ScreenInstance>& screens, int frameWidth, int frameHeight, float colorTime,
+        std::vector<IfsMap>& maps, std::vector<float>& cumulativeWeights);
+    size_t pick(const std::vector<float>& cumulativeWeights, float unit);
+}
+
+// Renders the scene's attractor with the random-iteration algorithm instead of feedback passes.
+// Each screen is the affine map that places the whole frame inside it, picked with a probability
+// proportional to its alpha and area. Every pool worker runs its own orbit and random stream
+// and buffers up to Config::CHAOS_BATCH_SAMPLES points, sorted into row bands; the bands are
+// then merged into the one shared histogram in parallel, so no two workers ever write the same
+// bin. resolve() tone-maps the log density. An orbit's color moves toward the color of each
+// screen it passes through by that screen's alpha, the same blend the feedback pass applies
+// per pixel.
+//
+// Memory is 32 bytes per frame pixel for the histogram (66 MB at 1080p, 265 MB at 4K) plus
+// 16 bytes per buffered point and stream, 16 MB with the defaults. Counts are 32-bit, which
+// Config::CHAOS_SAMPLE_LIMIT stays below, and color sums are doubles so they keep growing.
+class ChaosGame {
+public:
+    ChaosGame(int width, int height, ThreadPool& pool);
+
+    // Rebuilds the maps, with colors animated to colorTime, and clears the histograms
+    void setScreens(const std::vector<ScreenInstance>& screens, float colorTime);
+    // Runs about this many more points, split across the workers
+    void iterate(uint64_t samples);
+    // Merges the histograms into premultiplied RGBA8, top row first
+    void resolve(std::vector<Uint8>& rgba);
+    // resolve() straight into a texture of the frame's size
+    void upload(GLuint texture);
+
+    uint64_t getSampleCount() const { return sampleCount; }
+
+private:
+    struct Bin {
+        double r, g, b;
+        uint32_t count;
+    };
+
+    // A plotted point: its pixel and the orbit color, 10 bits per channel
+    struct Sample {
+        uint32_t pixel;
+        uint32_t color;
+    };
+
+    struct Stream {
+        ChaosRandom random;
+        float x, y;
+        float r, g, b;
+        int warmup;
+        // This round's points, then the same grouped by band, band i at [bandStarts[i], bandStarts[i + 1])
+        std::vector<Sample> samples;
+        std::vector<Sample> sorted;
+        std::vector<uint32_t> bandStarts;
+    };
+
+    void restart(Stream& stream);
+    void run(Stream& stream, uint64_t samples);
+    void merge(size_t band);
+
+    int width, height;
+    ThreadPool& pool;
+    std::vector<IfsMap> maps;
+    std::vector<float> cumulativeWeights;
+    std::vector<Stream> streams;
+    std::vector<Bin> bins;
+    // Bands are 1 << bandShift pixels; the last one may be shorter
+    int bandShift;
+    size_t bandCount;
+    std::vector<uint32_t> rowMaxima;
+    std::vector<Uint8> pixels;
+    uint64_t sampleCount;
+};
@@ -2,9 +2,40 @@
 #include <SDL2/SDL.h>
 
 namespace Config {
+    enum class PacingMode { VSync, AdaptiveVSync, Limited, Uncapped };
+    enum class AccumulationFormat { RGBA8, RGBA16F, R11G11B10F, RGBA32F };
+    enum class ToneMap { Clamp, Reinhard, ACES };
+    enum class CompositorBackend { Gpu, Cpu };
+    enum class RenderEngine { Feedback, ChaosGame };
+
     constexpr int SCREEN_WIDTH = 1600;
     constexpr int SCREEN_HEIGHT = 950;
     constexpr int FPS = 140;
+    // Frame pacing, cycled with F4. Limited targets FPS with a sleep-then-spin wait
+    constexpr PacingMode PACING_MODE = PacingMode::Limited;
+    constexpr float PACING_SPIN_MS = 1.5f;
+    constexpr float MAX_FRAME_DELTA = 0.1f;
+    // Rendering runs on its own thread, which owns the GL context, while input is handled and
+    // the scene edited INPUT_RATE times per second on the main thread. Replays use one thread.
+    constexpr bool RENDER_THREAD = true;
+    constexpr int INPUT_RATE = 250;
+    // GPU time per presented frame spent on extra feedback iterations
+    constexpr float ITERATION_TIME_BUDGET_MS = 0.5f * 1000.0f / FPS;
+    constexpr int MAX_ITERATIONS_PER_FRAME = 16;
+    // Dynamic internal resolution of the GPU feedback loop. While one iteration takes longer
+    // than RESOLUTION_TARGET_MS the loop renders at a lower scale of the output, in
+    // RESOLUTION_SCALE_STEP steps down to MIN_RESOLUTION_SCALE, and the present pass upscales
+    // it bicubically. It climbs a step once that is predicted to fit RESOLUTION_HEADROOM of the
+    // target, and a scene that converges at a lower scale is refined at full resolution.
+    constexpr bool DYNAMIC_RESOLUTION = true;
+    constexpr float RESOLUTION_TARGET_MS = 0.75f * 1000.0f / FPS;
+    constexpr float MIN_RESOLUTION_SCALE = 0.5f;
+    constexpr float RESOLUTION_SCALE_STEP = 0.125f;
+    constexpr float RESOLUTION_HEADROOM = 0.8f;
+    // Frames to wait after a change before measuring again, and the feedback textures kept
+    // after one so switching back doesn't reallocate
+    constexpr int RESOLUTION_SETTLE_FRAMES = 8;
+    constexpr int RESOLUTION_POOL_TEXTURES = 4;
 
     constexpr SDL_Color DEFAULT_SCREEN_COLOR = { 66, 135, 245, 15 };
     constexpr float INITIAL_SCREEN_SIZE_RATIO = 0.25f;
@@ -16,13 +47,39 @@ namespace Config {
     constexpr float SCALE_FACTOR_DOWN = 0.92f;
     constexpr int MIN_SCREEN_SIZE = 0;
     constexpr float MAX_SCREEN_RATIO = 0.99f;
-    constexpr float ROTATION_SPEED = 0.8f;
-    constexpr float COLOR_ROTATION_SPEED = 0.002f;
-    constexpr float SATURATION_CYCLE_SPEED = 0.004f;
-    constexpr float ALPHA_CHANGE_SPEED = 0.01f;
+    // Held-key speeds, per second
+    constexpr float ROTATION_SPEED = 112.0f;
+    constexpr float COLOR_ROTATION_SPEED = 0.28f;
+    constexpr float SATURATION_CYCLE_SPEED = 0.56f;
+    constexpr float ALPHA_CHANGE_SPEED = 140.0f;
+    // Color animation toggled on the selected screen: H cycles the hue at this many cycles per
+    // second, J swings the saturation by up to the range (at most 0.5) at this many per second
+    constexpr float HUE_CYCLE_RATE = 0.1f;
+    constexpr float SATURATION_PULSE_RATE = 0.5f;
+    constexpr float SATURATION_PULSE_RANGE = 0.3f;
     constexpr Uint8 MAX_SCREEN_ALPHA = 70;
+    // Cell size in pixels of the grid used to find the screen under the cursor
+    constexpr int HIT_GRID_CELL_SIZE = 64;
+    // Keyframe animation (--animation, P to pause): tracks evaluated per block and thread, and
+    // the pool size, 0 for every hardware thread
+    constexpr int ANIMATION_BLOCK_TRACKS = 512;
+    constexpr int ANIMATION_THREADS = 0;
 
+    // Frame capture (F5) and reload of the last captured frame (F6)
     constexpr const char* FRAME_SAVE_DIR = "frames";
+    constexpr const char* FRAME_SAVE_EXTENSION = ".png";
+    constexpr int FRAME_READBACK_BUFFERS = 3;
+    constexpr int FRAME_WRITER_THREADS = 4;
+    constexpr int FRAME_WRITER_QUEUE = 16;
+    // Y4M recording (F7); "-" streams to stdout for piping into an encoder
+    constexpr const char* RECORDING_PATH = "fractus.y4m";
+    constexpr int RECORDING_QUEUE = 8;
+
+    // Scene saved with F10 and loaded with F11; .fsb is binary, any other extension text
+    constexpr const char* SCENE_PATH = "scene.fsb";
+
+    constexpr const char* SHADER_CACHE_DIR = "shader_cache";
+    constexpr bool USE_SHADER_CACHE = true;
     constexpr bool DEV_TOOLS = true;
 
     constexpr double PI = 3.14159265358979323846;
@@ -32,5 +89,51 @@ namespace Config {
     constexpr int MAX_CACHED_SURFACES = 20;
     constexpr bool USE_HARDWARE_ACCEL = true;
 
+    // Performance HUD, toggled with F3
     constexpr bool SHOW_FPS = true;
+    constexpr int HUD_SCALE = 2;
+    constexpr int HUD_REFRESH_FRAMES = 30;
+
+    // Feedback texture format. Float formats keep low-alpha detail that RGBA8 rounds away;
+    // R11G11B10F has no alpha channel, so coverage reads as 1 and the image presents brighter
+    constexpr AccumulationFormat ACCUMULATION_FORMAT = AccumulationFormat::RGBA8;
+    // Gpu composites with OpenGL; Cpu runs the same feedback pass on all cores and only
+    // uploads the result, for hosts where GL is a slow software rasterizer
+    constexpr CompositorBackend COMPOSITOR_BACKEND = CompositorBackend::Gpu;
+    constexpr int CPU_COMPOSITOR_THREADS = 0;
+    constexpr int CPU_TILE_SIZE = 64;
+    // Chaos-game engine, toggled with F9. Points per presented frame, orbit steps skipped
+    // before plotting, and the point count after which the image is treated as converged.
+    // Animated screen colors are frozen at their value when the scene last changed.
+    constexpr RenderEngine RENDER_ENGINE = RenderEngine::Feedback;
+    constexpr int CHAOS_SAMPLES_PER_FRAME = 4000000;
+    constexpr int CHAOS_WARMUP_ITERATIONS = 100;
+    constexpr unsigned long long CHAOS_SAMPLE_LIMIT = 2000000000ULL;
+    // Parallel orbits, and the points each one buffers (8 bytes apiece, twice over) before
+    // they are merged into the shared histogram
+    constexpr int CHAOS_MAX_STREAMS = 16;
+    constexpr int CHAOS_BATCH_SAMPLES = 65536;
+    constexpr float CHAOS_GAMMA = 2.2f;
+    // Poster export. Histogram memory per band, plotted points per pixel, and how deep the
+    // per-band map compositions go: until their image is this fraction of the band's height
+    constexpr int POSTER_MEMORY_MB = 512;
+    constexpr float POSTER_SAMPLES_PER_PIXEL = 32.0f;
+    constexpr float POSTER_WORD_EXTENT = 0.25f;
+    constexpr int POSTER_MAX_WORDS = 65536;
+    constexpr int POSTER_BOUNDS_SAMPLES = 1 << 20;
+    // The peak-density pass samples at this fraction of the final density
+    constexpr float POSTER_PEAK_SAMPLE_RATIO = 0.25f;
+    constexpr float POSTER_PEAK_PASS_SHARE = POSTER_PEAK_SAMPLE_RATIO / (1.0f + POSTER_PEAK_SAMPLE_RATIO);
+    // Present pass; exposure is adjusted with [ and ], the tone map cycled with F8
+    constexpr ToneMap TONE_MAP = ToneMap::Clamp;
+    constexpr float EXPOSURE = 1.0f;
+    constexpr float EXPOSURE_SPEED = 1.0f;
+
+    // Sample the previous frame from a mip chain so shrunken screens read a matching level
+    constexpr bool USE_MIPMAPPED_SAMPLING = true;
+
+    // Stop compositing once frames stop changing by more than one 8-bit step
+    constexpr bool DETECT_CONVERGENCE = true;
+    constexpr float CONVERGENCE_THRESHOLD = 1.0f / 255.0f;
+    constexpr int CONVERGENCE_FRAMES = 2;
 }
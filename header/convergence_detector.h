@@ -0,0 +1,44 @@
+#pragma once
+#include <GL/glew.h>
+#include <memory>
+#include <vector>
+#include "shader_manager.h"
+
+// Measures the largest per-channel change between two consecutive feedback frames
+// with a max-reduction on the GPU. Results are read back through a ring of pixel
+// buffers a few frames later, so the render loop never waits on them.
+class ConvergenceDetector {
+public:
+    ConvergenceDetector(int width, int height);
+    ~ConvergenceDetector();
+
+    void submit(GLuint newerFrame, GLuint olderFrame, GLuint quadVao, unsigned int sceneRevision);
+    // True once enough consecutive measurements of this revision were below the threshold
+    bool isConverged(unsigned int sceneRevision);
+    // Forget every measurement, including ones still in flight, after the frame was replaced
+    void reset();
+    float getLastDelta() const { return lastDelta; }
+
+private:
+    struct Readback {
+        GLuint pbo;
+        GLsync fence;
+        unsigned int revision;
+    };
+
+    void collect();
+
+    std::unique_ptr<ShaderProgram> diffShader;
+    std::unique_ptr<ShaderProgram> reduceShader;
+    GLint diffNewerLoc, diffOlderLoc, reduceSourceLoc;
+
+    GLuint fbo;
+    std::vector<GLuint> levels;
+    std::vector<int> levelWidths, levelHeights;
+    std::vector<Readback> readbacks;
+    size_t nextReadback;
+
+    unsigned int trackedRevision;
+    int stableCount;
+    float lastDelta;
+};
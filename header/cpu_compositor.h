@@ -0,0 +1,29 @@
+#pragma once
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <memory>
+#include <vector>
+#include "config.h"
+#include "thread_pool.h"
+
+struct ScreenInstance;
+
+// Software version of FractalManager's feedback pass for hosts without a usable GPU.
+// Each destination tile inverse-maps its pixels through the screens overlapping it,
+// samples the previous frame the way the GPU does (bilinear, trilinear from a box-filtered
+// mip chain when USE_MIPMAPPED_SAMPLING is on) and applies the same premultiplied "over"
+// blend. RGBA8 frames are requantized after every blend like an 8-bit render target;
+// every other format accumulates in RGBA32F.
+class CpuCompositor {
+public:
+    static std::unique_ptr<CpuCompositor> create(int width, int height, Config::AccumulationFormat format, ThreadPool& pool);
+    virtual ~CpuCompositor() = default;
+
+    // Runs one feedback pass and returns the largest channel change it made
+    virtual float composite(const std::vector<ScreenInstance>& screens) = 0;
+    // Copies the latest frame into a texture allocated with getStorageFormat()
+    virtual void upload(GLuint texture) const = 0;
+    // Replaces the latest frame with RGBA8 pixels, top row first
+    virtual void load(const Uint8* rgba) = 0;
+    virtual Config::AccumulationFormat getStorageFormat() const = 0;
+};
@@ -3,29 +3,144 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <vector>
+#include <memory>
 #include <unordered_map>
 #include "screen.h"
+#include "screen_instance.h"
+#include "screen_store.h"
+#include "convergence_detector.h"
+#include "frame_readback.h"
+#include "frame_writer.h"
+#include "video_recorder.h"
+#include "cpu_compositor.h"
+#include "chaos_game.h"
+#include "thread_pool.h"
+#include "shader_manager.h"
 #include "config.h"
 
+namespace AccumulationFormats {
+    GLenum internalFormat(Config::AccumulationFormat format);
+    size_t bytesPerPixel(Config::AccumulationFormat format);
+    const char* name(Config::AccumulationFormat format);
+}
+
 class FractalManager {
 public:
-    FractalManager(int width, int height, GLuint textureShader, GLuint colorShader, const glm::mat4& projection);
+    FractalManager(int width, int height, const glm::mat4& projection,
+        Config::AccumulationFormat format = Config::ACCUMULATION_FORMAT,
+        Config::CompositorBackend backend = Config::COMPOSITOR_BACKEND);
     ~FractalManager();
 
-    GLuint processFrame(const std::vector<Screen>& screens, int frameCounter);
+    // When sceneRevision changes only the store's dirty range is copied to the instance buffer
+    GLuint processFrame(const ScreenStore& screens, unsigned int sceneRevision, int frameCounter);
+    // Same from a copy of the records, e.g. a SceneSnapshot; changed says which of them
+    // differ from the last call's
+    GLuint processFrame(const ScreenInstance* data, size_t count, ScreenStore::Range changed,
+        unsigned int sceneRevision, int frameCounter);
+    // Uploads ready-made instance records (e.g. a MappedScene) for sceneRevision, so
+    // processFrame with that revision skips rebuilding them from the store
+    void setInstances(const ScreenInstance* data, size_t count, unsigned int sceneRevision);
+    // True while the feedback loop sits at its fixed point and processFrame skips compositing
+    bool isIdle() const { return idle; }
+
+    // processFrame runs as many feedback iterations as fit in Config::ITERATION_TIME_BUDGET_MS,
+    // measured with GPU timestamps. Disabled, it runs exactly one iteration per call.
+    void setAdaptiveIterations(bool enabled);
+    int getIterationsPerFrame() const { return iterationsPerFrame; }
+    float getIterationTimeMs() const { return iterationTimeMs; }
+
+    // Lets the GPU feedback loop run below the output resolution to hold
+    // Config::RESOLUTION_TARGET_MS per iteration (see Config::DYNAMIC_RESOLUTION). Frames read
+    // back or saved are still at the output size. Off by default, so renders are repeatable.
+    void setDynamicResolution(bool enabled);
+    float getResolutionScale() const { return resolutionScale; }
+
+    // Approximate GPU memory held by the feedback textures, pooled ones included, and their mip chains
+    size_t getTextureMemoryBytes() const;
+    Config::AccumulationFormat getAccumulationFormat() const { return format; }
+    Config::CompositorBackend getBackend() const { return cpuCompositor ? Config::CompositorBackend::Cpu : Config::CompositorBackend::Gpu; }
+
+    // The chaos-game engine replaces the feedback passes; switching restarts its sampling
+    void setEngine(Config::RenderEngine value);
+    Config::RenderEngine getEngine() const { return engine; }
+    uint64_t getChaosSampleCount() const { return chaosGame ? chaosGame->getSampleCount() : 0; }
+
+    void setExposure(float value) { exposure = value; }
+    float getExposure() const { return exposure; }
+    void setToneMap(Config::ToneMap value) { toneMap = value; }
+    Config::ToneMap getToneMap() const { return toneMap; }
+
     void renderCurrentFrame();
+    // Blocking readback of the latest frame as RGBA8, top row first
+    void readFrame(std::vector<Uint8>& pixels);
+    // Same, after the present pass: what renderCurrentFrame shows on screen
+    void readPresentedFrame(std::vector<Uint8>& pixels);
+    // Replaces the feedback state with a frame from FRAME_SAVE_DIR and returns previousTexture
     GLuint loadPreviousFrame(int frameNum);
+    // Queues an asynchronous readback; the file is written by a background thread
     void saveFrame(GLuint texture, int frameNum);
-    
+    // Blocks until every saved frame is on disk
+    void flushSavedFrames();
+    size_t getDroppedFrames() const { return frameWriter ? frameWriter->getDroppedFrames() : 0; }
+
+    // Every frame returned by processFrame is appended to the recording, idle frames included
+    void startRecording(const std::string& path, int fps, bool dropWhenBehind);
+    void stopRecording();
+    const VideoRecorder* getRecorder() const { return recorder.get(); }
+
 
 private:
+    struct IterationTimer {
+        GLuint startQuery, endQuery;
+        int iterations;
+        // Measurements taken at another resolution are dropped
+        float scale;
+        bool pending;
+    };
+
+    struct PooledTexture {
+        GLuint texture;
+        int width, height;
+    };
+
     GLuint createTexture(int w, int h);
+    GLuint acquireTexture(int w, int h);
+    void releaseTexture(GLuint texture, int w, int h);
+    void blitFrame(GLuint source, int sourceWidth, int sourceHeight, GLuint target, int targetWidth, int targetHeight);
+    // Resizes the feedback textures, carrying the current frame over
+    void setRenderScale(float scale);
+    void adaptResolution(unsigned int sceneRevision);
+    // The latest frame at the output size, upscaled into a scratch texture if need be
+    GLuint fullSizeFrame();
+    // Adds (sign 1) or removes (-1) instances [range) from the color animation counts
+    void countColorAnimations(ScreenStore::Range range, int sign);
+    // Around a write of instances [range) that also resizes them to count: the first drops what
+    // changes from the counts and returns how many records the resize kept, the second adds it back
+    uint32_t beginInstanceUpdate(size_t count, ScreenStore::Range range);
+    void endInstanceUpdate(ScreenStore::Range range, uint32_t kept);
+    void uploadInstances(const ScreenStore& screens, ScreenStore::Range range);
+    void uploadInstanceBuffer(ScreenStore::Range range);
+    void compositePass();
+    GLuint renderFrame(unsigned int sceneRevision);
+    void collectIterationTimings();
+    void recordIterationTime(float iterationMs);
+    void adaptIterations();
+    GLuint processFrameCpu(unsigned int sceneRevision);
+    GLuint processFrameChaos(unsigned int sceneRevision);
+    static std::string framePath(int frameNum);
+    void drawPresentPass(const glm::mat4& targetProjection);
+    GLuint presentToTexture();
 
     int width, height;
-    GLuint textureShaderProgram;
-    GLuint colorShaderProgram;
+    Config::AccumulationFormat format;
+    std::unique_ptr<ShaderProgram> presentShader;
+    std::unique_ptr<ShaderProgram> compositeShader;
     glm::mat4 projection;
 
+    // Uniform locations resolved once at construction
+    GLint presentProjectionLoc, presentModelLoc, presentFrameLoc, presentExposureLoc, presentToneMapLoc, presentUpscaleLoc;
+    GLint compositeProjectionLoc, compositeFrameSizeLoc, compositePreviousFrameLoc, compositeColorTimeLoc;
+
     // Simplified texture management - ping-pong between two textures
     GLuint currentTexture;
     GLuint previousTexture;
@@ -33,10 +148,76 @@ private:
     // OpenGL objects
     GLuint fbo;
     GLuint vao, vbo;
+
+    // Internal resolution of the feedback textures. While refining, a scene that converged at a
+    // lower scale runs at full resolution until its revision changes, then interactiveScale returns.
+    int renderWidth, renderHeight;
+    float resolutionScale;
+    bool dynamicResolution;
+    bool refining;
+    float interactiveScale;
+    unsigned int refiningRevision;
+    int resolutionCooldown;
+    std::vector<PooledTexture> texturePool;
+    GLuint blitFbo;
+    GLuint fullSizeTexture;
+
+    float exposure;
+    Config::ToneMap toneMap;
+    // RGBA8 copy of the presented frame, created when first needed (recording, readPresentedFrame)
+    GLuint displayFbo, displayTexture;
+
+    // Instanced compositing
+    GLuint compositeVao, instanceVbo;
+    std::vector<ScreenInstance> instances;
+    size_t instanceCapacity;
+    size_t instanceCount;
+    unsigned int uploadedRevision;
+    bool instancesUploaded;
+    // Screens whose ColorAnimation changes over time, while any exist the loop never idles, and
+    // screens with any ColorAnimation at all. The shader evaluates them at colorTime, which is
+    // frameCounter / FPS seconds.
+    size_t animatedInstanceCount;
+    size_t shiftedInstanceCount;
+    float colorTime;
+
+    std::unique_ptr<ConvergenceDetector> convergence;
+    bool idle;
+
+    // Adaptive iterations per presented frame
+    bool adaptiveIterations;
+    int iterationsPerFrame;
+    float iterationTimeMs;
+    std::vector<IterationTimer> iterationTimers;
+    size_t nextIterationTimer;
+
+    // Software backend; the GL textures then only receive its result for presenting
+    std::unique_ptr<ThreadPool> threadPool;
+    std::unique_ptr<CpuCompositor> cpuCompositor;
+    // instances with their colors animated to colorTime
+    std::vector<ScreenInstance> animatedInstances;
+    unsigned int cpuRevision;
+    int cpuStableFrames;
+
+    // Created on the first chaos-game frame, sharing threadPool with the software backend
+    Config::RenderEngine engine;
+    std::unique_ptr<ChaosGame> chaosGame;
+    unsigned int chaosRevision;
+
+    // Created on the first saveFrame
+    std::unique_ptr<FrameReadback> frameReadback;
+    std::unique_ptr<FrameWriter> frameWriter;
+    std::unique_ptr<VideoRecorder> recorder;
 };
 
 namespace OtherRenders {
-    void drawSelectionOutline(Screen* selectedScreen, bool scalingMode, int tempWidth, int tempHeight, GLuint colorShaderProgram, const glm::mat4& projection, GLuint vao);
+    // Color shader uniform locations, resolved once with resolveOutlineUniforms
+    struct OutlineUniforms {
+        GLint model, projection, color;
+    };
+
+    OutlineUniforms resolveOutlineUniforms(const ShaderProgram& colorShader);
+    void drawSelectionOutline(const Screen* selectedScreen, bool scalingMode, int tempWidth, int tempHeight, const ShaderProgram& colorShader, const OutlineUniforms& uniforms, const glm::mat4& projection, GLuint vao);
     void initGL(int width, int height, GLuint& vao, GLuint& vbo);
     void cleanupGL(GLuint& vao, GLuint& vbo);
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include "config.h"
+
+// Owns the swap interval and the frame deadline. VSync modes let the driver block in
+// SDL_GL_SwapWindow; Limited sleeps most of the remaining frame and spins the last
+// PACING_SPIN_MS so wakeup jitter from the OS scheduler doesn't land on the deadline.
+class FramePacer {
+public:
+    FramePacer(Config::PacingMode mode, int targetFps);
+
+    // Call at the top of each frame; returns seconds since the previous call
+    float beginFrame();
+    // Call after the swap; waits out the rest of the frame in Limited mode
+    void endFrame();
+
+    void setMode(Config::PacingMode mode);
+    void cycleMode();
+    Config::PacingMode getMode() const { return mode; }
+    const char* getModeName() const;
+    float getDeltaSeconds() const { return deltaSeconds; }
+
+private:
+    Config::PacingMode mode;
+    Uint64 frequency;
+    Uint64 framePeriod;
+    Uint64 lastFrameStart;
+    Uint64 nextDeadline;
+    float deltaSeconds;
+};
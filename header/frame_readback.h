@@ -0,0 +1,46 @@
+#pragma once
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <functional>
+#include <vector>
+
+// Reads RGBA8 textures back through a ring of pixel pack buffers. submit() only queues
+// a glReadPixels into the next buffer and fences it; the pixels are delivered from
+// collect() once the GPU has finished, normally a frame or two later. Rows arrive in
+// texture order, which is top row first for frames produced by FractalManager.
+class FrameReadback {
+public:
+    using Callback = std::function<void(const Uint8* pixels, long long tag)>;
+
+    FrameReadback(int width, int height, size_t ringSize, Callback onReady);
+    ~FrameReadback();
+
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    // Waits for the oldest readback only if every buffer is still in flight
+    void submit(GLuint texture, long long tag);
+    // Delivers every finished readback, oldest first, without blocking
+    void collect();
+    // Blocks until all pending readbacks have been delivered
+    void flush();
+
+    bool hasPending() const;
+    size_t getFrameBytes() const { return frameBytes; }
+
+private:
+    struct Slot {
+        GLuint pbo;
+        GLsync fence;
+        long long tag;
+    };
+
+    bool deliver(Slot& slot, GLuint64 timeout);
+
+    int width, height;
+    size_t frameBytes;
+    GLuint fbo;
+    std::vector<Slot> slots;
+    size_t nextSlot;
+    Callback onReady;
+};
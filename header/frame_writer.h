@@ -0,0 +1,54 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Encodes captured frames with ImageIO on background threads. Pixel buffers are
+// recycled, so steady-state capture doesn't allocate. When encoding falls behind and
+// the queue is full, new frames are dropped and counted instead of blocking the caller.
+class FrameWriter {
+public:
+    FrameWriter(int threadCount, size_t maxQueued);
+    // Finishes every queued frame before returning
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // Returns false if the frame was dropped
+    bool enqueue(const std::string& path, int width, int height, const Uint8* rgba);
+    // Blocks until the queue is empty and no frame is being written
+    void wait();
+
+    size_t getWrittenFrames() const { return writtenFrames; }
+    size_t getDroppedFrames() const { return droppedFrames; }
+    size_t getFailedFrames() const { return failedFrames; }
+
+private:
+    struct Job {
+        std::string path;
+        int width, height;
+        std::vector<Uint8> pixels;
+    };
+
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<Job> queue;
+    std::vector<std::vector<Uint8>> freeBuffers;
+    size_t maxQueued;
+    int busyWorkers;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+
+    std::atomic<size_t> writtenFrames;
+    std::atomic<size_t> droppedFrames;
+    std::atomic<size_t> failedFrames;
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include <EGL/egl.h>
+
+// OpenGL 3.3 core context without a window or display server, made current on
+// construction. Rendering goes to framebuffer objects only.
+class HeadlessContext {
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+private:
+    EGLDisplay display;
+    EGLContext context;
+};
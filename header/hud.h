@@ -0,0 +1,35 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "shader_manager.h"
+
+// Text overlay drawn with a built-in 5x7 bitmap font. The vertex buffer is only
+// rebuilt when setLines changes the text, so drawing it is a single draw call.
+class Hud {
+public:
+    Hud(int width, int height);
+    ~Hud();
+
+    Hud(const Hud&) = delete;
+    Hud& operator=(const Hud&) = delete;
+
+    void setLines(const std::vector<std::string>& lines);
+    void draw();
+
+private:
+    void appendQuad(float x, float y, float w, float h, int cell);
+
+    std::unique_ptr<ShaderProgram> shader;
+    GLint projectionLoc, fontLoc, colorLoc;
+    glm::mat4 projection;
+
+    GLuint fontTexture;
+    GLuint vao, vbo;
+    std::vector<float> vertices;
+    size_t vertexCapacity;
+    GLsizei vertexCount;
+    std::vector<std::string> currentLines;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <zlib.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "thread_pool.h"
+
+// Pixels are tightly packed RGBA8 rows, top row first.
+namespace ImageIO {
+    void writePNG(const std::string& path, int width, int height, const Uint8* rgba);
+    void writePAM(const std::string& path, int width, int height, const Uint8* rgba);
+    // Chooses the format from the extension (.png or .pam)
+    void writeImage(const std::string& path, int width, int height, const Uint8* rgba);
+
+    // Readers accept 8-bit RGB or RGBA (non-interlaced for PNG) and always return RGBA
+    void readPNG(const std::string& path, int& width, int& height, std::vector<Uint8>& rgba);
+    void readPAM(const std::string& path, int& width, int& height, std::vector<Uint8>& rgba);
+    void readImage(const std::string& path, int& width, int& height, std::vector<Uint8>& rgba);
+}
+
+// Streams an RGBA8 PNG row by row so the whole image never has to be in memory.
+// Given a pool, every writeRows call is cut into blocks that are deflated in parallel as
+// byte-aligned pieces of one zlib stream, the way pigz does it.
+class PngWriter {
+public:
+    PngWriter(const std::string& path, int width, int height, ThreadPool* pool = nullptr);
+    ~PngWriter();
+
+    PngWriter(const PngWriter&) = delete;
+    PngWriter& operator=(const PngWriter&) = delete;
+
+    void writeRows(const Uint8* rgba, int rows);
+    void finish();
+
+private:
+    void writeChunk(const char* type, const Uint8* data, size_t size);
+    void flushDeflate(int flush);
+    void writeRowsParallel(const Uint8* rgba, int rows);
+
+    FILE* file;
+    ThreadPool* pool;
+    int width, height;
+    int rowsWritten;
+    bool finished;
+    z_stream stream;
+    std::vector<Uint8> rowBuffer;
+    std::vector<Uint8> outBuffer;
+    // Parallel mode: checksum of everything deflated so far and one output per block
+    uLong adler;
+    std::vector<std::vector<Uint8>> blocks;
+    std::vector<uLong> blockAdlers;
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "screen_instance.h"
+
+// Everything InputManager reads from the user in one frame. Live frames are captured from
+// SDL; replayed frames are decoded from an input log, and the handlers cannot tell apart.
+struct InputFrame {
+    float deltaSeconds = 0.0f;
+    int mouseX = 0, mouseY = 0;
+    Uint32 mouseButtons = 0;
+    // One bit per InputLog::TRACKED_KEYS entry
+    uint16_t keys = 0;
+    std::vector<SDL_Event> events;
+
+    bool isKeyDown(SDL_Scancode scancode) const;
+};
+
+// Input logs: a header with the resolution and the initial scene as ScreenInstance records,
+// then one fixed-size record per frame followed by that frame's events. Only the event types
+// InputManager handles are kept, so an idle frame costs 16 bytes.
+namespace InputLog {
+    // Keys the per-frame handlers poll rather than receive as events
+    constexpr SDL_Scancode TRACKED_KEYS[] = {
+        SDL_SCANCODE_ESCAPE, SDL_SCANCODE_LEFTBRACKET, SDL_SCANCODE_RIGHTBRACKET,
+        SDL_SCANCODE_A, SDL_SCANCODE_D, SDL_SCANCODE_W, SDL_SCANCODE_S,
+        SDL_SCANCODE_UP, SDL_SCANCODE_DOWN
+    };
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        int32_t width;
+        int32_t height;
+        uint32_t screenCount;
+    };
+    static_assert(sizeof(FileHeader) == 24, "Input log header layout");
+
+    struct FrameRecord {
+        float deltaSeconds;
+        int16_t mouseX, mouseY;
+        uint16_t keys;
+        uint16_t eventCount;
+        uint8_t mouseButtons;
+        uint8_t reserved[3];
+    };
+    static_assert(sizeof(FrameRecord) == 16, "Input log frame layout");
+
+    enum class EventKind : uint8_t { Quit, MouseButtonDown, MouseWheel, KeyDown, KeyUp, MouseMotion };
+
+    struct EventRecord {
+        EventKind kind;
+        uint8_t button;
+        uint16_t reserved;
+        int32_t a, b;
+    };
+    static_assert(sizeof(EventRecord) == 12, "Input log event layout");
+
+    // Drains SDL's queue and samples the mouse and tracked keys after it
+    InputFrame capture(float deltaSeconds);
+}
+
+class InputRecorder {
+public:
+    InputRecorder(const std::string& path, int width, int height, const std::vector<ScreenInstance>& scene);
+
+    void write(const InputFrame& frame);
+
+private:
+    std::ofstream file;
+    std::vector<InputLog::EventRecord> events;
+};
+
+class InputReplay {
+public:
+    explicit InputReplay(const std::string& path);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const std::vector<ScreenInstance>& getScene() const { return scene; }
+
+    // Fills the next recorded frame; false once the log is exhausted
+    bool next(InputFrame& frame);
+
+private:
+    std::vector<char> data;
+    size_t cursor;
+    int width, height;
+    std::vector<ScreenInstance> scene;
+};
@@ -6,6 +6,7 @@
 #include <cmath>
 #include <vector>
 #include <memory>
+#include <string>
 #include <stdexcept>
 #include <algorithm>
 #include "config.h" 
@@ -14,45 +15,103 @@
 #include "fractal_manager.h"
 #include "math_utils.h"
 #include "shader_manager.h"
+#include "profiler.h"
+#include "hud.h"
+#include "frame_pacer.h"
+#include "input_log.h"
+#include "screen_animator.h"
+#include "scene_snapshot.h"
+#include <atomic>
+#include <exception>
+#include <thread>
 #include <iostream>
 #include <ctime>
 #include <fstream>
 
+// Input and rendering run on separate threads. run() handles events and edits the scene on
+// the calling thread, then publishes a SceneSnapshot; the render thread owns the GL context
+// and draws whatever snapshot is newest, so a slow frame never holds up dragging and a
+// burst of input never holds up a frame. Replays run both on one thread in lockstep.
 class InputManager {
 public:
-    InputManager();
+    // With a replay path the window takes the log's resolution and scene, and run() plays the
+    // recorded input back as fast as it renders, then prints the frame times
+    explicit InputManager(const std::string& replayPath = "");
     ~InputManager();
     void run();
+    // Logs every following frame's input, starting from the current scene
+    void recordInput(const std::string& path);
+    // Replaces the scene with a text or binary (.fsb) scene file
+    void loadScene(const std::string& path);
+    void saveScene(const std::string& path) const;
+    // Keyframe tracks for the current scene (see ScreenAnimator::load), played from time 0
+    void loadAnimation(const std::string& path);
 
 private:
     SDL_Window* window;
     SDL_GLContext glContext;
     int width, height;
-    std::unique_ptr<FractalManager> fractalManager;
-    std::unique_ptr<ScreenManager> screenManager;
-    GLuint textureShaderProgram, colorShaderProgram;
-    GLuint vao, vbo;
-    glm::mat4 projection;
 
-    int frameCounter;
+    // Input thread
+    std::unique_ptr<ScreenManager> screenManager;
     bool scalingMode;
     SDL_FPoint scaleStartPos;
     SDL_FPoint originalDimensions;
-    GLuint frozenFrame;
-    GLuint currentFrame;
     int tempWidth, tempHeight;
     bool running;
+    float pendingAlpha;
+    InputFrame input;
+    std::unique_ptr<InputRecorder> inputRecorder;
+    std::unique_ptr<InputReplay> inputReplay;
+    std::vector<float> replayFrameMs;
+    std::unique_ptr<ScreenAnimator> animator;
+    double animationTime;
+    bool animationPlaying;
+    RenderSettings settings;
 
-    bool handleEvents();
+    // Render thread, the only one touching GL while it runs
+    std::unique_ptr<FractalManager> fractalManager;
+    std::unique_ptr<ShaderProgram> colorShader;
+    OtherRenders::OutlineUniforms outlineUniforms;
+    std::unique_ptr<Profiler> profiler;
+    std::unique_ptr<Hud> hud;
+    std::unique_ptr<FramePacer> framePacer;
+    GLuint vao, vbo;
+    glm::mat4 projection;
+    int frameCounter;
+    int capturedFrames;
+    GLuint frozenFrame;
+    GLuint currentFrame;
+    RenderSettings applied;
+    // Changes in snapshots taken while scaling froze the image, still to be composited
+    ScreenStore::Range unrendered;
+
+    // Between the two
+    std::unique_ptr<SceneSnapshots> snapshots;
+    std::thread renderThread;
+    std::atomic<bool> rendering;
+    std::exception_ptr renderError;
+
+    bool handleEvents(float deltaSeconds);
     void handleMouseClick(const SDL_MouseButtonEvent& event);
     void handleTempScaling(const SDL_Event& event);
     void handleScalingMotion(const SDL_Event& event);
     void handleKeyPress(const std::string& event);
     void handleExitScaling(const SDL_Event& event);
-    void handleColorRotation();
-    void handleSaturation();
-    void handleStrengthen();
-    void handleWeaken();
+    void handleColorRotation(float amount);
+    void handleSaturation(float amount);
+    // H and J: start or stop the selected screen's hue cycle or saturation pulse
+    void toggleColorAnimation(bool hue);
+    void handleAlphaChange(float amount);
     void update();
-    void draw();
+    void publishScene(float eventsMs, float updateMs);
+
+    void renderLoop();
+    void stopRenderThread();
+    void renderFrame();
+    void applySettings(const RenderSettings& requested);
+    void draw(const SceneSnapshot& scene);
+    void setRecording(bool on);
+    void updateHud(const SceneSnapshot& scene);
+    void reportReplay() const;
 };
\ No newline at end of file
@@ -2,12 +2,20 @@
 #include <SDL2/SDL.h>
 #include "config.h"
 #include <cmath>
+#include <cstddef>
 #include <vector>
 #include <stdexcept>
 
 namespace MathUtils {
     void hsvToRgb(float h, float s, float v, Uint8& r, Uint8& g, Uint8& b);
     void rgbToHsv(Uint8 r, Uint8 g, Uint8 b, float& h, float& s, float& v);
+    // Batch conversions over contiguous arrays, vectorized with SSE2 (AVX2 when the compiler
+    // targets it). Any finite hue wraps into [0, 1); NaN and infinite hues give unspecified
+    // colors. The packed forms keep each color's alpha.
+    void hsvToRgb(const float* h, const float* s, const float* v, float* r, float* g, float* b, size_t count);
+    void hsvToRgb(const float* h, const float* s, const float* v, SDL_Color* colors, size_t count);
+    void rgbToHsv(const float* r, const float* g, const float* b, float* h, float* s, float* v, size_t count);
+    void rgbToHsv(const SDL_Color* colors, float* h, float* s, float* v, size_t count);
     double linearInterpolate(double y0, double y1, double t);
     double linearInterpolate(const std::vector<double>& x, const std::vector<double>& y, double xi);
     double cubicInterpolate(double y0, double y1, double y2, double y3, double t);
@@ -23,4 +31,57 @@ namespace MathUtils {
     double bilinearInterpolate(double q00, double q01, double q10, double q11, double x, double y);
     std::vector<double> chebyshevNodes(int n, double a, double b);
     std::vector<double> chebyshevWeights(const std::vector<double>& nodes);
+
+    // Interpolants that do their setup once and are then cheap to evaluate, for curves sampled
+    // every frame. Data lives in flat arrays; the batch evaluate() runs points in blocks of
+    // Lanes so the compiler keeps one point per SIMD lane.
+
+    // Newton form of the interpolating polynomial, evaluated with Horner's rule in O(n)
+    class NewtonPolynomial {
+    public:
+        NewtonPolynomial(const std::vector<double>& x, const std::vector<double>& y);
+
+        double evaluate(double xi) const;
+        void evaluate(const double* xs, double* ys, size_t count) const;
+
+        const std::vector<double>& getCoefficients() const { return coefficients; }
+
+    private:
+        std::vector<double> nodes;
+        std::vector<double> coefficients;
+    };
+
+    // Second barycentric form: O(n) per point and stable, e.g. over chebyshevNodes
+    class BarycentricInterpolant {
+    public:
+        // Computes the weights 1 / prod(x_i - x_j) for these nodes
+        BarycentricInterpolant(const std::vector<double>& x, const std::vector<double>& y);
+        BarycentricInterpolant(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& w);
+
+        double evaluate(double xi) const;
+        void evaluate(const double* xs, double* ys, size_t count) const;
+
+        const std::vector<double>& getWeights() const { return weights; }
+
+    private:
+        std::vector<double> nodes, values, weights;
+    };
+
+    // Natural cubic spline. Segment coefficients are stored together, four per segment, and a
+    // batch of ascending points walks the segments instead of searching for each one.
+    class CubicSpline {
+    public:
+        CubicSpline(const std::vector<double>& x, const std::vector<double>& y);
+
+        double evaluate(double xi) const;
+        void evaluate(const double* xs, double* ys, size_t count) const;
+
+    private:
+        size_t findSegment(double xi) const;
+        double evaluateSegment(size_t segment, double xi) const;
+
+        std::vector<double> knots;
+        // a, b, c, d of segment i at [4i, 4i + 4): y = a + b dx + c dx^2 + d dx^3
+        std::vector<double> coefficients;
+    };
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "chaos_game.h"
+#include "thread_pool.h"
+
+struct ScreenInstance;
+
+// Renders the scene's attractor at any size with flat memory, for prints far larger than the
+// display. The image is built in horizontal bands sized to Config::POSTER_MEMORY_MB, each
+// sampled with the chaos game and streamed to a PngWriter as soon as it is resolved.
+//
+// Plain chaos-game sampling would spend most points outside a band. Instead each band keeps
+// the compositions of maps (words) whose image of the attractor's bounds touches it, deep
+// enough that those images are small next to the band. Orbits on the attractor are pushed
+// through a word picked by its probability, which samples the attractor restricted to the
+// band exactly, so the cost of a band follows its size rather than the whole image's.
+class PosterExporter {
+public:
+    // Called with the finished fraction, from the calling thread
+    using Progress = std::function<void(float fraction)>;
+
+    PosterExporter(const std::vector<ScreenInstance>& screens, int sceneWidth, int sceneHeight, ThreadPool& pool);
+
+    // Writes a PNG `width` pixels wide with the scene's aspect ratio
+    void exportPng(const std::string& path, int width, float samplesPerPixel, const Progress& progress);
+
+private:
+    struct Word {
+        float xx, xy, xOffset;
+        float yx, yy, yOffset;
+        // Composed color blend: color' = color * keep + (r, g, b)
+        float keep, r, g, b;
+    };
+
+    struct Bin {
+        float r, g, b;
+        uint32_t count;
+    };
+
+    struct Stream {
+        ChaosRandom random;
+        float x, y;
+        float r, g, b;
+        std::vector<Bin> bins;
+    };
+
+    struct Band {
+        int firstRow, rows;
+        std::vector<Word> words;
+        std::vector<double> cumulativeProbabilities;
+        double probability;
+    };
+
+    void findBounds();
+    void buildWords(Band& band, float scale) const;
+    void sample(Band& band, float scale, int width, uint64_t samples);
+    float peakDensity(const Band& band, int width, uint64_t samples);
+    void resolve(const Band& band, int width, uint64_t samples, float densityScale, float logPeak, std::vector<Uint8>& rgba);
+
+    int sceneWidth, sceneHeight;
+    ThreadPool& pool;
+    std::vector<IfsMap> maps;
+    std::vector<float> cumulativeWeights;
+    std::vector<Stream> streams;
+    std::vector<float> rowPeaks;
+    float minX, minY, maxX, maxY;
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+enum class GpuSection { Composite, Present, Outline, Count };
+enum class CpuSection { HandleEvents, Update, Draw, Frame, Count };
+
+// Rolling frame statistics. GPU sections use GL_TIME_ELAPSED queries that alternate
+// between two objects per section, so results are read one frame late and never
+// stall the pipeline; a result that still isn't ready is dropped instead of waited on.
+class Profiler {
+public:
+    struct Stats {
+        float average;
+        float p50;
+        float p95;
+        float p99;
+    };
+
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void beginGpu(GpuSection section);
+    void endGpu(GpuSection section);
+    void beginCpu(CpuSection section);
+    void endCpu(CpuSection section);
+    // For work timed on another thread
+    void addCpuSample(CpuSection section, float ms);
+    // Call once per presented frame, after the swap
+    void endFrame();
+
+    // Milliseconds over the last WINDOW_SIZE samples
+    Stats getStats(GpuSection section) const;
+    Stats getStats(CpuSection section) const;
+
+    static constexpr size_t WINDOW_SIZE = 240;
+
+private:
+    struct SampleWindow {
+        std::array<float, WINDOW_SIZE> samples;
+        size_t count = 0;
+        size_t next = 0;
+
+        void push(float value);
+        Stats compute() const;
+    };
+
+    static constexpr size_t GPU_COUNT = static_cast<size_t>(GpuSection::Count);
+    static constexpr size_t CPU_COUNT = static_cast<size_t>(CpuSection::Count);
+
+    GLuint queries[GPU_COUNT][2];
+    bool issued[GPU_COUNT][2];
+    int parity;
+
+    Uint64 cpuStart[CPU_COUNT];
+    Uint64 lastFrameEnd;
+    double ticksToMs;
+
+    SampleWindow gpuWindows[GPU_COUNT];
+    SampleWindow cpuWindows[CPU_COUNT];
+};
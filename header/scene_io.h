@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "screen.h"
+#include "screen_instance.h"
+
+// Plain-text scenes: one screen per line as "x y width height rotation r g b a", optionally
+// followed by its ColorAnimation as "hueRate huePhase hueRange saturationRate saturationPhase
+// saturationRange".
+// Blank lines and lines starting with '#' are ignored.
+//
+// Binary scenes (.fsb) are a 32-byte header followed by the screens as a flat array of
+// ScreenInstance records, little-endian, exactly as the compositing pass consumes them.
+// The header carries a CRC-32 of the records so truncated or edited files are rejected.
+namespace SceneIO {
+    struct BinaryHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint64_t recordCount;
+        uint32_t checksum;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(BinaryHeader) == 32, "The binary scene header must be 32 bytes so the records after it stay aligned");
+
+    std::vector<Screen> loadText(const std::string& path);
+    void saveText(const std::string& path, const std::vector<Screen>& screens);
+    std::vector<Screen> loadBinary(const std::string& path);
+    void saveBinary(const std::string& path, const std::vector<Screen>& screens);
+
+    std::vector<Screen> fromRecords(const ScreenInstance* records, size_t count);
+    bool isBinary(const std::string& path);
+    // Choose the format from the extension: .fsb is binary, anything else text
+    std::vector<Screen> load(const std::string& path);
+    void save(const std::string& path, const std::vector<Screen>& screens);
+}
+
+// Read-only memory mapping of a binary scene. The records are validated once on open and
+// can then go straight into a GPU buffer (FractalManager::setInstances) without parsing.
+class MappedScene {
+public:
+    explicit MappedScene(const std::string& path);
+    ~MappedScene();
+
+    MappedScene(const MappedScene&) = delete;
+    MappedScene& operator=(const MappedScene&) = delete;
+
+    const ScreenInstance* data() const { return records; }
+    size_t size() const { return count; }
+
+private:
+    void unmap();
+
+    void* mapping;
+    size_t mappedBytes;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+    const ScreenInstance* records;
+    size_t count;
+};
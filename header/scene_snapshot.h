@@ -0,0 +1,61 @@
+#pragma once
+#include <optional>
+#include <vector>
+#include "config.h"
+#include "screen.h"
+#include "screen_instance.h"
+#include "screen_store.h"
+#include "triple_buffer.h"
+
+// Render state chosen by input. The renderer applies whatever differs from what it applied
+// last, so a snapshot it never sees loses nothing; one-shot requests are counters for the same reason.
+struct RenderSettings {
+    float exposure = Config::EXPOSURE;
+    Config::ToneMap toneMap = Config::TONE_MAP;
+    Config::RenderEngine engine = Config::RENDER_ENGINE;
+    bool showHud = Config::SHOW_FPS;
+    bool capturing = false;
+    bool recording = false;
+    unsigned int pacingCycles = 0;
+    unsigned int frameReloads = 0;
+};
+
+// Everything the renderer needs for a frame, immutable once published
+struct SceneSnapshot {
+    std::vector<ScreenInstance> instances;
+    unsigned int revision = 0;
+    // Indices that differ from the last snapshot the renderer took
+    ScreenStore::Range changed = { 0, 0 };
+
+    std::optional<Screen> selection;
+    bool scalingMode = false;
+    int tempWidth = 0, tempHeight = 0;
+    RenderSettings settings;
+    // Input thread time spent on the events and the update behind this snapshot
+    float eventsMs = 0.0f, updateMs = 0.0f;
+};
+
+// The store as seen by the render thread, published from the input thread through a
+// TripleBuffer. Each slot keeps a full copy of the instance records and is only brought up
+// to date over the indices written since that slot was last filled, so publishing costs
+// the size of the edit, not of the scene.
+class SceneSnapshots {
+public:
+    SceneSnapshots();
+
+    // Input thread: the next snapshot with its records matching store. The caller fills in
+    // the rest, publishes, and then clears the store's dirty range.
+    SceneSnapshot& prepare(const ScreenStore& store, unsigned int revision);
+    void publish() { slots.publish(); }
+
+    // Render thread: takes the newest snapshot, returning false if there was none since the last call
+    bool acquire() { return slots.acquire(); }
+    const SceneSnapshot& latest() const { return slots.front(); }
+
+private:
+    TripleBuffer<SceneSnapshot> slots;
+    // Per slot, the indices written since the slot was last filled
+    ScreenStore::Range stale[3];
+    // Indices written since the snapshot the renderer last took
+    ScreenStore::Range untaken;
+};
@@ -2,6 +2,24 @@
 #include <SDL2/SDL.h>
 #include "config.h"
 
+// Hue and saturation animation, applied per frame by the compositing shader instead of being
+// baked into the color. Rates are in cycles per second and phases in cycles. With range 0 the
+// value cycles, wrapping around: base + phase + rate * t. With a range it swings around the
+// base instead: base + range * sin(2 pi (rate * t + phase)), saturation clamped to [0, 1].
+// The packed form in ScreenInstance holds rates within +-MAX_RATE in steps of 1/1024, phases
+// in [0, 1) and ranges within [0, MAX_RANGE]; Screen::setColorAnimation clamps to these.
+struct ColorAnimation {
+    static constexpr float MAX_RATE = 2047.0f / 1024.0f;
+    static constexpr float MAX_RANGE = 0.5f;
+
+    float hueRate = 0.0f, huePhase = 0.0f, hueRange = 0.0f;
+    float saturationRate = 0.0f, saturationPhase = 0.0f, saturationRange = 0.0f;
+
+    bool isNone() const;
+    // The color at t seconds as the shader computes it, to 8 bits, for the CPU compositor
+    SDL_Color apply(SDL_Color base, float t) const;
+};
+
 class Screen {
 public:
     Screen(float x, float y, int width, int height, float rotation, SDL_Color color);
@@ -13,6 +31,7 @@ public:
     void setHeight(int height);
     void setRotation(float rotation);
     void setColor(SDL_Color color);
+    void setColorAnimation(const ColorAnimation& animation);
 
     // Getters
     float getX() const;
@@ -21,12 +40,15 @@ public:
     int getHeight() const;
     float getRotation() const;
     SDL_Color getColor() const;
+    ColorAnimation getColorAnimation() const { return colorAnimation; }
     SDL_Color getOutlineColor() const;
     SDL_Color getScaleOutlineColor() const;
 
     // Actions
     void rotate(float degrees);
     SDL_FPoint getRotatedSize() const;
+    // Hit test against the rotated rectangle, using the cached rotation
+    bool contains(float px, float py) const;
 
 private:
     float xCoord;
@@ -35,4 +57,10 @@ private:
     int origHeight;
     float rotation;
     SDL_Color color;
+    ColorAnimation colorAnimation;
+    // sin/cos of rotation, refreshed whenever it changes
+    float cosRotation;
+    float sinRotation;
+
+    void updateRotationCache();
 };
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "screen_store.h"
+#include "thread_pool.h"
+
+// Curve from a keyframe to the next, after the MathUtils interpolator of the same name.
+// CatmullRom takes its outer points from the neighbouring keys; Hermite uses the keys' tangents.
+enum class Easing : uint8_t { Step, Linear, Cosine, Smoothstep, Smootherstep, CatmullRom, Hermite };
+
+struct Keyframe {
+    double time;
+    float value;
+    Easing easing = Easing::Linear;
+    // Slope in units per second, used by Hermite segments on either side of the key
+    float tangent = 0.0f;
+};
+
+// Keyframed screen fields. Every track drives one field of one screen. setTrack bakes each
+// segment between two keys into a degree-7 polynomial through the eased curve at fixed
+// Chebyshev nodes: exact for the polynomial easings, and within 1e-5 of the step for Cosine.
+// Playback is then the same Horner loop for every track whatever its easing, run over blocks
+// of tracks one per SIMD lane, with the blocks spread over a thread pool and the results
+// written straight into the store.
+class ScreenAnimator {
+public:
+    ScreenAnimator();
+    ~ScreenAnimator();
+
+    // Replaces the screen's track for field. Keys are sorted by time and need distinct times;
+    // looping tracks repeat from the first key's time with the span of the keys as period.
+    void setTrack(ScreenHandle screen, ScreenField field, std::vector<Keyframe> keys, bool loop = false);
+    void clear();
+
+    size_t getTrackCount() const { return tracks.size(); }
+    bool empty() const { return tracks.empty(); }
+    // Time of the last key over all tracks
+    double getDuration() const { return duration; }
+
+    // Writes every track's value at time into the store and marks the dense indices it wrote,
+    // returned as the range. Tracks of deleted screens are skipped, and so are tracks held at
+    // their first or last key that were already written there, so a finished animation
+    // returns an empty range and leaves the scene free to converge.
+    ScreenStore::Range apply(double time, ScreenStore& store);
+
+    // Text tracks, one key per line: "screen field time value [easing [tangent]]" where screen
+    // is a dense index into store, field one of x y width height rotation red green blue alpha,
+    // and easing one of step linear cosine smoothstep smootherstep catmullrom hermite (linear
+    // by default). "loop screen field" makes that track repeat. Replaces every track.
+    void load(const std::string& path, const ScreenStore& store);
+
+    static constexpr int DEGREE = 7;
+
+private:
+    struct Track {
+        ScreenHandle screen;
+        ScreenField field;
+        bool loop;
+        uint32_t firstKey;
+        uint32_t keyCount;
+        // Segment the previous apply used, where forward playback looks first
+        uint32_t cursor;
+        // End of its keys the track was last written held at: -1 before the first, 1 after
+        // the last, 0 for neither. A held track is not written again until this changes.
+        int8_t held;
+    };
+
+    // Coefficients of one segment's Newton form over the shared nodes, half a cache line
+    struct alignas(32) Segment {
+        float coefficients[DEGREE + 1];
+    };
+
+    void evaluateBlock(size_t block, double time, ScreenStore& store, ScreenStore::Range& written);
+    float localTime(Track& track, double time, const Segment*& segment, int8_t& held);
+
+    std::vector<Track> tracks;
+    // Track index by screen slot and field
+    std::unordered_map<uint64_t, uint32_t> trackOf;
+    // Per key: its time and 1 / (time to the next key), and the segment starting there. A
+    // track's last key holds a constant segment.
+    std::vector<double> keyTimes;
+    std::vector<float> inverseSpans;
+    std::vector<Segment> segments;
+    double duration;
+    // Sample points of the segment polynomials: Chebyshev nodes on [0, 1]
+    float nodes[DEGREE + 1];
+
+    std::vector<ScreenStore::Range> blockRanges;
+    std::unique_ptr<ThreadPool> pool;
+};
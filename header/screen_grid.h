@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "screen.h"
+
+// Uniform grid over the window for screen hit-testing. Every cell lists the screens whose
+// rotated bounding box overlaps it; screens reaching past the window are clamped to the edge
+// cells, since the mouse never leaves it. A lookup is one cell, so it costs the number of
+// screens actually under the cursor rather than the scene size, and it never allocates.
+class ScreenGrid {
+public:
+    ScreenGrid(int width, int height, int cellSize);
+
+    // Screens are identified by their dense index in the ScreenStore
+    void rebuild(const std::vector<Screen>& screens);
+    void insert(uint32_t index, const Screen& screen);
+    // Moves a screen to the cells its current bounds cover; cheap when they did not change
+    void update(uint32_t index, const Screen& screen);
+    // Mirrors ScreenStore::remove: drops index, then renames movedFrom (if any) to index
+    void remove(uint32_t index, uint32_t movedFrom);
+
+    // Indices of the screens possibly containing (x, y), or nullptr outside the window
+    const std::vector<uint32_t>* candidatesAt(float x, float y) const;
+
+private:
+    struct CellRange {
+        int x0, y0, x1, y1;
+        bool operator==(const CellRange& other) const {
+            return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1;
+        }
+    };
+
+    CellRange cellRange(const Screen& screen) const;
+    void addToCells(uint32_t index, const CellRange& range);
+    void removeFromCells(uint32_t index, const CellRange& range);
+    void renameInCells(uint32_t from, uint32_t to, const CellRange& range);
+
+    int cellSize;
+    int columns, rows;
+    std::vector<std::vector<uint32_t>> cells;
+    std::vector<CellRange> ranges;
+};
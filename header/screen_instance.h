@@ -0,0 +1,26 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include "screen.h"
+
+// Per-screen data for the instanced compositing pass. The vertex shader rebuilds each
+// screen's transform from these, so the buffer is only rewritten when the scene changes.
+struct ScreenInstance {
+    float x, y;
+    float width, height;
+    float rotation;
+    SDL_Color color;
+    // Packed ColorAnimation, hue then saturation. Per word: rate in 1/1024 cycles per second
+    // (signed, bits 0-11), phase in 1/4096 cycles (bits 12-23) and range in 1/510 (bits 24-31,
+    // up to half a cycle). Scenes written before it have zeros here, which is no animation.
+    uint32_t colorAnimation[2];
+
+    static ScreenInstance from(const Screen& screen);
+    ColorAnimation getColorAnimation() const;
+    void setColorAnimation(const ColorAnimation& animation);
+    // True when the color changes from frame to frame, not just by a fixed phase
+    bool hasAnimatedColor() const { return ((colorAnimation[0] | colorAnimation[1]) & 0xFFFu) != 0; }
+};
+
+// Also the record layout of binary scene files, so it must not change without a version bump
+static_assert(sizeof(ScreenInstance) == 32, "ScreenInstance is a 32-byte file and GPU record");
@@ -2,33 +2,56 @@
 #include <vector>
 #include <SDL2/SDL.h>
 #include "screen.h"
+#include "screen_animator.h"
+#include "screen_grid.h"
+#include "screen_store.h"
 #include "config.h"
 
 class ScreenManager {
 public:
     ScreenManager(int width, int height);
 
-    Screen* createScreen(SDL_FPoint pos);
-    Screen* handleSelection(SDL_FPoint mousePos);
-    void handleDragging(SDL_FPoint mousePos);
+    ScreenHandle createScreen(SDL_FPoint pos);
+    ScreenHandle handleSelection(SDL_FPoint mousePos);
+    // Moves the selection with the mouse while the left button is held
+    void handleDragging(SDL_FPoint mousePos, bool buttonHeld);
     void handleScaling(int scrollY);
     void handleRotation(float direction);
+    void deleteSelected();
 
-    Screen* getSelectedScreen() const { return selectedScreen; }
-    const std::vector<Screen>& getScreens() const { return screens; }
+    ScreenHandle getSelected() const { return selected; }
+    bool hasSelection() const { return store.isValid(selected); }
+    // Copy of the selected screen; only meaningful while hasSelection()
+    Screen getSelectedScreen() const;
+    // Writes an edited copy back over the selected screen
+    void updateSelected(const Screen& screen);
+
+    const ScreenStore& getStore() const { return store; }
+    std::vector<Screen> getScreens() const { return store.toScreens(); }
+    // Replaces the whole scene, e.g. after loading a file
+    void setScreens(const std::vector<Screen>& newScreens);
+    // Writes the animated fields at time. The hit-test grid is only rebuilt at the next click,
+    // not on every animated frame.
+    void applyAnimation(ScreenAnimator& animator, double time);
+
+    // Bumped whenever a screen is created, moved, resized, rotated, recolored or deleted.
+    // The store's dirty range says which dense indices changed; the renderer consumes it
+    // and then calls clearDirty.
+    unsigned int getRevision() const { return revision; }
+    void clearDirty() { store.clearDirty(); }
 
 private:
-    std::vector<Screen> screens;
-    Screen* selectedScreen;
+    ScreenStore store;
+    ScreenHandle selected;
     SDL_FPoint dragOffset;
     int width;
     int height;
+    unsigned int revision;
+    ScreenGrid grid;
+    bool gridStale;
 
-    Screen* findScreenAtPosition(float x, float y) const;
-    Screen* selectSmallestFromCandidates(const std::vector<Screen*>& candidates) const;
+    uint32_t findScreenAtPosition(float x, float y) const;
 
     static SDL_FPoint rotatePoint(float cx, float cy, float x, float y, float angle);
-    static bool pointInRotatedRect(float px, float py, SDL_FPoint rectCenter,
-        float width, float height, float angle);
     static float isLeft(SDL_FPoint p0, SDL_FPoint p1, SDL_FPoint point);
 };
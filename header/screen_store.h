@@ -0,0 +1,105 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "screen.h"
+#include "screen_instance.h"
+
+// Stable reference to a screen. It stays valid while the screen lives, wherever deletions
+// move it in the arrays, and stops resolving once it is deleted, even if its slot is reused.
+struct ScreenHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const ScreenHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const ScreenHandle& other) const { return !(*this == other); }
+};
+
+// Per-screen values that can be written one at a time; colors are 0-255 per channel
+enum class ScreenField : uint8_t { X, Y, Width, Height, Rotation, Red, Green, Blue, Alpha };
+
+// The scene as a slot map over structure-of-arrays storage. Every field lives in its own
+// contiguous array indexed by a dense index in [0, size()), which is also the drawing order.
+// Deleting swaps the last screen into the hole, so it is O(1) but moves that screen down the
+// stack. Handles map to dense indices through a slot table with a generation per slot.
+//
+// Every write widens a dirty range of dense indices, so consumers can copy only what changed
+// since they last called clearDirty().
+class ScreenStore {
+public:
+    struct Range {
+        uint32_t begin, end;
+        bool empty() const { return begin >= end; }
+        Range united(Range other) const {
+            if (empty()) return other;
+            if (other.empty()) return *this;
+            return { begin < other.begin ? begin : other.begin, end > other.end ? end : other.end };
+        }
+    };
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    ScreenHandle add(const Screen& screen);
+    // Returns the dense index the last screen was moved from, or NO_INDEX if nothing moved.
+    // Does nothing and returns NO_INDEX for a stale handle.
+    uint32_t remove(ScreenHandle handle);
+    void assign(const std::vector<Screen>& screens);
+    void clear();
+
+    bool isValid(ScreenHandle handle) const { return indexOf(handle) != NO_INDEX; }
+    // Dense index of a live handle, or NO_INDEX
+    uint32_t indexOf(ScreenHandle handle) const;
+    ScreenHandle handleAt(uint32_t index) const { return { slotOf[index], slots[slotOf[index]].generation }; }
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    Screen get(uint32_t index) const;
+    void set(uint32_t index, const Screen& screen);
+    std::vector<Screen> toScreens() const;
+
+    // Same test as Screen::contains, straight from the arrays
+    bool contains(uint32_t index, float px, float py) const;
+    float area(uint32_t index) const { return width[index] * height[index]; }
+
+    const float* xs() const { return x.data(); }
+    const float* ys() const { return y.data(); }
+    const float* widths() const { return width.data(); }
+    const float* heights() const { return height.data(); }
+    const float* rotations() const { return rotation.data(); }
+    const SDL_Color* colors() const { return color.data(); }
+    const ColorAnimation* colorAnimations() const { return colorAnimation.data(); }
+
+    // Writes one field of a live index, e.g. from the animator. Several threads may write
+    // different indices at once, so this leaves the dirty range alone: follow up with markDirty.
+    void setField(uint32_t index, ScreenField field, float value);
+    void markDirty(Range range);
+
+    // Writes the records for the dense indices in range to out[range.begin, range.end)
+    void writeInstances(ScreenInstance* out, Range range) const;
+
+    // Indices written since the last clearDirty(), clamped to the current size
+    Range getDirtyRange() const;
+    void clearDirty() { dirty = { 0, 0 }; }
+
+private:
+    struct Slot {
+        uint32_t index;
+        uint32_t generation;
+    };
+
+    void markDirty(uint32_t index);
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint32_t> slotOf;
+
+    std::vector<float> x, y;
+    std::vector<float> width, height;
+    std::vector<float> rotation;
+    // sin/cos of rotation, kept for hit-testing
+    std::vector<float> cosRotation, sinRotation;
+    std::vector<SDL_Color> color;
+    std::vector<ColorAnimation> colorAnimation;
+
+    Range dirty = { 0, 0 };
+};
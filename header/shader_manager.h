@@ -2,7 +2,38 @@
 #include <GL/glew.h>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+
+// Linked program with its active uniforms and attributes resolved once at link time.
+// Programs are restored from the on-disk binary cache when the driver allows it.
+class ShaderProgram {
+public:
+    ShaderProgram(const char* vertexSrc, const char* fragmentSrc);
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    void use() const { glUseProgram(program); }
+    GLuint getId() const { return program; }
+    bool isFromCache() const { return fromCache; }
+
+    // Return -1 for names that are not active in the program, like glGetUniformLocation
+    GLint getUniformLocation(const std::string& name) const;
+    GLint getAttributeLocation(const std::string& name) const;
+
+private:
+    void reflect();
+
+    GLuint program;
+    bool fromCache;
+    std::unordered_map<std::string, GLint> uniforms;
+    std::unordered_map<std::string, GLint> attributes;
+};
 
 namespace ShaderManager {
     GLuint createShaderProgram(const char* vertexSrc, const char* fragmentSrc);
-}
\ No newline at end of file
+    std::string programCacheKey(const char* vertexSrc, const char* fragmentSrc);
+    GLuint loadCachedProgram(const std::string& key);
+    void storeCachedProgram(GLuint program, const std::string& key);
+}
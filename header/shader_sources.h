@@ -0,0 +1,280 @@
+#pragma once
+
+// GLSL shared by the interactive and headless front ends
+namespace ShaderSources {
+    constexpr const char* QUAD_VERTEX = R"(
+        #version 330 core
+        layout(location = 0) in vec2 pos;
+        layout(location = 1) in vec2 texCoord;
+        uniform mat4 projection;
+        uniform mat4 model;
+        out vec2 vTexCoord;
+        void main() {
+            gl_Position = projection * model * vec4(pos, 0.0, 1.0);
+            vTexCoord = texCoord;
+        }
+    )";
+    constexpr const char* TEXTURE_FRAGMENT = R"(
+        #version 330 core
+        in vec2 vTexCoord;
+        uniform sampler2D tex;
+        uniform vec4 color;
+        out vec4 fragColor;
+        void main() {
+            vec4 texColor = texture(tex, vTexCoord);
+            fragColor = texColor * color;
+        }
+    )";
+    // Shows the feedback frame over black (rgb * a) after exposure and tone mapping
+    constexpr const char* PRESENT_FRAGMENT = R"(
+        #version 330 core
+        in vec2 vTexCoord;
+        uniform sampler2D frame;
+        uniform float exposure;
+        uniform int toneMap;
+        uniform int upscale;
+        out vec4 fragColor;
+
+        // Catmull-Rom filter over 4x4 texels, folded into nine bilinear taps, for frames
+        // rendered below the output resolution
+        vec4 sampleBicubic(vec2 uv) {
+            vec2 size = vec2(textureSize(frame, 0));
+            vec2 position = uv * size;
+            vec2 center = floor(position - 0.5) + 0.5;
+            vec2 f = position - center;
+            vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+            vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+            vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+            vec2 w3 = f * f * (-0.5 + 0.5 * f);
+            vec2 w12 = w1 + w2;
+            vec2 p0 = (center - 1.0) / size;
+            vec2 p12 = (center + w2 / w12) / size;
+            vec2 p3 = (center + 2.0) / size;
+            vec4 result =
+                (textureLod(frame, vec2(p0.x, p0.y), 0.0) * w0.x + textureLod(frame, vec2(p12.x, p0.y), 0.0) * w12.x + textureLod(frame, vec2(p3.x, p0.y), 0.0) * w3.x) * w0.y +
+                (textureLod(frame, vec2(p0.x, p12.y), 0.0) * w0.x + textureLod(frame, vec2(p12.x, p12.y), 0.0) * w12.x + textureLod(frame, vec2(p3.x, p12.y), 0.0) * w3.x) * w12.y +
+                (textureLod(frame, vec2(p0.x, p3.y), 0.0) * w0.x + textureLod(frame, vec2(p12.x, p3.y), 0.0) * w12.x + textureLod(frame, vec2(p3.x, p3.y), 0.0) * w3.x) * w3.y;
+            return max(result, 0.0);
+        }
+
+        void main() {
+            vec4 texColor = upscale == 1 ? sampleBicubic(vTexCoord) : texture(frame, vTexCoord);
+            vec3 color = texColor.rgb * texColor.a * exposure;
+            if (toneMap == 1) {
+                color = color / (1.0 + color);
+            }
+            else if (toneMap == 2) {
+                // Narkowicz's fit of the ACES filmic curve
+                color = (color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14);
+            }
+            fragColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+        }
+    )";
+    constexpr const char* COLOR_FRAGMENT = R"(
+        #version 330 core
+        uniform vec4 color;
+        out vec4 fragColor;
+        void main() {
+            fragColor = color;
+        }
+    )";
+
+    constexpr const char* COMPOSITE_VERTEX = R"(
+        #version 330 core
+        layout(location = 0) in vec2 pos;
+        layout(location = 1) in vec2 texCoord;
+        layout(location = 2) in vec4 screenRect;
+        layout(location = 3) in float screenRotation;
+        layout(location = 4) in vec4 screenColor;
+        layout(location = 5) in uvec2 screenColorAnimation;
+        uniform mat4 projection;
+        uniform vec2 frameSize;
+        uniform float colorTime;
+        out vec2 vTexCoord;
+        flat out vec4 vColor;
+
+        vec3 rgbToHsv(vec3 c) {
+            float high = max(c.r, max(c.g, c.b));
+            float delta = high - min(c.r, min(c.g, c.b));
+            float h = 0.0;
+            if (delta > 0.0) {
+                if (high == c.r) h = (c.g - c.b) / delta;
+                else if (high == c.g) h = (c.b - c.r) / delta + 2.0;
+                else h = (c.r - c.g) / delta + 4.0;
+            }
+            return vec3(fract(h / 6.0), high > 0.0 ? delta / high : 0.0, high);
+        }
+        vec3 hsvToRgb(vec3 c) {
+            vec3 k = clamp(abs(mod(c.x * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);
+            return c.z * mix(vec3(1.0), k, c.y);
+        }
+        // One ColorAnimation word (see ScreenInstance) applied to value at colorTime
+        float animate(float value, uint word, bool clampSwing) {
+            float rate = float(int(word << 20u) >> 20) / 1024.0;
+            float phase = float((word >> 12u) & 0xFFFu) / 4096.0;
+            float range = float(word >> 24u) / 510.0;
+            float cycle = rate * colorTime + phase;
+            if (range > 0.0) {
+                value += range * sin(6.28318531 * cycle);
+                return clampSwing ? clamp(value, 0.0, 1.0) : fract(value);
+            }
+            return fract(value + cycle);
+        }
+
+        void main() {
+            // Same transform as translate(x, h - y) * rotate(180 - r) * translate(w/2, -h/2) * scale(-w, h)
+            float angle = radians(180.0 - screenRotation);
+            float c = cos(angle);
+            float s = sin(angle);
+            vec2 center = vec2(screenRect.x, frameSize.y - screenRect.y);
+
+            // Cull screens that cannot touch a pixel: degenerate, sub-pixel or entirely off the frame
+            vec2 halfExtent = 0.5 * vec2(abs(c) * screenRect.z + abs(s) * screenRect.w, abs(s) * screenRect.z + abs(c) * screenRect.w);
+            bool culled = screenRect.z * screenRect.w < 1.0
+                || any(lessThan(center + halfExtent, vec2(0.0)))
+                || any(greaterThan(center - halfExtent, frameSize));
+            if (culled) {
+                gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+                vTexCoord = texCoord;
+                vColor = vec4(0.0);
+                return;
+            }
+
+            vec2 local = vec2(screenRect.z * (0.5 - pos.x), screenRect.w * (pos.y - 0.5));
+            vec2 world = vec2(c * local.x - s * local.y, s * local.x + c * local.y) + center;
+            gl_Position = projection * vec4(world, 0.0, 1.0);
+            vTexCoord = texCoord;
+            vColor = screenColor;
+            if (screenColorAnimation != uvec2(0u)) {
+                vec3 hsv = rgbToHsv(screenColor.rgb);
+                if (screenColorAnimation.x != 0u) hsv.x = animate(hsv.x, screenColorAnimation.x, false);
+                if (screenColorAnimation.y != 0u) hsv.y = animate(hsv.y, screenColorAnimation.y, true);
+                vColor.rgb = hsvToRgb(hsv);
+            }
+        }
+    )";
+    constexpr const char* COMPOSITE_FRAGMENT = R"(
+        #version 330 core
+        in vec2 vTexCoord;
+        flat in vec4 vColor;
+        uniform sampler2D previousFrame;
+        out vec4 fragColor;
+        void main() {
+            // Texture copy followed by the premultiplied color overlay, folded into a single "over"
+            vec4 texColor = texture(previousFrame, vTexCoord);
+            vec4 overlay = vec4(vColor.rgb * vColor.a, vColor.a);
+            fragColor = overlay + texColor * (1.0 - vColor.a);
+        }
+    )";
+
+    constexpr const char* FULLSCREEN_VERTEX = R"(
+        #version 330 core
+        layout(location = 0) in vec2 pos;
+        layout(location = 1) in vec2 texCoord;
+        out vec2 vTexCoord;
+        void main() {
+            gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+            vTexCoord = texCoord;
+        }
+    )";
+    // First convergence pass: max channel difference over 4x4 blocks of two frames
+    constexpr const char* DIFF_FRAGMENT = R"(
+        #version 330 core
+        uniform sampler2D newerFrame;
+        uniform sampler2D olderFrame;
+        out vec4 fragColor;
+        void main() {
+            ivec2 base = ivec2(gl_FragCoord.xy) * 4;
+            ivec2 limit = textureSize(newerFrame, 0) - 1;
+            float delta = 0.0;
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 4; ++x) {
+                    ivec2 p = min(base + ivec2(x, y), limit);
+                    vec4 d = abs(texelFetch(newerFrame, p, 0) - texelFetch(olderFrame, p, 0));
+                    delta = max(delta, max(max(d.r, d.g), max(d.b, d.a)));
+                }
+            }
+            fragColor = vec4(delta);
+        }
+    )";
+    // Following convergence passes: max over 4x4 blocks until one texel is left
+    constexpr const char* REDUCE_MAX_FRAGMENT = R"(
+        #version 330 core
+        uniform sampler2D source;
+        out vec4 fragColor;
+        void main() {
+            ivec2 base = ivec2(gl_FragCoord.xy) * 4;
+            ivec2 limit = textureSize(source, 0) - 1;
+            float delta = 0.0;
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 4; ++x) {
+                    delta = max(delta, texelFetch(source, min(base + ivec2(x, y), limit), 0).r);
+                }
+            }
+            fragColor = vec4(delta);
+        }
+    )";
+
+    // Packs a frame into a Y4M 4:2:0 frame, four 8-bit samples per RGBA texel: Y rows first,
+    // then U and V with two chroma rows per texel row. Chroma averages 2x2 blocks (420jpeg
+    // siting). BT.601 limited range of rgb * a; the recorder feeds it the presented frame.
+    constexpr const char* YUV420_FRAGMENT = R"(
+        #version 330 core
+        uniform sampler2D frame;
+        uniform ivec2 videoSize;
+        out vec4 fragColor;
+        const vec3 LUMA = vec3(0.299, 0.587, 0.114);
+        vec3 visible(ivec2 p) {
+            vec4 c = texelFetch(frame, p, 0);
+            return c.rgb * c.a;
+        }
+        void main() {
+            ivec2 texel = ivec2(gl_FragCoord.xy);
+            int x = texel.x * 4;
+            vec4 samples;
+            if (texel.y < videoSize.y) {
+                for (int i = 0; i < 4; ++i) {
+                    samples[i] = (16.0 + 219.0 * dot(visible(ivec2(x + i, texel.y)), LUMA)) / 255.0;
+                }
+            }
+            else {
+                int planeRow = texel.y - videoSize.y;
+                int quarter = videoSize.y / 4;
+                bool isV = planeRow >= quarter;
+                int halfWidth = videoSize.x / 2;
+                int chromaRow = 2 * (isV ? planeRow - quarter : planeRow) + (x >= halfWidth ? 1 : 0);
+                int chromaCol = x >= halfWidth ? x - halfWidth : x;
+                for (int i = 0; i < 4; ++i) {
+                    ivec2 p = ivec2(2 * (chromaCol + i), 2 * chromaRow);
+                    vec3 c = 0.25 * (visible(p) + visible(p + ivec2(1, 0)) + visible(p + ivec2(0, 1)) + visible(p + ivec2(1, 1)));
+                    float y = dot(c, LUMA);
+                    float difference = isV ? (c.r - y) / 1.402 : (c.b - y) / 1.772;
+                    samples[i] = (128.0 + 224.0 * difference) / 255.0;
+                }
+            }
+            fragColor = samples;
+        }
+    )";
+
+    constexpr const char* HUD_VERTEX = R"(
+        #version 330 core
+        layout(location = 0) in vec2 pos;
+        layout(location = 1) in vec2 texCoord;
+        uniform mat4 projection;
+        out vec2 vTexCoord;
+        void main() {
+            gl_Position = projection * vec4(pos, 0.0, 1.0);
+            vTexCoord = texCoord;
+        }
+    )";
+    constexpr const char* HUD_FRAGMENT = R"(
+        #version 330 core
+        in vec2 vTexCoord;
+        uniform sampler2D font;
+        uniform vec4 color;
+        out vec4 fragColor;
+        void main() {
+            fragColor = vec4(color.rgb, color.a * texture(font, vTexCoord).r);
+        }
+    )";
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. parallelFor deals the index range
+// out in contiguous blocks, one deque per worker; a worker drains its own deque from the
+// front and then steals from the back of the others, so uneven items still balance out.
+// The calling thread takes part as worker 0. parallelFor must not be nested.
+class ThreadPool {
+public:
+    // 0 uses every hardware thread
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Worker count including the calling thread; worker indices passed to bodies are below this
+    int getThreadCount() const { return static_cast<int>(queues.size()); }
+
+    // Runs body(index, worker) for every index in [0, count) and returns when all are done.
+    // The first exception thrown by a body is rethrown here.
+    void parallelFor(size_t count, const std::function<void(size_t index, int worker)>& body);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+
+    void workerLoop(int worker);
+    bool runOne(int worker);
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    const std::function<void(size_t, int)>* job;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    size_t generation;
+    int activeWorkers;
+    bool stopping;
+    std::exception_ptr error;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer, single-consumer exchange of the latest value. The writer fills
+// back() and publishes it; the reader takes the newest published value, if any, into
+// front(). Neither side ever waits: values the reader is too slow to take are replaced.
+// The three slots only change hands through one atomic index, so each side owns its slot
+// outright between calls.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), backIndex(0), frontIndex(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side
+    T& back() { return slots[backIndex]; }
+    int getBackIndex() const { return backIndex; }
+    void publish() {
+        backIndex = middle.exchange(static_cast<uint8_t>(backIndex | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+    // True while the last published value has not been taken. Only the writer can make it
+    // true, so a false from the writer's side stays false until it publishes again.
+    bool isPending() const { return (middle.load(std::memory_order_acquire) & FRESH) != 0; }
+
+    // Reader side. Returns false, keeping front(), when nothing was published since the last take.
+    bool acquire() {
+        if (!isPending()) {
+            return false;
+        }
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4;
+
+    T slots[3];
+    // Slot between the two sides, with FRESH set when the writer put it there
+    std::atomic<uint8_t> middle;
+    uint8_t backIndex;
+    uint8_t frontIndex;
+};
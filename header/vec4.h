@@ -0,0 +1,88 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRACTUS_SSE2 1
+#endif
+
+// Four floats, one RGBA pixel, in an SSE register where available. The CPU kernels are
+// written against this so the same code compiles to SSE2 or to plain scalar math.
+struct Vec4 {
+#ifdef FRACTUS_SSE2
+    __m128 v;
+
+    Vec4() : v(_mm_setzero_ps()) {}
+    explicit Vec4(__m128 v) : v(v) {}
+    explicit Vec4(float s) : v(_mm_set1_ps(s)) {}
+    Vec4(float x, float y, float z, float w) : v(_mm_setr_ps(x, y, z, w)) {}
+
+    Vec4 operator+(Vec4 o) const { return Vec4(_mm_add_ps(v, o.v)); }
+    Vec4 operator-(Vec4 o) const { return Vec4(_mm_sub_ps(v, o.v)); }
+    Vec4 operator*(Vec4 o) const { return Vec4(_mm_mul_ps(v, o.v)); }
+    Vec4 operator*(float s) const { return Vec4(_mm_mul_ps(v, _mm_set1_ps(s))); }
+
+    float w() const { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+    // w broadcast to every lane
+    Vec4 wwww() const { return Vec4(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+    static Vec4 min(Vec4 a, Vec4 b) { return Vec4(_mm_min_ps(a.v, b.v)); }
+    static Vec4 max(Vec4 a, Vec4 b) { return Vec4(_mm_max_ps(a.v, b.v)); }
+    static Vec4 abs(Vec4 a) { return Vec4(_mm_and_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)))); }
+    float maxElement() const {
+        __m128 m = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(m);
+    }
+
+    static Vec4 loadUnorm8(const Uint8* p) {
+        int packed;
+        std::memcpy(&packed, p, 4);
+        __m128i zero = _mm_setzero_si128();
+        __m128i bytes = _mm_cvtsi32_si128(packed);
+        __m128i words = _mm_unpacklo_epi8(bytes, zero);
+        __m128i dwords = _mm_unpacklo_epi16(words, zero);
+        return Vec4(_mm_mul_ps(_mm_cvtepi32_ps(dwords), _mm_set1_ps(1.0f / 255.0f)));
+    }
+    void storeUnorm8(Uint8* p) const {
+        __m128 clamped = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        __m128i dwords = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(255.0f)));
+        __m128i words = _mm_packs_epi32(dwords, dwords);
+        int packed = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        std::memcpy(p, &packed, 4);
+    }
+    static Vec4 load(const float* p) { return Vec4(_mm_loadu_ps(p)); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+#else
+    float x, y, z, a;
+
+    Vec4() : x(0.0f), y(0.0f), z(0.0f), a(0.0f) {}
+    explicit Vec4(float s) : x(s), y(s), z(s), a(s) {}
+    Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), a(w) {}
+
+    Vec4 operator+(Vec4 o) const { return Vec4(x + o.x, y + o.y, z + o.z, a + o.a); }
+    Vec4 operator-(Vec4 o) const { return Vec4(x - o.x, y - o.y, z - o.z, a - o.a); }
+    Vec4 operator*(Vec4 o) const { return Vec4(x * o.x, y * o.y, z * o.z, a * o.a); }
+    Vec4 operator*(float s) const { return Vec4(x * s, y * s, z * s, a * s); }
+
+    float w() const { return a; }
+    Vec4 wwww() const { return Vec4(a); }
+
+    static Vec4 min(Vec4 p, Vec4 q) { return Vec4(std::min(p.x, q.x), std::min(p.y, q.y), std::min(p.z, q.z), std::min(p.a, q.a)); }
+    static Vec4 max(Vec4 p, Vec4 q) { return Vec4(std::max(p.x, q.x), std::max(p.y, q.y), std::max(p.z, q.z), std::max(p.a, q.a)); }
+    static Vec4 abs(Vec4 p) { return Vec4(std::fabs(p.x), std::fabs(p.y), std::fabs(p.z), std::fabs(p.a)); }
+    float maxElement() const { return std::max(std::max(x, y), std::max(z, a)); }
+
+    static Vec4 loadUnorm8(const Uint8* p) { return Vec4(p[0], p[1], p[2], p[3]) * (1.0f / 255.0f); }
+    void storeUnorm8(Uint8* p) const {
+        const float c[4] = { x, y, z, a };
+        for (int i = 0; i < 4; ++i) {
+            p[i] = static_cast<Uint8>(std::nearbyint(std::min(1.0f, std::max(0.0f, c[i])) * 255.0f));
+        }
+    }
+    static Vec4 load(const float* p) { return Vec4(p[0], p[1], p[2], p[3]); }
+    void store(float* p) const { p[0] = x; p[1] = y; p[2] = z; p[3] = a; }
+#endif
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_readback.h"
+#include "shader_manager.h"
+
+// Streams frames as uncompressed YUV 4:2:0 in a Y4M container, to a file or to stdout
+// ("-") so an encoder can read it from a pipe. The conversion runs on the GPU into a
+// texture laid out byte for byte like a Y4M frame, which is read back asynchronously and
+// written by a dedicated thread. The video is cropped to a multiple of 8x4 pixels.
+// When the writer falls RECORDING_QUEUE frames behind, submit either drops frames
+// (interactive use) or waits for it (offline rendering).
+class VideoRecorder {
+public:
+    VideoRecorder(const std::string& path, int frameWidth, int frameHeight, int fps, GLuint quadVao, bool dropWhenBehind);
+    // Writes out every submitted frame before closing the stream
+    ~VideoRecorder();
+
+    VideoRecorder(const VideoRecorder&) = delete;
+    VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+    void submit(GLuint frameTexture);
+
+    int getVideoWidth() const { return videoWidth; }
+    int getVideoHeight() const { return videoHeight; }
+    size_t getWrittenFrames() const;
+    size_t getDroppedFrames() const;
+
+private:
+    void writerLoop();
+
+    int videoWidth, videoHeight;
+    size_t frameBytes;
+    GLuint quadVao;
+    bool dropWhenBehind;
+
+    std::unique_ptr<ShaderProgram> yuvShader;
+    GLint yuvFrameLoc, yuvVideoSizeLoc;
+    GLuint packedTexture, fbo;
+    std::unique_ptr<FrameReadback> readback;
+
+    FILE* output;
+    bool ownsOutput;
+    std::thread writer;
+    std::deque<std::vector<Uint8>> queue;
+    std::vector<std::vector<Uint8>> freeBuffers;
+    bool stopping;
+    bool failed;
+    size_t writtenFrames;
+    size_t droppedFrames;
+    mutable std::mutex mutex;
+    std::condition_variable frameAvailable;
+    std::condition_variable spaceAvailable;
+};
@@ -0,0 +1,549 @@
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "fractal_manager.h"
+#include "headless_context.h"
+#include "math_utils.h"
+#include "screen_animator.h"
+#include "screen_manager.h"
+#include "screen_store.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    enum class ScaleDistribution { Fixed, Uniform, LogUniform };
+    enum class RotationMode { None, Random, Quarter };
+
+    struct Resolution {
+        int width, height;
+    };
+
+    struct Options {
+        std::vector<int> screenCounts = { 1, 10, 100, 1000, 10000, 100000 };
+        std::vector<Resolution> resolutions = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+        ScaleDistribution scale = ScaleDistribution::LogUniform;
+        float minScale = 0.01f;
+        float maxScale = 0.5f;
+        RotationMode rotation = RotationMode::Random;
+        uint32_t seed = 1;
+        int frames = 30;
+        // A render case stops early once it has a few frames and has used this much time
+        double maxSecondsPerCase = 5.0;
+        int queries = 100000;
+        std::string outputPath;
+        bool skipRender = false;
+    };
+
+    struct Summary {
+        size_t samples;
+        double mean, p50, p90, p99, min, max;
+    };
+
+    struct Result {
+        std::string benchmark;
+        // Extra JSON members, already formatted, e.g. "\"screens\": 100"
+        std::string parameters;
+        std::string unit;
+        Summary summary;
+    };
+
+    const char* scaleName(ScaleDistribution scale) {
+        switch (scale) {
+        case ScaleDistribution::Fixed: return "fixed";
+        case ScaleDistribution::Uniform: return "uniform";
+        default: return "log";
+        }
+    }
+
+    const char* rotationName(RotationMode rotation) {
+        switch (rotation) {
+        case RotationMode::None: return "none";
+        case RotationMode::Quarter: return "quarter";
+        default: return "random";
+        }
+    }
+
+    ScaleDistribution parseScale(const std::string& value) {
+        if (value == "fixed") return ScaleDistribution::Fixed;
+        if (value == "uniform") return ScaleDistribution::Uniform;
+        if (value == "log") return ScaleDistribution::LogUniform;
+        throw std::invalid_argument("Unknown scale distribution " + value);
+    }
+
+    RotationMode parseRotation(const std::string& value) {
+        if (value == "none") return RotationMode::None;
+        if (value == "random") return RotationMode::Random;
+        if (value == "quarter") return RotationMode::Quarter;
+        throw std::invalid_argument("Unknown rotation mode " + value);
+    }
+
+    std::vector<std::string> splitList(const std::string& value) {
+        std::vector<std::string> items;
+        std::stringstream stream(value);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+        }
+        if (items.empty()) {
+            throw std::invalid_argument("Empty list " + value);
+        }
+        return items;
+    }
+
+    Resolution parseResolution(const std::string& value) {
+        size_t x = value.find('x');
+        if (x == std::string::npos) {
+            throw std::invalid_argument("Resolutions look like 1920x1080, not " + value);
+        }
+        Resolution resolution = { std::stoi(value.substr(0, x)), std::stoi(value.substr(x + 1)) };
+        if (resolution.width <= 0 || resolution.height <= 0) {
+            throw std::invalid_argument("Resolution must be positive: " + value);
+        }
+        return resolution;
+    }
+
+    void printUsage() {
+        std::cerr << "Usage: fractus_bench [--screens N,N,...] [--resolutions WxH,WxH,...] [--frames N] [--max-seconds S]\n"
+                  << "                     [--scale fixed|uniform|log] [--min-scale F] [--max-scale F]\n"
+                  << "                     [--rotation none|random|quarter] [--seed N] [--queries N]\n"
+                  << "                     [--skip-render] [--output <file.json>]\n";
+    }
+
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--skip-render") {
+                options.skipRender = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--screens") {
+                options.screenCounts.clear();
+                for (const std::string& item : splitList(value)) {
+                    options.screenCounts.push_back(std::stoi(item));
+                }
+            }
+            else if (arg == "--resolutions") {
+                options.resolutions.clear();
+                for (const std::string& item : splitList(value)) {
+                    options.resolutions.push_back(parseResolution(item));
+                }
+            }
+            else if (arg == "--frames") options.frames = std::stoi(value);
+            else if (arg == "--max-seconds") options.maxSecondsPerCase = std::stod(value);
+            else if (arg == "--scale") options.scale = parseScale(value);
+            else if (arg == "--min-scale") options.minScale = std::stof(value);
+            else if (arg == "--max-scale") options.maxScale = std::stof(value);
+            else if (arg == "--rotation") options.rotation = parseRotation(value);
+            else if (arg == "--seed") options.seed = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--queries") options.queries = std::stoi(value);
+            else if (arg == "--output") options.outputPath = value;
+            else throw std::invalid_argument("Unknown option " + arg);
+        }
+        for (int count : options.screenCounts) {
+            if (count < 0) {
+                throw std::invalid_argument("Screen counts must not be negative");
+            }
+        }
+        if (options.frames <= 0 || options.queries <= 0 || options.minScale <= 0.0f || options.maxScale < options.minScale) {
+            throw std::invalid_argument("Frames, queries and scales must be positive, with min-scale <= max-scale");
+        }
+        return options;
+    }
+
+    // Screens keep the frame's aspect ratio like interactive ones; scale is the fraction of the
+    // frame's size, drawn from the chosen distribution
+    std::vector<Screen> generateScene(const Options& options, int screenCount, int width, int height) {
+        std::mt19937 random(options.seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<Screen> screens;
+        screens.reserve(screenCount);
+        for (int i = 0; i < screenCount; ++i) {
+            float scale = Config::INITIAL_SCREEN_SIZE_RATIO;
+            if (options.scale == ScaleDistribution::Uniform) {
+                scale = options.minScale + unit(random) * (options.maxScale - options.minScale);
+            }
+            else if (options.scale == ScaleDistribution::LogUniform) {
+                scale = options.minScale * std::pow(options.maxScale / options.minScale, unit(random));
+            }
+
+            float rotation = 0.0f;
+            if (options.rotation == RotationMode::Random) {
+                rotation = unit(random) * 360.0f;
+            }
+            else if (options.rotation == RotationMode::Quarter) {
+                rotation = 90.0f * static_cast<int>(unit(random) * 4.0f);
+            }
+
+            Uint8 r, g, b;
+            MathUtils::hsvToRgb(unit(random), 0.8f, 1.0f, r, g, b);
+            float x = unit(random) * width;
+            float y = unit(random) * height;
+            screens.emplace_back(x, y, std::max(1, static_cast<int>(scale * width)), std::max(1, static_cast<int>(scale * height)),
+                rotation, SDL_Color{ r, g, b, Config::DEFAULT_SCREEN_COLOR.a });
+        }
+        return screens;
+    }
+
+    Summary summarize(std::vector<double> samples) {
+        Summary summary = {};
+        summary.samples = samples.size();
+        if (samples.empty()) {
+            return summary;
+        }
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&](double p) {
+            return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+        };
+        double total = 0.0;
+        for (double sample : samples) {
+            total += sample;
+        }
+        summary.mean = total / samples.size();
+        summary.p50 = percentile(0.50);
+        summary.p90 = percentile(0.90);
+        summary.p99 = percentile(0.99);
+        summary.min = samples.front();
+        summary.max = samples.back();
+        return summary;
+    }
+
+    double nanosecondsSince(Clock::time_point start, size_t operations) {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / operations;
+    }
+
+    // Keeps the optimizer from dropping microbenchmark results
+    volatile double sink;
+
+    // Runs body(batchSize) repeatedly; each sample is the mean nanoseconds per operation of one batch
+    template <typename Body>
+    Summary timeBatches(int batches, size_t batchSize, Body body) {
+        body(batchSize);
+        std::vector<double> samples;
+        samples.reserve(batches);
+        for (int i = 0; i < batches; ++i) {
+            Clock::time_point start = Clock::now();
+            body(batchSize);
+            samples.push_back(nanosecondsSince(start, batchSize));
+        }
+        return summarize(std::move(samples));
+    }
+
+    std::string resolutionParameters(int width, int height) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "\"width\": %d, \"height\": %d", width, height);
+        return text;
+    }
+
+    // processFrame with a new revision every frame, as while the user edits: convergence never
+    // skips a pass, but the store is clean so only compositing is timed, not instance uploads
+    void benchmarkRender(const Options& options, std::vector<Result>& results) {
+        HeadlessContext context;
+        for (const Resolution& resolution : options.resolutions) {
+            glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(resolution.width), static_cast<float>(resolution.height), 0.0f, -1.0f, 1.0f);
+            for (int count : options.screenCounts) {
+                ScreenStore store;
+                store.assign(generateScene(options, count, resolution.width, resolution.height));
+
+                FractalManager fractalManager(resolution.width, resolution.height, projection);
+                fractalManager.setAdaptiveIterations(false);
+                fractalManager.processFrame(store, 0, 0);
+                glFinish();
+                store.clearDirty();
+
+                std::vector<double> samples;
+                Clock::time_point caseStart = Clock::now();
+                for (int frame = 1; frame <= options.frames; ++frame) {
+                    Clock::time_point start = Clock::now();
+                    fractalManager.processFrame(store, frame, frame);
+                    glFinish();
+                    samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+                    if (samples.size() >= 3 && std::chrono::duration<double>(Clock::now() - caseStart).count() > options.maxSecondsPerCase) {
+                        break;
+                    }
+                }
+
+                char parameters[160];
+                std::snprintf(parameters, sizeof(parameters), "%s, \"screens\": %d, \"iterationsPerFrame\": %d",
+                    resolutionParameters(resolution.width, resolution.height).c_str(), count, fractalManager.getIterationsPerFrame());
+                results.push_back({ "processFrame", parameters, "ms/frame", summarize(std::move(samples)) });
+                std::cerr << "processFrame " << resolution.width << "x" << resolution.height << " " << count << " screens done" << std::endl;
+            }
+        }
+    }
+
+    void benchmarkHitTesting(const Options& options, std::vector<Result>& results) {
+        const Resolution resolution = { 1920, 1080 };
+        for (int count : options.screenCounts) {
+            ScreenManager screenManager(resolution.width, resolution.height);
+            screenManager.setScreens(generateScene(options, count, resolution.width, resolution.height));
+
+            std::mt19937 random(options.seed + 1);
+            std::uniform_real_distribution<float> x(0.0f, static_cast<float>(resolution.width));
+            std::uniform_real_distribution<float> y(0.0f, static_cast<float>(resolution.height));
+            std::vector<SDL_FPoint> points(options.queries);
+            for (SDL_FPoint& point : points) {
+                point = { x(random), y(random) };
+            }
+
+            const size_t batchSize = 256;
+            size_t next = 0;
+            Summary summary = timeBatches(std::max(1, options.queries / static_cast<int>(batchSize)), batchSize, [&](size_t n) {
+                uint32_t hits = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    hits += screenManager.handleSelection(points[next]).slot != UINT32_MAX;
+                    next = (next + 1) % points.size();
+                }
+                sink = hits;
+            });
+
+            char parameters[128];
+            std::snprintf(parameters, sizeof(parameters), "%s, \"screens\": %d",
+                resolutionParameters(resolution.width, resolution.height).c_str(), count);
+            results.push_back({ "hitTest", parameters, "ns/query", summary });
+        }
+    }
+
+    // One frame of keyframe playback: every screen animates x, y, width, rotation and alpha
+    // through eight looping keys, with the easings mixed across tracks
+    void benchmarkAnimation(const Options& options, std::vector<Result>& results) {
+        const Resolution resolution = { 1920, 1080 };
+        const ScreenField fields[] = { ScreenField::X, ScreenField::Y, ScreenField::Width, ScreenField::Rotation, ScreenField::Alpha };
+        const Easing easings[] = { Easing::Linear, Easing::Cosine, Easing::Smootherstep, Easing::CatmullRom, Easing::Hermite };
+        for (int count : options.screenCounts) {
+            ScreenStore store;
+            store.assign(generateScene(options, count, resolution.width, resolution.height));
+
+            std::mt19937 random(options.seed + 2);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            ScreenAnimator animator;
+            for (uint32_t i = 0; i < store.size(); ++i) {
+                for (size_t f = 0; f < 5; ++f) {
+                    float range = f == 3 ? 360.0f : f == 4 ? Config::MAX_SCREEN_ALPHA : static_cast<float>(resolution.width);
+                    std::vector<Keyframe> keys;
+                    for (int k = 0; k < 8; ++k) {
+                        keys.push_back({ k * 0.5 + unit(random) * 0.25, unit(random) * range, easings[(i + f + k) % 5], unit(random) * range });
+                    }
+                    animator.setTrack(store.handleAt(i), fields[f], std::move(keys), true);
+                }
+            }
+
+            animator.apply(0.0, store);
+            std::vector<double> samples;
+            for (int frame = 1; frame <= std::max(3, options.frames); ++frame) {
+                Clock::time_point start = Clock::now();
+                animator.apply(static_cast<double>(frame) / Config::FPS, store);
+                samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+                store.clearDirty();
+            }
+
+            char parameters[96];
+            std::snprintf(parameters, sizeof(parameters), "\"screens\": %d, \"tracks\": %zu", count, animator.getTrackCount());
+            results.push_back({ "animationApply", parameters, "ms/frame", summarize(std::move(samples)) });
+        }
+    }
+
+    void benchmarkColors(std::vector<Result>& results) {
+        const size_t count = 4096;
+        std::mt19937 random(7);
+        std::vector<SDL_Color> colors(count);
+        std::vector<float> hues(count), saturations(count), values(count);
+        for (size_t i = 0; i < count; ++i) {
+            colors[i] = { static_cast<Uint8>(random()), static_cast<Uint8>(random()), static_cast<Uint8>(random()), 255 };
+            MathUtils::rgbToHsv(colors[i].r, colors[i].g, colors[i].b, hues[i], saturations[i], values[i]);
+        }
+
+        results.push_back({ "rgbToHsv", "\"colors\": 4096", "ns/color", timeBatches(200, count, [&](size_t n) {
+            float total = 0.0f;
+            for (size_t i = 0; i < n; ++i) {
+                float h, s, v;
+                MathUtils::rgbToHsv(colors[i].r, colors[i].g, colors[i].b, h, s, v);
+                total += h + s + v;
+            }
+            sink = total;
+        }) });
+        results.push_back({ "hsvToRgb", "\"colors\": 4096", "ns/color", timeBatches(200, count, [&](size_t n) {
+            unsigned total = 0;
+            for (size_t i = 0; i < n; ++i) {
+                Uint8 r, g, b;
+                MathUtils::hsvToRgb(hues[i], saturations[i], values[i], r, g, b);
+                total += r + g + b;
+            }
+            sink = total;
+        }) });
+
+        // Batch kernels, with their largest deviation from the scalar functions above
+        std::vector<float> batchHues(count), batchSaturations(count), batchValues(count);
+        MathUtils::rgbToHsv(colors.data(), batchHues.data(), batchSaturations.data(), batchValues.data(), count);
+        float hsvError = 0.0f;
+        for (size_t i = 0; i < count; ++i) {
+            hsvError = std::max({ hsvError, std::fabs(batchHues[i] - hues[i]), std::fabs(batchSaturations[i] - saturations[i]),
+                std::fabs(batchValues[i] - values[i]) });
+        }
+        std::vector<SDL_Color> batchColors(count);
+        MathUtils::hsvToRgb(hues.data(), saturations.data(), values.data(), batchColors.data(), count);
+        int rgbError = 0;
+        for (size_t i = 0; i < count; ++i) {
+            Uint8 r, g, b;
+            MathUtils::hsvToRgb(hues[i], saturations[i], values[i], r, g, b);
+            rgbError = std::max({ rgbError, std::abs(r - batchColors[i].r), std::abs(g - batchColors[i].g), std::abs(b - batchColors[i].b) });
+        }
+
+        char parameters[64];
+        std::snprintf(parameters, sizeof(parameters), "\"colors\": 4096, \"maxError\": %g", hsvError);
+        results.push_back({ "rgbToHsvBatch", parameters, "ns/color", timeBatches(200, count, [&](size_t n) {
+            MathUtils::rgbToHsv(colors.data(), batchHues.data(), batchSaturations.data(), batchValues.data(), n);
+            sink = batchHues[n - 1];
+        }) });
+        std::snprintf(parameters, sizeof(parameters), "\"colors\": 4096, \"maxError\": %d", rgbError);
+        results.push_back({ "hsvToRgbBatch", parameters, "ns/color", timeBatches(200, count, [&](size_t n) {
+            MathUtils::hsvToRgb(hues.data(), saturations.data(), values.data(), batchColors.data(), n);
+            sink = batchColors[n - 1].r;
+        }) });
+    }
+
+    void benchmarkInterpolation(std::vector<Result>& results) {
+        const size_t count = 4096;
+        std::vector<double> t(count);
+        for (size_t i = 0; i < count; ++i) {
+            t[i] = static_cast<double>(i) / count;
+        }
+
+        auto pointwise = [&](const char* name, double (*function)(double, double, double, double, double)) {
+            results.push_back({ name, "\"points\": 4", "ns/eval", timeBatches(200, count, [&](size_t n) {
+                double total = 0.0;
+                for (size_t i = 0; i < n; ++i) {
+                    total += function(0.1, 0.7, 0.4, 0.9, t[i]);
+                }
+                sink = total;
+            }) });
+        };
+        pointwise("cubicInterpolate", MathUtils::cubicInterpolate);
+        pointwise("catmullRomInterpolate", MathUtils::catmullRomInterpolate);
+
+        // Node-based schemes over Chebyshev nodes of sin(2 pi x) on [0, 1]
+        for (int nodes : { 8, 32 }) {
+            std::vector<double> x = MathUtils::chebyshevNodes(nodes, 0.0, 1.0);
+            std::vector<double> y(x.size());
+            for (size_t i = 0; i < x.size(); ++i) {
+                y[i] = std::sin(2.0 * Config::PI * x[i]);
+            }
+            std::vector<double> weights = MathUtils::chebyshevWeights(x);
+            char parameters[32];
+            std::snprintf(parameters, sizeof(parameters), "\"points\": %d", nodes);
+
+            results.push_back({ "lagrangeInterpolate", parameters, "ns/eval", timeBatches(50, count, [&](size_t n) {
+                double total = 0.0;
+                for (size_t i = 0; i < n; ++i) {
+                    total += MathUtils::lagrangeInterpolate(x, y, t[i]);
+                }
+                sink = total;
+            }) });
+            results.push_back({ "newtonInterpolate", parameters, "ns/eval", timeBatches(50, count / 16, [&](size_t n) {
+                double total = 0.0;
+                for (size_t i = 0; i < n; ++i) {
+                    total += MathUtils::newtonInterpolate(x, y, t[i * 16]);
+                }
+                sink = total;
+            }) });
+            results.push_back({ "barycentricInterpolate", parameters, "ns/eval", timeBatches(50, count, [&](size_t n) {
+                double total = 0.0;
+                for (size_t i = 0; i < n; ++i) {
+                    total += MathUtils::barycentricInterpolate(x, y, weights, t[i]);
+                }
+                sink = total;
+            }) });
+
+            // Precomputed interpolants, batch-evaluated into one buffer
+            std::vector<double> out(count);
+            MathUtils::NewtonPolynomial newton(x, y);
+            results.push_back({ "NewtonPolynomial", parameters, "ns/eval", timeBatches(200, count, [&](size_t n) {
+                newton.evaluate(t.data(), out.data(), n);
+                sink = out[n - 1];
+            }) });
+            MathUtils::BarycentricInterpolant barycentric(x, y, weights);
+            results.push_back({ "BarycentricInterpolant", parameters, "ns/eval", timeBatches(200, count, [&](size_t n) {
+                barycentric.evaluate(t.data(), out.data(), n);
+                sink = out[n - 1];
+            }) });
+            // Spline knots must ascend; chebyshevNodes come out descending
+            std::vector<double> knots(x.rbegin(), x.rend()), knotValues(y.rbegin(), y.rend());
+            MathUtils::CubicSpline spline(knots, knotValues);
+            results.push_back({ "CubicSpline", parameters, "ns/eval", timeBatches(200, count, [&](size_t n) {
+                spline.evaluate(t.data(), out.data(), n);
+                sink = out[n - 1];
+            }) });
+        }
+    }
+
+    void writeJson(std::FILE* file, const Options& options, const std::vector<Result>& results) {
+        std::fprintf(file, "{\n  \"version\": 1,\n");
+        std::fprintf(file, "  \"scene\": { \"scale\": \"%s\", \"minScale\": %g, \"maxScale\": %g, \"rotation\": \"%s\", \"seed\": %u },\n",
+            scaleName(options.scale), options.minScale, options.maxScale, rotationName(options.rotation), options.seed);
+        std::fprintf(file, "  \"results\": [\n");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            const Summary& s = result.summary;
+            std::fprintf(file, "    { \"benchmark\": \"%s\", %s, \"unit\": \"%s\", \"samples\": %zu, "
+                "\"mean\": %.6g, \"p50\": %.6g, \"p90\": %.6g, \"p99\": %.6g, \"min\": %.6g, \"max\": %.6g }%s\n",
+                result.benchmark.c_str(), result.parameters.c_str(), result.unit.c_str(), s.samples,
+                s.mean, s.p50, s.p90, s.p99, s.min, s.max, i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(file, "  ]\n}\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    try {
+        std::vector<Result> results;
+        benchmarkColors(results);
+        benchmarkInterpolation(results);
+        benchmarkHitTesting(options, results);
+        benchmarkAnimation(options, results);
+        if (!options.skipRender) {
+            benchmarkRender(options, results);
+        }
+
+        std::FILE* file = options.outputPath.empty() ? stdout : std::fopen(options.outputPath.c_str(), "w");
+        if (!file) {
+            throw std::runtime_error("Failed to open " + options.outputPath);
+        }
+        writeJson(file, options, results);
+        if (file != stdout) {
+            std::fclose(file);
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,241 @@
+#include "chaos_game.h"
+#include "screen_instance.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr float COLOR_SCALE = 1023.0f;
+
+    // Orbit colors are blends of screen colors, so they stay within [0, 1]
+    uint32_t packColor(float r, float g, float b) {
+        auto channel = [](float value) {
+            return static_cast<uint32_t>(value * COLOR_SCALE + 0.5f);
+        };
+        return channel(r) | channel(g) << 10 | channel(b) << 20;
+    }
+}
+
+namespace IfsMaps {
+    void build(const std::vector<ScreenInstance>& screens, int frameWidth, int frameHeight, float colorTime,
+        std::vector<IfsMap>& maps, std::vector<float>& cumulativeWeights) {
+        maps.clear();
+        cumulativeWeights.clear();
+        float totalWeight = 0.0f;
+        for (const ScreenInstance& screen : screens) {
+            if (screen.width * screen.height < 1.0f) {
+                continue;
+            }
+            // Same placement as COMPOSITE_VERTEX: frame pixel (px, py) lands at
+            // (x, y) + rotate(180 - r) * (width * (0.5 - px / W), -height * (py / H - 0.5))
+            float angle = static_cast<float>((180.0 - screen.rotation) * Config::PI / 180.0);
+            float c = std::cos(angle);
+            float s = std::sin(angle);
+            IfsMap map;
+            map.xx = -c * screen.width / frameWidth;
+            map.xy = -s * screen.height / frameHeight;
+            map.xOffset = screen.x + 0.5f * (c * screen.width + s * screen.height);
+            map.yx = s * screen.width / frameWidth;
+            map.yy = -c * screen.height / frameHeight;
+            map.yOffset = screen.y + 0.5f * (c * screen.height - s * screen.width);
+            // Hue and saturation edits live in the animation phases, so even a still color goes through it
+            SDL_Color color = screen.color;
+            if ((screen.colorAnimation[0] | screen.colorAnimation[1]) != 0) {
+                color = screen.getColorAnimation().apply(color, colorTime);
+            }
+            map.alpha = color.a / 255.0f;
+            map.r = color.r / 255.0f;
+            map.g = color.g / 255.0f;
+            map.b = color.b / 255.0f;
+            maps.push_back(map);
+
+            // Transparent screens still copy the frame in the feedback pass, so they keep a small weight
+            totalWeight += std::max(map.alpha, 1.0f / 255.0f) * screen.width * screen.height;
+            cumulativeWeights.push_back(totalWeight);
+        }
+    }
+
+    size_t pick(const std::vector<float>& cumulativeWeights, float unit) {
+        float target = unit * cumulativeWeights.back();
+        size_t index = std::upper_bound(cumulativeWeights.begin(), cumulativeWeights.end(), target) - cumulativeWeights.begin();
+        return std::min(index, cumulativeWeights.size() - 1);
+    }
+}
+
+ChaosGame::ChaosGame(int width, int height, ThreadPool& pool)
+    : width(width), height(height), pool(pool), sampleCount(0) {
+    static_assert(Config::CHAOS_SAMPLE_LIMIT < (1ULL << 32) - Config::CHAOS_SAMPLES_PER_FRAME, "Chaos-game bin counts are 32-bit");
+    int streamCount = std::max(1, std::min(pool.getThreadCount(), Config::CHAOS_MAX_STREAMS));
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    // A few bands per worker so the merge balances even when points cluster, each a power of
+    // two pixels long so finding a point's band is a shift
+    size_t targetBands = static_cast<size_t>(streamCount) * 4;
+    bandShift = 0;
+    while ((pixelCount >> bandShift) > targetBands) {
+        ++bandShift;
+    }
+    size_t bandPixels = size_t(1) << bandShift;
+    bandCount = (pixelCount + bandPixels - 1) / bandPixels;
+
+    streams.resize(streamCount);
+    for (int i = 0; i < streamCount; ++i) {
+        Stream& stream = streams[i];
+        stream.random = ChaosRandom(0, i);
+        stream.samples.resize(Config::CHAOS_BATCH_SAMPLES);
+        stream.sorted.resize(Config::CHAOS_BATCH_SAMPLES);
+        stream.bandStarts.resize(bandCount + 1);
+        restart(stream);
+    }
+    bins.resize(pixelCount);
+    rowMaxima.resize(height);
+    pixels.resize(pixelCount * 4);
+}
+
+void ChaosGame::setScreens(const std::vector<ScreenInstance>& screens, float colorTime) {
+    IfsMaps::build(screens, width, height, colorTime, maps, cumulativeWeights);
+
+    pool.parallelFor(bandCount, [&](size_t band, int) {
+        size_t begin = band << bandShift;
+        size_t end = std::min(begin + (size_t(1) << bandShift), bins.size());
+        std::fill(bins.begin() + begin, bins.begin() + end, Bin{ 0.0, 0.0, 0.0, 0 });
+    });
+    for (Stream& stream : streams) {
+        restart(stream);
+    }
+    sampleCount = 0;
+}
+
+void ChaosGame::iterate(uint64_t samples) {
+    if (maps.empty()) {
+        return;
+    }
+    uint64_t share = samples / streams.size();
+    for (uint64_t done = 0; done < share; done += Config::CHAOS_BATCH_SAMPLES) {
+        uint64_t batch = std::min<uint64_t>(share - done, Config::CHAOS_BATCH_SAMPLES);
+        pool.parallelFor(streams.size(), [&](size_t index, int) {
+            run(streams[index], batch);
+        });
+        pool.parallelFor(bandCount, [&](size_t band, int) {
+            merge(band);
+        });
+    }
+    sampleCount += share * streams.size();
+}
+
+void ChaosGame::restart(Stream& stream) {
+    stream.x = stream.random.unit() * width;
+    stream.y = stream.random.unit() * height;
+    stream.r = stream.g = stream.b = 0.0f;
+    stream.warmup = Config::CHAOS_WARMUP_ITERATIONS;
+}
+
+void ChaosGame::run(Stream& stream, uint64_t samples) {
+    const float limit = 4.0f * std::max(width, height);
+    Sample* plotted = stream.samples.data();
+    size_t plottedCount = 0;
+
+    for (uint64_t i = 0; i < samples; ++i) {
+        const IfsMap& map = maps[IfsMaps::pick(cumulativeWeights, stream.random.unit())];
+
+        float x = map.xx * stream.x + map.xy * stream.y + map.xOffset;
+        float y = map.yx * stream.x + map.yy * stream.y + map.yOffset;
+        stream.x = x;
+        stream.y = y;
+        stream.r += (map.r - stream.r) * map.alpha;
+        stream.g += (map.g - stream.g) * map.alpha;
+        stream.b += (map.b - stream.b) * map.alpha;
+
+        // Screens larger than the frame expand, so an orbit can run away
+        if (!(std::fabs(x) < limit && std::fabs(y) < limit)) {
+            restart(stream);
+            continue;
+        }
+        if (stream.warmup > 0) {
+            --stream.warmup;
+            continue;
+        }
+        if (x < 0.0f || y < 0.0f || x >= width || y >= height) {
+            continue;
+        }
+        uint32_t pixel = static_cast<uint32_t>(static_cast<size_t>(y) * width + static_cast<size_t>(x));
+        plotted[plottedCount++] = { pixel, packColor(stream.r, stream.g, stream.b) };
+    }
+
+    // Counting sort by band, so each band's merge reads one contiguous run per stream
+    std::vector<uint32_t>& starts = stream.bandStarts;
+    std::fill(starts.begin(), starts.end(), 0);
+    for (size_t i = 0; i < plottedCount; ++i) {
+        ++starts[(plotted[i].pixel >> bandShift) + 1];
+    }
+    for (size_t band = 0; band < bandCount; ++band) {
+        starts[band + 1] += starts[band];
+    }
+    for (size_t i = 0; i < plottedCount; ++i) {
+        stream.sorted[starts[plotted[i].pixel >> bandShift]++] = plotted[i];
+    }
+    // The scatter advanced every start to the next band's; shift them back
+    for (size_t band = bandCount; band > 0; --band) {
+        starts[band] = starts[band - 1];
+    }
+    starts[0] = 0;
+}
+
+void ChaosGame::merge(size_t band) {
+    constexpr double toUnit = 1.0 / COLOR_SCALE;
+    for (const Stream& stream : streams) {
+        for (uint32_t i = stream.bandStarts[band]; i < stream.bandStarts[band + 1]; ++i) {
+            const Sample& sample = stream.sorted[i];
+            Bin& bin = bins[sample.pixel];
+            bin.r += (sample.color & 1023) * toUnit;
+            bin.g += (sample.color >> 10 & 1023) * toUnit;
+            bin.b += (sample.color >> 20 & 1023) * toUnit;
+            ++bin.count;
+        }
+    }
+}
+
+void ChaosGame::resolve(std::vector<Uint8>& rgba) {
+    pool.parallelFor(static_cast<size_t>(height), [&](size_t row, int) {
+        uint32_t rowMax = 0;
+        size_t start = row * width;
+        for (size_t p = start; p < start + width; ++p) {
+            rowMax = std::max(rowMax, bins[p].count);
+        }
+        rowMaxima[row] = rowMax;
+    });
+    uint32_t maxCount = *std::max_element(rowMaxima.begin(), rowMaxima.end());
+
+    rgba.resize(static_cast<size_t>(width) * height * 4);
+    if (maxCount == 0) {
+        std::fill(rgba.begin(), rgba.end(), 0);
+        return;
+    }
+
+    // Log density keeps the sparse outer branches visible next to the dense core
+    const float inverseLogMax = 1.0f / std::log1p(static_cast<float>(maxCount));
+    const float inverseGamma = 1.0f / Config::CHAOS_GAMMA;
+    pool.parallelFor(static_cast<size_t>(height), [&](size_t row, int) {
+        size_t start = row * width;
+        for (size_t p = start; p < start + width; ++p) {
+            const Bin& sum = bins[p];
+            Uint8* out = &rgba[p * 4];
+            if (sum.count == 0) {
+                out[0] = out[1] = out[2] = out[3] = 0;
+                continue;
+            }
+            float brightness = std::pow(std::log1p(static_cast<float>(sum.count)) * inverseLogMax, inverseGamma);
+            double scale = brightness / sum.count;
+            out[0] = static_cast<Uint8>(std::min(sum.r * scale, 1.0) * 255.0 + 0.5);
+            out[1] = static_cast<Uint8>(std::min(sum.g * scale, 1.0) * 255.0 + 0.5);
+            out[2] = static_cast<Uint8>(std::min(sum.b * scale, 1.0) * 255.0 + 0.5);
+            out[3] = static_cast<Uint8>(brightness * 255.0f + 0.5f);
+        }
+    });
+}
+
+void ChaosGame::upload(GLuint texture) {
+    resolve(pixels);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,154 @@
+#include "convergence_detector.h"
+#include "config.h"
+#include "shader_sources.h"
+#include <algorithm>
+
+namespace {
+    constexpr size_t READBACK_RING_SIZE = 3;
+    constexpr int REDUCTION_FACTOR = 4;
+}
+
+ConvergenceDetector::ConvergenceDetector(int width, int height)
+    : nextReadback(0), trackedRevision(0), stableCount(0), lastDelta(1.0f) {
+    diffShader = std::make_unique<ShaderProgram>(ShaderSources::FULLSCREEN_VERTEX, ShaderSources::DIFF_FRAGMENT);
+    reduceShader = std::make_unique<ShaderProgram>(ShaderSources::FULLSCREEN_VERTEX, ShaderSources::REDUCE_MAX_FRAGMENT);
+    diffNewerLoc = diffShader->getUniformLocation("newerFrame");
+    diffOlderLoc = diffShader->getUniformLocation("olderFrame");
+    reduceSourceLoc = reduceShader->getUniformLocation("source");
+
+    int w = width;
+    int h = height;
+    do {
+        w = std::max(1, (w + REDUCTION_FACTOR - 1) / REDUCTION_FACTOR);
+        h = std::max(1, (h + REDUCTION_FACTOR - 1) / REDUCTION_FACTOR);
+
+        GLuint level;
+        glGenTextures(1, &level);
+        glBindTexture(GL_TEXTURE_2D, level);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        levels.push_back(level);
+        levelWidths.push_back(w);
+        levelHeights.push_back(h);
+    } while (w > 1 || h > 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo);
+
+    readbacks.resize(READBACK_RING_SIZE);
+    for (auto& readback : readbacks) {
+        glGenBuffers(1, &readback.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float), nullptr, GL_STREAM_READ);
+        readback.fence = nullptr;
+        readback.revision = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+ConvergenceDetector::~ConvergenceDetector() {
+    for (auto& readback : readbacks) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+        }
+        glDeleteBuffers(1, &readback.pbo);
+    }
+    glDeleteTextures(static_cast<GLsizei>(levels.size()), levels.data());
+    glDeleteFramebuffers(1, &fbo);
+}
+
+void ConvergenceDetector::submit(GLuint newerFrame, GLuint olderFrame, GLuint quadVao, unsigned int sceneRevision) {
+    Readback& readback = readbacks[nextReadback];
+    if (readback.fence) {
+        // Every slot is still in flight; skip this measurement rather than stall
+        return;
+    }
+
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glBindVertexArray(quadVao);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (size_t i = 0; i < levels.size(); ++i) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, levels[i], 0);
+        glViewport(0, 0, levelWidths[i], levelHeights[i]);
+        if (i == 0) {
+            diffShader->use();
+            glUniform1i(diffNewerLoc, 0);
+            glUniform1i(diffOlderLoc, 1);
+            glBindTexture(GL_TEXTURE_2D, newerFrame);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, olderFrame);
+            glActiveTexture(GL_TEXTURE0);
+        }
+        else {
+            reduceShader->use();
+            glUniform1i(reduceSourceLoc, 0);
+            glBindTexture(GL_TEXTURE_2D, levels[i - 1]);
+        }
+        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glReadPixels(0, 0, 1, 1, GL_RED, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.revision = sceneRevision;
+    nextReadback = (nextReadback + 1) % readbacks.size();
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glEnable(GL_BLEND);
+}
+
+void ConvergenceDetector::collect() {
+    // Oldest submission first so the stable count sees measurements in order
+    for (size_t i = 0; i < readbacks.size(); ++i) {
+        Readback& readback = readbacks[(nextReadback + i) % readbacks.size()];
+        if (!readback.fence) {
+            continue;
+        }
+        if (glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        const float* delta = static_cast<const float*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(float), GL_MAP_READ_BIT));
+        if (delta) {
+            if (readback.revision == trackedRevision) {
+                lastDelta = *delta;
+                stableCount = lastDelta < Config::CONVERGENCE_THRESHOLD ? stableCount + 1 : 0;
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
+
+bool ConvergenceDetector::isConverged(unsigned int sceneRevision) {
+    if (sceneRevision != trackedRevision) {
+        trackedRevision = sceneRevision;
+        stableCount = 0;
+        lastDelta = 1.0f;
+    }
+    collect();
+    return stableCount >= Config::CONVERGENCE_FRAMES;
+}
+
+void ConvergenceDetector::reset() {
+    for (auto& readback : readbacks) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+            readback.fence = nullptr;
+        }
+    }
+    stableCount = 0;
+    lastDelta = 1.0f;
+}
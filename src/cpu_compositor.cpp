@@ -0,0 +1,291 @@
+#include "cpu_compositor.h"
+#include "screen_instance.h"
+#include "vec4.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    struct Rgba8Pixels {
+        using Storage = Uint8;
+        static constexpr bool QUANTIZED = true;
+        static constexpr GLenum PIXEL_TYPE = GL_UNSIGNED_BYTE;
+        static constexpr Config::AccumulationFormat FORMAT = Config::AccumulationFormat::RGBA8;
+
+        static Vec4 load(const Storage* p) { return Vec4::loadUnorm8(p); }
+        static void store(Storage* p, Vec4 value) { value.storeUnorm8(p); }
+        static Vec4 quantize(Vec4 value) {
+            Uint8 bytes[4];
+            value.storeUnorm8(bytes);
+            return Vec4::loadUnorm8(bytes);
+        }
+    };
+
+    struct Rgba32fPixels {
+        using Storage = float;
+        static constexpr bool QUANTIZED = false;
+        static constexpr GLenum PIXEL_TYPE = GL_FLOAT;
+        static constexpr Config::AccumulationFormat FORMAT = Config::AccumulationFormat::RGBA32F;
+
+        static Vec4 load(const Storage* p) { return Vec4::load(p); }
+        static void store(Storage* p, Vec4 value) { value.store(p); }
+        static Vec4 quantize(Vec4 value) { return value; }
+    };
+
+    // A screen reduced to what the per-pixel loop needs
+    struct ScreenSetup {
+        float x, y;
+        float cosAngle, sinAngle;
+        float inverseWidth, inverseHeight;
+        float minX, minY, maxX, maxY;
+        Vec4 overlay;
+        float keep;
+        int level0, level1;
+        float levelBlend;
+    };
+
+    template <typename Pixels>
+    class TiledCompositor : public CpuCompositor {
+    public:
+        using Storage = typename Pixels::Storage;
+
+        struct Level {
+            int width, height;
+            std::vector<Storage> pixels;
+        };
+
+        TiledCompositor(int width, int height, ThreadPool& pool)
+            : width(width), height(height), pool(pool), current(0) {
+            size_t size = static_cast<size_t>(width) * height * 4;
+            frames[0].assign(size, Storage());
+            frames[1].assign(size, Storage());
+
+            int w = width;
+            int h = height;
+            while (Config::USE_MIPMAPPED_SAMPLING && (w > 1 || h > 1)) {
+                w = std::max(1, w / 2);
+                h = std::max(1, h / 2);
+                mips.push_back({ w, h, std::vector<Storage>(static_cast<size_t>(w) * h * 4) });
+            }
+
+            tileSize = std::max(8, Config::CPU_TILE_SIZE);
+            tilesX = (width + tileSize - 1) / tileSize;
+            tilesY = (height + tileSize - 1) / tileSize;
+            workerDeltas.resize(pool.getThreadCount());
+            workerScreens.resize(pool.getThreadCount());
+        }
+
+        float composite(const std::vector<ScreenInstance>& screens) override {
+            const std::vector<Storage>& source = frames[current];
+            std::vector<Storage>& target = frames[1 - current];
+
+            buildMips(source);
+            setupScreens(screens);
+            std::fill(workerDeltas.begin(), workerDeltas.end(), 0.0f);
+
+            pool.parallelFor(static_cast<size_t>(tilesX) * tilesY, [&](size_t tile, int worker) {
+                compositeTile(static_cast<int>(tile % tilesX), static_cast<int>(tile / tilesX), source, target, worker);
+            });
+
+            current = 1 - current;
+            return *std::max_element(workerDeltas.begin(), workerDeltas.end());
+        }
+
+        void upload(GLuint texture) const override {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, Pixels::PIXEL_TYPE, frames[current].data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        void load(const Uint8* rgba) override {
+            std::vector<Storage>& frame = frames[current];
+            for (size_t i = 0; i < frame.size(); i += 4) {
+                Pixels::store(&frame[i], Vec4::loadUnorm8(rgba + i));
+            }
+        }
+
+        Config::AccumulationFormat getStorageFormat() const override {
+            return Pixels::FORMAT;
+        }
+
+    private:
+        // Box-filtered chain like glGenerateMipmap, one row per task
+        void buildMips(const std::vector<Storage>& source) {
+            const Storage* parent = source.data();
+            int parentWidth = width;
+            int parentHeight = height;
+            for (Level& level : mips) {
+                Storage* child = level.pixels.data();
+                int childWidth = level.width;
+                pool.parallelFor(static_cast<size_t>(level.height), [&](size_t row, int) {
+                    int y0 = std::min(static_cast<int>(row) * 2, parentHeight - 1);
+                    int y1 = std::min(y0 + 1, parentHeight - 1);
+                    const Storage* top = parent + static_cast<size_t>(y0) * parentWidth * 4;
+                    const Storage* bottom = parent + static_cast<size_t>(y1) * parentWidth * 4;
+                    Storage* out = child + row * childWidth * 4;
+                    for (int x = 0; x < childWidth; ++x) {
+                        int x0 = std::min(x * 2, parentWidth - 1) * 4;
+                        int x1 = std::min(x * 2 + 1, parentWidth - 1) * 4;
+                        Vec4 sum = Pixels::load(top + x0) + Pixels::load(top + x1) + Pixels::load(bottom + x0) + Pixels::load(bottom + x1);
+                        Pixels::store(out + x * 4, sum * 0.25f);
+                    }
+                });
+                parent = child;
+                parentWidth = level.width;
+                parentHeight = level.height;
+            }
+        }
+
+        // Mirrors COMPOSITE_VERTEX: rotate by 180 - r about (x, y), flipped horizontally, culled when degenerate
+        void setupScreens(const std::vector<ScreenInstance>& screens) {
+            setups.clear();
+            for (const ScreenInstance& screen : screens) {
+                if (screen.width * screen.height < 1.0f) {
+                    continue;
+                }
+                ScreenSetup setup;
+                float angle = static_cast<float>((180.0 - screen.rotation) * Config::PI / 180.0);
+                setup.x = screen.x;
+                setup.y = screen.y;
+                setup.cosAngle = std::cos(angle);
+                setup.sinAngle = std::sin(angle);
+                setup.inverseWidth = 1.0f / screen.width;
+                setup.inverseHeight = 1.0f / screen.height;
+
+                setup.minX = setup.minY = 1e30f;
+                setup.maxX = setup.maxY = -1e30f;
+                for (int corner = 0; corner < 4; ++corner) {
+                    float lx = screen.width * (0.5f - (corner & 1));
+                    float ly = screen.height * ((corner >> 1) - 0.5f);
+                    float cx = screen.x + setup.cosAngle * lx - setup.sinAngle * ly;
+                    float cy = screen.y - (setup.sinAngle * lx + setup.cosAngle * ly);
+                    setup.minX = std::min(setup.minX, cx);
+                    setup.maxX = std::max(setup.maxX, cx);
+                    setup.minY = std::min(setup.minY, cy);
+                    setup.maxY = std::max(setup.maxY, cy);
+                }
+                if (setup.maxX < 0.0f || setup.maxY < 0.0f || setup.minX > width || setup.minY > height) {
+                    continue;
+                }
+
+                float alpha = screen.color.a / 255.0f;
+                setup.overlay = Vec4(screen.color.r / 255.0f * alpha, screen.color.g / 255.0f * alpha, screen.color.b / 255.0f * alpha, alpha);
+                setup.keep = 1.0f - alpha;
+
+                // Level of detail from the texel footprint of one destination pixel, as the GPU derives it
+                setup.level0 = setup.level1 = 0;
+                setup.levelBlend = 0.0f;
+                if (!mips.empty()) {
+                    float ux = width * setup.cosAngle * setup.inverseWidth;
+                    float vx = height * setup.sinAngle * setup.inverseHeight;
+                    float uy = width * setup.sinAngle * setup.inverseWidth;
+                    float vy = height * setup.cosAngle * setup.inverseHeight;
+                    float rho = std::max(std::sqrt(ux * ux + vx * vx), std::sqrt(uy * uy + vy * vy));
+                    float lod = std::min(std::log2(rho), static_cast<float>(mips.size()));
+                    if (lod > 0.0f) {
+                        setup.level0 = static_cast<int>(lod);
+                        setup.level1 = std::min(setup.level0 + 1, static_cast<int>(mips.size()));
+                        setup.levelBlend = lod - setup.level0;
+                    }
+                }
+                setups.push_back(setup);
+            }
+        }
+
+        Vec4 sampleLevel(int index, const std::vector<Storage>& source, float u, float v) const {
+            const Storage* pixels = index == 0 ? source.data() : mips[index - 1].pixels.data();
+            int w = index == 0 ? width : mips[index - 1].width;
+            int h = index == 0 ? height : mips[index - 1].height;
+
+            float tx = u * w - 0.5f;
+            float ty = v * h - 0.5f;
+            float fx0 = std::floor(tx);
+            float fy0 = std::floor(ty);
+            float fx = tx - fx0;
+            float fy = ty - fy0;
+            int x0 = static_cast<int>(fx0);
+            int y0 = static_cast<int>(fy0);
+            int x1 = std::min(x0 + 1, w - 1);
+            int y1 = std::min(y0 + 1, h - 1);
+            x0 = std::max(x0, 0);
+            y0 = std::max(y0, 0);
+
+            const Storage* row0 = pixels + static_cast<size_t>(y0) * w * 4;
+            const Storage* row1 = pixels + static_cast<size_t>(y1) * w * 4;
+            Vec4 a = Pixels::load(row0 + x0 * 4);
+            Vec4 b = Pixels::load(row0 + x1 * 4);
+            Vec4 c = Pixels::load(row1 + x0 * 4);
+            Vec4 d = Pixels::load(row1 + x1 * 4);
+            Vec4 top = a + (b - a) * fx;
+            Vec4 bottom = c + (d - c) * fx;
+            return top + (bottom - top) * fy;
+        }
+
+        void compositeTile(int tileX, int tileY, const std::vector<Storage>& source, std::vector<Storage>& target, int worker) {
+            int x0 = tileX * tileSize;
+            int y0 = tileY * tileSize;
+            int x1 = std::min(x0 + tileSize, width);
+            int y1 = std::min(y0 + tileSize, height);
+
+            // Screens touching this tile, still in draw order
+            std::vector<const ScreenSetup*>& active = workerScreens[worker];
+            active.clear();
+            for (const ScreenSetup& setup : setups) {
+                if (setup.maxX >= x0 && setup.minX <= x1 && setup.maxY >= y0 && setup.minY <= y1) {
+                    active.push_back(&setup);
+                }
+            }
+
+            float delta = workerDeltas[worker];
+            const Vec4 one(1.0f);
+            for (int y = y0; y < y1; ++y) {
+                const Storage* previousRow = source.data() + static_cast<size_t>(y) * width * 4;
+                Storage* targetRow = target.data() + static_cast<size_t>(y) * width * 4;
+                float py = y + 0.5f;
+                for (int x = x0; x < x1; ++x) {
+                    float px = x + 0.5f;
+                    Vec4 color;
+                    for (const ScreenSetup* setup : active) {
+                        float dx = px - setup->x;
+                        float dy = setup->y - py;
+                        float u = 0.5f - (setup->cosAngle * dx + setup->sinAngle * dy) * setup->inverseWidth;
+                        float v = 0.5f + (setup->cosAngle * dy - setup->sinAngle * dx) * setup->inverseHeight;
+                        if (u < 0.0f || u >= 1.0f || v < 0.0f || v >= 1.0f) {
+                            continue;
+                        }
+
+                        Vec4 texel = sampleLevel(setup->level0, source, u, v);
+                        if (setup->levelBlend > 0.0f) {
+                            texel = texel + (sampleLevel(setup->level1, source, u, v) - texel) * setup->levelBlend;
+                        }
+                        Vec4 fragment = setup->overlay + texel * setup->keep;
+                        color = Pixels::quantize(fragment + color * (one - fragment.wwww()));
+                    }
+
+                    Vec4 previous = Pixels::load(previousRow + x * 4);
+                    delta = std::max(delta, Vec4::abs(color - previous).maxElement());
+                    Pixels::store(targetRow + x * 4, color);
+                }
+            }
+            workerDeltas[worker] = delta;
+        }
+
+        int width, height;
+        ThreadPool& pool;
+        std::vector<Storage> frames[2];
+        int current;
+        std::vector<Level> mips;
+        std::vector<ScreenSetup> setups;
+
+        int tileSize, tilesX, tilesY;
+        std::vector<float> workerDeltas;
+        std::vector<std::vector<const ScreenSetup*>> workerScreens;
+    };
+}
+
+std::unique_ptr<CpuCompositor> CpuCompositor::create(int width, int height, Config::AccumulationFormat format, ThreadPool& pool) {
+    if (format == Config::AccumulationFormat::RGBA8) {
+        return std::make_unique<TiledCompositor<Rgba8Pixels>>(width, height, pool);
+    }
+    return std::make_unique<TiledCompositor<Rgba32fPixels>>(width, height, pool);
+}
@@ -1,19 +1,72 @@
 #include "fractal_manager.h"
+#include "shader_manager.h"
+#include "shader_sources.h"
+#include "image_io.h"
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
-FractalManager::FractalManager(int width, int height, GLuint textureShader, GLuint colorShader, const glm::mat4& projection)
-    : width(width), height(height), textureShaderProgram(textureShader), colorShaderProgram(colorShader) {
+namespace AccumulationFormats {
+    GLenum internalFormat(Config::AccumulationFormat format) {
+        switch (format) {
+        case Config::AccumulationFormat::RGBA16F: return GL_RGBA16F;
+        case Config::AccumulationFormat::R11G11B10F: return GL_R11F_G11F_B10F;
+        case Config::AccumulationFormat::RGBA32F: return GL_RGBA32F;
+        default: return GL_RGBA8;
+        }
+    }
+
+    size_t bytesPerPixel(Config::AccumulationFormat format) {
+        switch (format) {
+        case Config::AccumulationFormat::RGBA16F: return 8;
+        case Config::AccumulationFormat::RGBA32F: return 16;
+        default: return 4;
+        }
+    }
+
+    const char* name(Config::AccumulationFormat format) {
+        switch (format) {
+        case Config::AccumulationFormat::RGBA16F: return "RGBA16F";
+        case Config::AccumulationFormat::R11G11B10F: return "R11G11B10F";
+        case Config::AccumulationFormat::RGBA32F: return "RGBA32F";
+        default: return "RGBA8";
+        }
+    }
+}
+
+FractalManager::FractalManager(int width, int height, const glm::mat4& projection,
+    Config::AccumulationFormat format, Config::CompositorBackend backend)
+    : width(width), height(height), format(format),
+      renderWidth(width), renderHeight(height), resolutionScale(1.0f), dynamicResolution(false), refining(false),
+      interactiveScale(1.0f), refiningRevision(0), resolutionCooldown(0), blitFbo(0), fullSizeTexture(0),
+      exposure(Config::EXPOSURE), toneMap(Config::TONE_MAP),
+      displayFbo(0), displayTexture(0),
+      instanceCapacity(0), instanceCount(0), uploadedRevision(0), instancesUploaded(false),
+      animatedInstanceCount(0), shiftedInstanceCount(0), colorTime(0.0f), idle(false),
+      adaptiveIterations(true), iterationsPerFrame(1), iterationTimeMs(0.0f), nextIterationTimer(0),
+      cpuRevision(0), cpuStableFrames(0), engine(Config::RENDER_ENGINE), chaosRevision(0) {
+    if (backend == Config::CompositorBackend::Cpu) {
+        threadPool = std::make_unique<ThreadPool>(Config::CPU_COMPOSITOR_THREADS);
+        cpuCompositor = CpuCompositor::create(width, height, format, *threadPool);
+        this->format = cpuCompositor->getStorageFormat();
+    }
+
     currentTexture = createTexture(width, height);
     previousTexture = createTexture(width, height);
     
     this->projection = projection;
 
     glGenFramebuffers(1, &fbo);
+    glGenFramebuffers(1, &blitFbo);
     
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, previousTexture, 0);
@@ -38,22 +91,104 @@ FractalManager::FractalManager(int width, int height, GLuint textureShader, GLui
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
     glBindVertexArray(0);
+
+    compositeShader = std::make_unique<ShaderProgram>(ShaderSources::COMPOSITE_VERTEX, ShaderSources::COMPOSITE_FRAGMENT);
+
+    presentShader = std::make_unique<ShaderProgram>(ShaderSources::QUAD_VERTEX, ShaderSources::PRESENT_FRAGMENT);
+    presentProjectionLoc = presentShader->getUniformLocation("projection");
+    presentModelLoc = presentShader->getUniformLocation("model");
+    presentFrameLoc = presentShader->getUniformLocation("frame");
+    presentExposureLoc = presentShader->getUniformLocation("exposure");
+    presentToneMapLoc = presentShader->getUniformLocation("toneMap");
+    presentUpscaleLoc = presentShader->getUniformLocation("upscale");
+    iterationTimers.resize(3);
+    for (auto& timer : iterationTimers) {
+        glGenQueries(1, &timer.startQuery);
+        glGenQueries(1, &timer.endQuery);
+        timer.iterations = 0;
+        timer.scale = 1.0f;
+        timer.pending = false;
+    }
+
+    if (Config::DETECT_CONVERGENCE && !cpuCompositor) {
+        convergence = std::make_unique<ConvergenceDetector>(width, height);
+    }
+
+    compositeProjectionLoc = compositeShader->getUniformLocation("projection");
+    compositeFrameSizeLoc = compositeShader->getUniformLocation("frameSize");
+    compositePreviousFrameLoc = compositeShader->getUniformLocation("previousFrame");
+    compositeColorTimeLoc = compositeShader->getUniformLocation("colorTime");
+
+    glGenVertexArrays(1, &compositeVao);
+    glGenBuffers(1, &instanceVbo);
+    glBindVertexArray(compositeVao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(ScreenInstance), (void*)offsetof(ScreenInstance, x));
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(ScreenInstance), (void*)offsetof(ScreenInstance, rotation));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ScreenInstance), (void*)offsetof(ScreenInstance, color));
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
+    glVertexAttribIPointer(5, 2, GL_UNSIGNED_INT, sizeof(ScreenInstance), (void*)offsetof(ScreenInstance, colorAnimation));
+    glEnableVertexAttribArray(5);
+    glVertexAttribDivisor(5, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 }
 
 FractalManager::~FractalManager() {
+    recorder.reset();
+    if (frameReadback) {
+        frameReadback->flush();
+        frameReadback.reset();
+    }
     glDeleteTextures(1, &currentTexture);
     glDeleteTextures(1, &previousTexture);
+    for (const PooledTexture& pooled : texturePool) {
+        glDeleteTextures(1, &pooled.texture);
+    }
+    if (fullSizeTexture) {
+        glDeleteTextures(1, &fullSizeTexture);
+    }
     glDeleteFramebuffers(1, &fbo);
+    glDeleteFramebuffers(1, &blitFbo);
+    if (displayFbo) {
+        glDeleteFramebuffers(1, &displayFbo);
+        glDeleteTextures(1, &displayTexture);
+    }
     glDeleteBuffers(1, &vbo);
     glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &instanceVbo);
+    glDeleteVertexArrays(1, &compositeVao);
+    for (auto& timer : iterationTimers) {
+        glDeleteQueries(1, &timer.startQuery);
+        glDeleteQueries(1, &timer.endQuery);
+    }
 }
 
 GLuint FractalManager::createTexture(int w, int h) {
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    GLenum internalFormat = AccumulationFormats::internalFormat(format);
+    GLenum pixelFormat = internalFormat == GL_R11F_G11F_B10F ? GL_RGB : GL_RGBA;
+    GLenum pixelType = internalFormat == GL_RGBA8 ? GL_UNSIGNED_BYTE : GL_FLOAT;
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, pixelFormat, pixelType, NULL);
+    if (Config::USE_MIPMAPPED_SAMPLING) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+    else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -61,61 +196,397 @@ GLuint FractalManager::createTexture(int w, int h) {
     return texture;
 }
 
-GLuint FractalManager::processFrame(const std::vector<Screen>& screens, int frameCounter) {
+GLuint FractalManager::acquireTexture(int w, int h) {
+    for (auto it = texturePool.begin(); it != texturePool.end(); ++it) {
+        if (it->width == w && it->height == h) {
+            GLuint texture = it->texture;
+            texturePool.erase(it);
+            return texture;
+        }
+    }
+    return createTexture(w, h);
+}
+
+void FractalManager::releaseTexture(GLuint texture, int w, int h) {
+    texturePool.push_back({ texture, w, h });
+    if (texturePool.size() > static_cast<size_t>(Config::RESOLUTION_POOL_TEXTURES)) {
+        glDeleteTextures(1, &texturePool.front().texture);
+        texturePool.erase(texturePool.begin());
+    }
+}
+
+void FractalManager::blitFrame(GLuint source, int sourceWidth, int sourceHeight, GLuint target, int targetWidth, int targetHeight) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, blitFbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    glBlitFramebuffer(0, 0, sourceWidth, sourceHeight, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void FractalManager::setRenderScale(float scale) {
+    // The software backend and the chaos game write full-size frames
+    if (cpuCompositor) {
+        return;
+    }
+    resolutionScale = scale;
+    iterationTimeMs = 0.0f;
+    resolutionCooldown = Config::RESOLUTION_SETTLE_FRAMES;
+    int w = std::max(1, static_cast<int>(std::lround(width * scale)));
+    int h = std::max(1, static_cast<int>(std::lround(height * scale)));
+    if (w == renderWidth && h == renderHeight) {
+        return;
+    }
+
+    // Resample the frame into the new size so the loop carries on instead of restarting from black
+    GLuint newPrevious = acquireTexture(w, h);
+    GLuint newCurrent = acquireTexture(w, h);
+    blitFrame(previousTexture, renderWidth, renderHeight, newPrevious, w, h);
+    if (Config::USE_MIPMAPPED_SAMPLING) {
+        glBindTexture(GL_TEXTURE_2D, newPrevious);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    releaseTexture(previousTexture, renderWidth, renderHeight);
+    releaseTexture(currentTexture, renderWidth, renderHeight);
+    previousTexture = newPrevious;
+    currentTexture = newCurrent;
+    renderWidth = w;
+    renderHeight = h;
+    if (convergence) {
+        convergence->reset();
+    }
+}
+
+void FractalManager::setDynamicResolution(bool enabled) {
+    dynamicResolution = enabled;
+    refining = false;
+    if (!enabled) {
+        setRenderScale(1.0f);
+    }
+}
+
+void FractalManager::adaptResolution(unsigned int sceneRevision) {
+    if (!dynamicResolution) {
+        return;
+    }
+    if (refining) {
+        // Hold full resolution until the user changes something, then drop straight back
+        if (sceneRevision != refiningRevision) {
+            refining = false;
+            setRenderScale(interactiveScale);
+        }
+        return;
+    }
+    if (resolutionCooldown > 0) {
+        resolutionCooldown--;
+        return;
+    }
+    if (iterationTimeMs <= 0.0f) {
+        return;
+    }
+
+    // Iteration cost goes with the pixel count, i.e. the square of the scale
+    float fullCostMs = iterationTimeMs / (resolutionScale * resolutionScale);
+    float step = Config::RESOLUTION_SCALE_STEP;
+    if (iterationTimeMs > Config::RESOLUTION_TARGET_MS && resolutionScale > Config::MIN_RESOLUTION_SCALE) {
+        // Drop straight to the largest step that fits, like adaptIterations
+        float fit = std::floor(std::sqrt(Config::RESOLUTION_TARGET_MS / fullCostMs) / step) * step;
+        setRenderScale(std::max(Config::MIN_RESOLUTION_SCALE, std::min(fit, resolutionScale - step)));
+    }
+    else if (resolutionScale < 1.0f) {
+        float next = std::min(1.0f, resolutionScale + step);
+        if (fullCostMs * next * next < Config::RESOLUTION_TARGET_MS * Config::RESOLUTION_HEADROOM) {
+            setRenderScale(next);
+        }
+    }
+}
+
+GLuint FractalManager::fullSizeFrame() {
+    if (renderWidth == width && renderHeight == height) {
+        return previousTexture;
+    }
+    if (!fullSizeTexture) {
+        fullSizeTexture = createTexture(width, height);
+    }
+    blitFrame(previousTexture, renderWidth, renderHeight, fullSizeTexture, width, height);
+    return fullSizeTexture;
+}
+
+void FractalManager::countColorAnimations(ScreenStore::Range range, int sign) {
+    size_t end = std::min<size_t>(range.end, instances.size());
+    for (size_t i = range.begin; i < end; ++i) {
+        const ScreenInstance& instance = instances[i];
+        animatedInstanceCount += sign * static_cast<int>(instance.hasAnimatedColor());
+        shiftedInstanceCount += sign * static_cast<int>((instance.colorAnimation[0] | instance.colorAnimation[1]) != 0);
+    }
+}
+
+uint32_t FractalManager::beginInstanceUpdate(size_t count, ScreenStore::Range range) {
+    // Records that range rewrites leave the counts until endInstanceUpdate, and records the
+    // resize drops leave for good, so an edit costs its own size rather than the scene's
+    uint32_t kept = static_cast<uint32_t>(std::min(count, instances.size()));
+    countColorAnimations({ range.begin, std::min(range.end, kept) }, -1);
+    countColorAnimations({ kept, static_cast<uint32_t>(instances.size()) }, -1);
+    instances.resize(count);
+    return kept;
+}
+
+void FractalManager::endInstanceUpdate(ScreenStore::Range range, uint32_t kept) {
+    countColorAnimations({ range.begin, std::min(range.end, kept) }, 1);
+    countColorAnimations({ kept, static_cast<uint32_t>(instances.size()) }, 1);
+}
+
+void FractalManager::uploadInstances(const ScreenStore& screens, ScreenStore::Range range) {
+    uint32_t kept = beginInstanceUpdate(screens.size(), range);
+    screens.writeInstances(instances.data(), range);
+    endInstanceUpdate(range, kept);
+    uploadInstanceBuffer(range);
+}
+
+void FractalManager::setInstances(const ScreenInstance* data, size_t count, unsigned int sceneRevision) {
+    instances.assign(data, data + count);
+    animatedInstanceCount = 0;
+    shiftedInstanceCount = 0;
+    countColorAnimations({ 0, static_cast<uint32_t>(count) }, 1);
+    uploadInstanceBuffer({ 0, static_cast<uint32_t>(count) });
+    uploadedRevision = sceneRevision;
+    instancesUploaded = true;
+}
+
+void FractalManager::uploadInstanceBuffer(ScreenStore::Range range) {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    if (instances.size() > instanceCapacity) {
+        // The new storage is undefined, so everything goes up
+        instanceCapacity = std::max(instances.size(), instanceCapacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(ScreenInstance), nullptr, GL_DYNAMIC_DRAW);
+        range = { 0, static_cast<uint32_t>(instances.size()) };
+    }
+    if (!range.empty()) {
+        glBufferSubData(GL_ARRAY_BUFFER, range.begin * sizeof(ScreenInstance),
+            (range.end - range.begin) * sizeof(ScreenInstance), instances.data() + range.begin);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instanceCount = instances.size();
+}
+
+GLuint FractalManager::processFrame(const ScreenStore& screens, unsigned int sceneRevision, int frameCounter) {
+    if (frameReadback) {
+        frameReadback->collect();
+    }
+    colorTime = static_cast<float>(frameCounter) / Config::FPS;
+
+    if (!instancesUploaded) {
+        uploadInstances(screens, { 0, static_cast<uint32_t>(screens.size()) });
+        uploadedRevision = sceneRevision;
+        instancesUploaded = true;
+    }
+    else if (sceneRevision != uploadedRevision) {
+        uploadInstances(screens, screens.getDirtyRange());
+        uploadedRevision = sceneRevision;
+    }
+    return renderFrame(sceneRevision);
+}
+
+GLuint FractalManager::processFrame(const ScreenInstance* data, size_t count, ScreenStore::Range changed,
+    unsigned int sceneRevision, int frameCounter) {
+    if (frameReadback) {
+        frameReadback->collect();
+    }
+    colorTime = static_cast<float>(frameCounter) / Config::FPS;
+
+    if (!instancesUploaded || sceneRevision != uploadedRevision) {
+        if (!instancesUploaded) {
+            changed = { 0, static_cast<uint32_t>(count) };
+        }
+        uint32_t kept = beginInstanceUpdate(count, changed);
+        if (!changed.empty()) {
+            std::copy(data + changed.begin, data + changed.end, instances.begin() + changed.begin);
+        }
+        endInstanceUpdate(changed, kept);
+        uploadInstanceBuffer(changed);
+        uploadedRevision = sceneRevision;
+        instancesUploaded = true;
+    }
+    return renderFrame(sceneRevision);
+}
+
+GLuint FractalManager::renderFrame(unsigned int sceneRevision) {
+    if (engine == Config::RenderEngine::ChaosGame) {
+        return processFrameChaos(sceneRevision);
+    }
+    if (cpuCompositor) {
+        return processFrameCpu(sceneRevision);
+    }
+
+    // At the fixed point another pass would reproduce the same frame; animated colors move it
+    idle = animatedInstanceCount == 0 && convergence && convergence->isConverged(sceneRevision);
+    if (idle && dynamicResolution && resolutionScale < 1.0f) {
+        // Converged below full resolution: refine at full resolution before going idle
+        interactiveScale = resolutionScale;
+        refining = true;
+        refiningRevision = sceneRevision;
+        setRenderScale(1.0f);
+        idle = false;
+    }
+    if (idle) {
+        if (recorder) {
+            recorder->submit(presentToTexture());
+        }
+        return previousTexture;
+    }
+
+    collectIterationTimings();
+    adaptResolution(sceneRevision);
+    IterationTimer& timer = iterationTimers[nextIterationTimer];
+    bool timed = !timer.pending;
+    if (timed) {
+        glQueryCounter(timer.startQuery, GL_TIMESTAMP);
+    }
+
+    for (int i = 0; i < iterationsPerFrame; ++i) {
+        compositePass();
+    }
+
+    if (timed) {
+        glQueryCounter(timer.endQuery, GL_TIMESTAMP);
+        timer.iterations = iterationsPerFrame;
+        timer.scale = resolutionScale;
+        timer.pending = true;
+        nextIterationTimer = (nextIterationTimer + 1) % iterationTimers.size();
+    }
+
+    if (convergence) {
+        convergence->submit(previousTexture, currentTexture, vao, sceneRevision);
+    }
+    if (recorder) {
+        recorder->submit(presentToTexture());
+    }
+    
+    return previousTexture;
+}
+
+GLuint FractalManager::processFrameCpu(unsigned int sceneRevision) {
+    if (sceneRevision != cpuRevision) {
+        cpuRevision = sceneRevision;
+        cpuStableFrames = 0;
+    }
+    idle = animatedInstanceCount == 0 && Config::DETECT_CONVERGENCE && cpuStableFrames >= Config::CONVERGENCE_FRAMES;
+
+    if (!idle) {
+        auto start = std::chrono::steady_clock::now();
+        // The software path has no shader, so animated colors are resolved into a copy
+        const std::vector<ScreenInstance>* frameInstances = &instances;
+        if (shiftedInstanceCount > 0) {
+            animatedInstances = instances;
+            for (ScreenInstance& instance : animatedInstances) {
+                if (instance.colorAnimation[0] | instance.colorAnimation[1]) {
+                    instance.color = instance.getColorAnimation().apply(instance.color, colorTime);
+                }
+            }
+            frameInstances = &animatedInstances;
+        }
+        for (int i = 0; i < iterationsPerFrame; ++i) {
+            float delta = cpuCompositor->composite(*frameInstances);
+            cpuStableFrames = delta < Config::CONVERGENCE_THRESHOLD ? cpuStableFrames + 1 : 0;
+        }
+        float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        recordIterationTime(elapsedMs / iterationsPerFrame);
+        adaptIterations();
+        cpuCompositor->upload(previousTexture);
+    }
+
+    if (recorder) {
+        recorder->submit(presentToTexture());
+    }
+    return previousTexture;
+}
+
+GLuint FractalManager::processFrameChaos(unsigned int sceneRevision) {
+    if (!chaosGame) {
+        if (!threadPool) {
+            threadPool = std::make_unique<ThreadPool>(Config::CPU_COMPOSITOR_THREADS);
+        }
+        chaosGame = std::make_unique<ChaosGame>(width, height, *threadPool);
+        chaosGame->setScreens(instances, colorTime);
+        chaosRevision = sceneRevision;
+    }
+    else if (sceneRevision != chaosRevision) {
+        chaosGame->setScreens(instances, colorTime);
+        chaosRevision = sceneRevision;
+    }
+    idle = chaosGame->getSampleCount() >= Config::CHAOS_SAMPLE_LIMIT;
+
+    if (!idle) {
+        chaosGame->iterate(Config::CHAOS_SAMPLES_PER_FRAME);
+        chaosGame->upload(previousTexture);
+    }
+
+    if (recorder) {
+        recorder->submit(presentToTexture());
+    }
+    return previousTexture;
+}
+
+void FractalManager::setEngine(Config::RenderEngine value) {
+    if (value == engine) {
+        return;
+    }
+    engine = value;
+    idle = false;
+    if (engine == Config::RenderEngine::ChaosGame) {
+        refining = false;
+        setRenderScale(1.0f);
+        if (chaosGame) {
+            chaosGame->setScreens(instances, colorTime);
+        }
+        return;
+    }
+
+    // The GPU loop continues from the chaos-game image; the software backend keeps its own frame
+    if (convergence) {
+        convergence->reset();
+    }
+    cpuStableFrames = 0;
+    if (Config::USE_MIPMAPPED_SAMPLING && !cpuCompositor) {
+        glBindTexture(GL_TEXTURE_2D, previousTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
+void FractalManager::compositePass() {
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, currentTexture, 0);
     
-    glViewport(0, 0, width, height);
+    // The projection stays in output pixels, so a smaller viewport just scales the scene down
+    glViewport(0, 0, renderWidth, renderHeight);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
     glEnable(GL_BLEND);
     glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
     
-    glm::mat4 offscreenProjection = glm::ortho(0.0f, (float)width, (float)height, 0.0f, -1.0f, 1.0f);
-    
-    for (const auto& screen : screens) {
-        glUseProgram(textureShaderProgram);
-        
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(screen.getX(), height - screen.getY(), 0.0f));
-        model = glm::rotate(model, glm::radians(-screen.getRotation() + 180), glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::translate(model, glm::vec3(screen.getWidth()/2.0f, -screen.getHeight()/2.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(-(float)screen.getWidth(), (float)screen.getHeight(), 1.0f));
-        
-        GLint projLoc = glGetUniformLocation(textureShaderProgram, "projection");
-        GLint modelLoc = glGetUniformLocation(textureShaderProgram, "model");
-        GLint texLoc = glGetUniformLocation(textureShaderProgram, "tex");
-        GLint colorLoc = glGetUniformLocation(textureShaderProgram, "color");
-        
-        if (projLoc != -1) glUniformMatrix4fv(projLoc, 1, GL_FALSE, &offscreenProjection[0][0]);
-        if (modelLoc != -1) glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-        if (colorLoc != -1) glUniform4f(colorLoc, 1.0f, 1.0f, 1.0f, 1.0f);
-        
+    if (instanceCount > 0) {
+        glm::mat4 offscreenProjection = glm::ortho(0.0f, (float)width, (float)height, 0.0f, -1.0f, 1.0f);
+
+        compositeShader->use();
+        glUniformMatrix4fv(compositeProjectionLoc, 1, GL_FALSE, &offscreenProjection[0][0]);
+        glUniform2f(compositeFrameSizeLoc, static_cast<float>(width), static_cast<float>(height));
+        glUniform1i(compositePreviousFrameLoc, 0);
+        glUniform1f(compositeColorTimeLoc, colorTime);
+
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, previousTexture);
-        if (texLoc != -1) glUniform1i(texLoc, 0);
-        
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-        glBindVertexArray(0);
-        glUseProgram(0);
-        
-        SDL_Color color = screen.getColor();
-        float alpha = color.a / 255.0f;
-        
-        glUseProgram(colorShaderProgram);
-        
-        projLoc = glGetUniformLocation(colorShaderProgram, "projection");
-        modelLoc = glGetUniformLocation(colorShaderProgram, "model");
-        colorLoc = glGetUniformLocation(colorShaderProgram, "color");
-        
-        if (projLoc != -1) glUniformMatrix4fv(projLoc, 1, GL_FALSE, &offscreenProjection[0][0]);
-        if (modelLoc != -1) glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-        if (colorLoc != -1) glUniform4f(colorLoc, color.r / 255.0f * alpha, color.g / 255.0f * alpha, color.b / 255.0f * alpha, alpha);
-        
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        if (Config::USE_MIPMAPPED_SAMPLING) {
+            // One box-filtered pyramid per pass; each fragment then reads the level
+            // matching its screen's scale instead of minifying level 0
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+
+        // Instances are rasterized in order, so blending matches the old per-screen loop
+        glBindVertexArray(compositeVao);
+        glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, static_cast<GLsizei>(instanceCount));
         glBindVertexArray(0);
         glUseProgram(0);
     }
@@ -123,43 +594,242 @@ GLuint FractalManager::processFrame(const std::vector<Screen>& screens, int fram
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     
     std::swap(currentTexture, previousTexture);
-    
-    return previousTexture;
 }
 
-void FractalManager::renderCurrentFrame() {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, width, height);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+void FractalManager::collectIterationTimings() {
+    // Oldest query first; stop at the first one the GPU hasn't finished
+    for (size_t i = 0; i < iterationTimers.size(); ++i) {
+        IterationTimer& timer = iterationTimers[(nextIterationTimer + i) % iterationTimers.size()];
+        if (!timer.pending) {
+            continue;
+        }
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(timer.endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(timer.startQuery, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(timer.endQuery, GL_QUERY_RESULT, &end);
+        timer.pending = false;
+
+        if (timer.scale == resolutionScale) {
+            recordIterationTime(static_cast<float>(end - start) / 1.0e6f / timer.iterations);
+        }
+    }
+    adaptIterations();
+}
+
+void FractalManager::recordIterationTime(float iterationMs) {
+    iterationTimeMs = iterationTimeMs > 0.0f ? iterationTimeMs * 0.8f + iterationMs * 0.2f : iterationMs;
+}
+
+void FractalManager::adaptIterations() {
+    if (!adaptiveIterations || iterationTimeMs <= 0.0f) {
+        return;
+    }
+
+    // Drop straight to what fits the budget, but only climb one iteration at a time
+    int target = static_cast<int>(Config::ITERATION_TIME_BUDGET_MS / iterationTimeMs);
+    target = std::max(1, std::min(target, Config::MAX_ITERATIONS_PER_FRAME));
+    iterationsPerFrame = target < iterationsPerFrame ? target : std::min(target, iterationsPerFrame + 1);
+}
+
+void FractalManager::setAdaptiveIterations(bool enabled) {
+    adaptiveIterations = enabled;
+    if (!enabled) {
+        iterationsPerFrame = 1;
+    }
+}
+
+void FractalManager::drawPresentPass(const glm::mat4& targetProjection) {
+    glDisable(GL_BLEND);
+    presentShader->use();
 
-    glUseProgram(textureShaderProgram);
-    
     glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(width, height, 1.0f));
-    GLint projLoc = glGetUniformLocation(textureShaderProgram, "projection");
-    GLint modelLoc = glGetUniformLocation(textureShaderProgram, "model");
-    GLint texLoc = glGetUniformLocation(textureShaderProgram, "tex");
-    GLint colorLoc = glGetUniformLocation(textureShaderProgram, "color");
-    
-    if (projLoc != -1) glUniformMatrix4fv(projLoc, 1, GL_FALSE, &projection[0][0]);
-    if (modelLoc != -1) glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-    if (colorLoc != -1) glUniform4f(colorLoc, 1.0f, 1.0f, 1.0f, 1.0f);
-    
+    glUniformMatrix4fv(presentProjectionLoc, 1, GL_FALSE, &targetProjection[0][0]);
+    glUniformMatrix4fv(presentModelLoc, 1, GL_FALSE, &model[0][0]);
+    glUniform1f(presentExposureLoc, exposure);
+    glUniform1i(presentToneMapLoc, static_cast<int>(toneMap));
+    glUniform1i(presentUpscaleLoc, renderWidth != width || renderHeight != height);
+
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, previousTexture);
-    if (texLoc != -1) glUniform1i(texLoc, 0);
-    
+    glUniform1i(presentFrameLoc, 0);
+
     glBindVertexArray(vao);
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
     glBindVertexArray(0);
     glUseProgram(0);
+
+    // Overlays drawn after the frame expect regular alpha blending
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void FractalManager::renderCurrentFrame() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    drawPresentPass(projection);
+}
+
+GLuint FractalManager::presentToTexture() {
+    if (!displayFbo) {
+        glGenTextures(1, &displayTexture);
+        glBindTexture(GL_TEXTURE_2D, displayTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenFramebuffers(1, &displayFbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, displayFbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, displayTexture, 0);
+    }
+
+    // Feedback textures keep the top row at row 0; flip the present projection to match
+    glm::mat4 textureProjection = glm::ortho(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), -1.0f, 1.0f);
+    glBindFramebuffer(GL_FRAMEBUFFER, displayFbo);
+    glViewport(0, 0, width, height);
+    drawPresentPass(textureProjection);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return displayTexture;
+}
+
+void FractalManager::readPresentedFrame(std::vector<Uint8>& pixels) {
+    presentToTexture();
+    pixels.resize(static_cast<size_t>(width) * height * 4);
+    glBindFramebuffer(GL_FRAMEBUFFER, displayFbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+size_t FractalManager::getTextureMemoryBytes() const {
+    auto frameBytes = [this](int w, int h) {
+        size_t bytes = static_cast<size_t>(w) * h * AccumulationFormats::bytesPerPixel(format);
+        return Config::USE_MIPMAPPED_SAMPLING ? bytes + bytes / 3 : bytes;
+    };
+    size_t total = 2 * frameBytes(renderWidth, renderHeight);
+    for (const PooledTexture& pooled : texturePool) {
+        total += frameBytes(pooled.width, pooled.height);
+    }
+    if (fullSizeTexture) {
+        total += frameBytes(width, height);
+    }
+    return total;
+}
+
+void FractalManager::readFrame(std::vector<Uint8>& pixels) {
+    pixels.resize(static_cast<size_t>(width) * height * 4);
+
+    GLuint frame = fullSizeFrame();
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+std::string FractalManager::framePath(int frameNum) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06d", frameNum);
+    return (std::filesystem::path(Config::FRAME_SAVE_DIR) / (name + std::string(Config::FRAME_SAVE_EXTENSION))).string();
+}
+
+void FractalManager::saveFrame(GLuint texture, int frameNum) {
+    if (!frameReadback) {
+        std::error_code error;
+        std::filesystem::create_directories(Config::FRAME_SAVE_DIR, error);
+        if (error) {
+            throw std::runtime_error("Could not create " + std::string(Config::FRAME_SAVE_DIR) + ": " + error.message());
+        }
+        frameWriter = std::make_unique<FrameWriter>(Config::FRAME_WRITER_THREADS, Config::FRAME_WRITER_QUEUE);
+        frameReadback = std::make_unique<FrameReadback>(width, height, Config::FRAME_READBACK_BUFFERS,
+            [this](const Uint8* pixels, long long tag) {
+                frameWriter->enqueue(framePath(static_cast<int>(tag)), width, height, pixels);
+            });
+    }
+    if (texture == previousTexture) {
+        texture = fullSizeFrame();
+    }
+    frameReadback->submit(texture, frameNum);
+}
+
+void FractalManager::flushSavedFrames() {
+    if (frameReadback) {
+        frameReadback->flush();
+        frameWriter->wait();
+    }
+}
+
+void FractalManager::startRecording(const std::string& path, int fps, bool dropWhenBehind) {
+    recorder.reset();
+    recorder = std::make_unique<VideoRecorder>(path, width, height, fps, vao, dropWhenBehind);
+}
+
+void FractalManager::stopRecording() {
+    recorder.reset();
+}
+
+GLuint FractalManager::loadPreviousFrame(int frameNum) {
+    std::string path = framePath(frameNum);
+    int frameWidth, frameHeight;
+    std::vector<Uint8> pixels;
+    ImageIO::readImage(path, frameWidth, frameHeight, pixels);
+    if (frameWidth != width || frameHeight != height) {
+        throw std::runtime_error(path + " is " + std::to_string(frameWidth) + "x" + std::to_string(frameHeight) +
+            ", expected " + std::to_string(width) + "x" + std::to_string(height));
+    }
+
+    refining = false;
+    setRenderScale(1.0f);
+
+    // Stage through an unpack buffer so the texture upload is a DMA copy the driver can schedule
+    GLuint pbo;
+    glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, pixels.size(), nullptr, GL_STREAM_DRAW);
+    void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, pixels.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (staging) {
+        std::copy(pixels.begin(), pixels.end(), static_cast<Uint8*>(staging));
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, previousTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, staging ? nullptr : pixels.data());
+    if (Config::USE_MIPMAPPED_SAMPLING) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &pbo);
+
+    if (convergence) {
+        convergence->reset();
+    }
+    if (cpuCompositor) {
+        cpuCompositor->load(pixels.data());
+        cpuStableFrames = 0;
+    }
+    idle = false;
+    return previousTexture;
 }
 
 namespace OtherRenders {
-    void drawSelectionOutline(Screen* selected, bool scalingMode, int tempWidth, int tempHeight, GLuint colorShaderProgram, const glm::mat4& projection, GLuint vao) {
+    OutlineUniforms resolveOutlineUniforms(const ShaderProgram& colorShader) {
+        return {
+            colorShader.getUniformLocation("model"),
+            colorShader.getUniformLocation("projection"),
+            colorShader.getUniformLocation("color")
+        };
+    }
+
+    void drawSelectionOutline(const Screen* selected, bool scalingMode, int tempWidth, int tempHeight, const ShaderProgram& colorShader, const OutlineUniforms& uniforms, const glm::mat4& projection, GLuint vao) {
         if (!selected) return;
 
         int width = scalingMode ? tempWidth : selected->getWidth();
@@ -170,9 +840,11 @@ namespace OtherRenders {
 
         SDL_Color outlineColor = scalingMode ? selected->getScaleOutlineColor() : selected->getOutlineColor();
         
-        glUseProgram(colorShaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(colorShaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
-        glUniform4f(glGetUniformLocation(colorShaderProgram, "color"), outlineColor.r / 255.0f, outlineColor.g / 255.0f, outlineColor.b / 255.0f, outlineColor.a / 255.0f);
+        GLint modelLoc = uniforms.model;
+
+        colorShader.use();
+        glUniformMatrix4fv(uniforms.projection, 1, GL_FALSE, &projection[0][0]);
+        glUniform4f(uniforms.color, outlineColor.r / 255.0f, outlineColor.g / 255.0f, outlineColor.b / 255.0f, outlineColor.a / 255.0f);
         glBindVertexArray(vao);
 
         glm::mat4 model = glm::mat4(1.0f);
@@ -180,7 +852,7 @@ namespace OtherRenders {
         model = glm::rotate(model, glm::radians(rotation), glm::vec3(0.0f, 0.0f, 1.0f));
         model = glm::translate(model, glm::vec3(-(width + 2*Config::OUTLINE_THICKNESS)/2, height/2, 0.0f));
         model = glm::scale(model, glm::vec3(width + 2*Config::OUTLINE_THICKNESS, Config::OUTLINE_THICKNESS, 1.0f));
-        glUniformMatrix4fv(glGetUniformLocation(colorShaderProgram, "model"), 1, GL_FALSE, &model[0][0]);
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
         glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 
         model = glm::mat4(1.0f);
@@ -188,7 +860,7 @@ namespace OtherRenders {
         model = glm::rotate(model, glm::radians(rotation), glm::vec3(0.0f, 0.0f, 1.0f));
         model = glm::translate(model, glm::vec3(-(width + 2*Config::OUTLINE_THICKNESS)/2, -height/2 - Config::OUTLINE_THICKNESS, 0.0f));
         model = glm::scale(model, glm::vec3(width + 2*Config::OUTLINE_THICKNESS, Config::OUTLINE_THICKNESS, 1.0f));
-        glUniformMatrix4fv(glGetUniformLocation(colorShaderProgram, "model"), 1, GL_FALSE, &model[0][0]);
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
         glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 
         model = glm::mat4(1.0f);
@@ -196,7 +868,7 @@ namespace OtherRenders {
         model = glm::rotate(model, glm::radians(rotation), glm::vec3(0.0f, 0.0f, 1.0f));
         model = glm::translate(model, glm::vec3(-width/2 - Config::OUTLINE_THICKNESS, -height/2, 0.0f));
         model = glm::scale(model, glm::vec3(Config::OUTLINE_THICKNESS, height, 1.0f));
-        glUniformMatrix4fv(glGetUniformLocation(colorShaderProgram, "model"), 1, GL_FALSE, &model[0][0]);
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
         glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 
         model = glm::mat4(1.0f);
@@ -204,7 +876,7 @@ namespace OtherRenders {
         model = glm::rotate(model, glm::radians(rotation), glm::vec3(0.0f, 0.0f, 1.0f));
         model = glm::translate(model, glm::vec3(width/2, -height/2, 0.0f));
         model = glm::scale(model, glm::vec3(Config::OUTLINE_THICKNESS, height, 1.0f));
-        glUniformMatrix4fv(glGetUniformLocation(colorShaderProgram, "model"), 1, GL_FALSE, &model[0][0]);
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
         glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 
         glBindVertexArray(0);
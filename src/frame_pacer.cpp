@@ -0,0 +1,95 @@
+#include "frame_pacer.h"
+#include <algorithm>
+
+FramePacer::FramePacer(Config::PacingMode mode, int targetFps)
+    : mode(mode), lastFrameStart(0), nextDeadline(0), deltaSeconds(0.0f) {
+    frequency = SDL_GetPerformanceFrequency();
+    framePeriod = frequency / std::max(1, targetFps);
+    setMode(mode);
+}
+
+float FramePacer::beginFrame() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (lastFrameStart == 0) {
+        deltaSeconds = static_cast<float>(framePeriod) / frequency;
+    }
+    else {
+        deltaSeconds = std::min(static_cast<float>(now - lastFrameStart) / frequency, Config::MAX_FRAME_DELTA);
+    }
+    lastFrameStart = now;
+    return deltaSeconds;
+}
+
+void FramePacer::endFrame() {
+    if (mode != Config::PacingMode::Limited) {
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    nextDeadline += framePeriod;
+    // Re-anchor after a long frame instead of rushing to catch up
+    if (nextDeadline + framePeriod < now || nextDeadline > now + framePeriod) {
+        nextDeadline = now + framePeriod;
+    }
+
+    Uint64 spinTicks = static_cast<Uint64>(Config::PACING_SPIN_MS * frequency / 1000.0f);
+    if (nextDeadline > now + spinTicks) {
+        Uint32 sleepMs = static_cast<Uint32>((nextDeadline - now - spinTicks) * 1000 / frequency);
+        if (sleepMs > 0) {
+            SDL_Delay(sleepMs);
+        }
+    }
+    while (SDL_GetPerformanceCounter() < nextDeadline) {
+    }
+}
+
+void FramePacer::setMode(Config::PacingMode newMode) {
+    mode = newMode;
+    switch (mode) {
+    case Config::PacingMode::VSync:
+        SDL_GL_SetSwapInterval(1);
+        break;
+    case Config::PacingMode::AdaptiveVSync:
+        // Late frames tear instead of waiting a whole extra refresh; not every driver supports it
+        if (SDL_GL_SetSwapInterval(-1) != 0) {
+            SDL_GL_SetSwapInterval(1);
+        }
+        break;
+    case Config::PacingMode::Uncapped:
+    case Config::PacingMode::Limited:
+        SDL_GL_SetSwapInterval(0);
+        break;
+    }
+    nextDeadline = SDL_GetPerformanceCounter();
+}
+
+void FramePacer::cycleMode() {
+    switch (mode) {
+    case Config::PacingMode::VSync:
+        setMode(Config::PacingMode::AdaptiveVSync);
+        break;
+    case Config::PacingMode::AdaptiveVSync:
+        setMode(Config::PacingMode::Limited);
+        break;
+    case Config::PacingMode::Limited:
+        setMode(Config::PacingMode::Uncapped);
+        break;
+    case Config::PacingMode::Uncapped:
+        setMode(Config::PacingMode::VSync);
+        break;
+    }
+}
+
+const char* FramePacer::getModeName() const {
+    switch (mode) {
+    case Config::PacingMode::VSync:
+        return "VSYNC";
+    case Config::PacingMode::AdaptiveVSync:
+        return "ADAPTIVE VSYNC";
+    case Config::PacingMode::Limited:
+        return "LIMITED";
+    case Config::PacingMode::Uncapped:
+        return "UNCAPPED";
+    }
+    return "";
+}
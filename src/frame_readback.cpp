@@ -0,0 +1,95 @@
+#include "frame_readback.h"
+
+FrameReadback::FrameReadback(int width, int height, size_t ringSize, Callback onReady)
+    : width(width), height(height), nextSlot(0), onReady(std::move(onReady)) {
+    frameBytes = static_cast<size_t>(width) * height * 4;
+    glGenFramebuffers(1, &fbo);
+
+    slots.resize(ringSize);
+    for (auto& slot : slots) {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+        slot.fence = nullptr;
+        slot.tag = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameReadback::~FrameReadback() {
+    for (auto& slot : slots) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.pbo);
+    }
+    glDeleteFramebuffers(1, &fbo);
+}
+
+void FrameReadback::submit(GLuint texture, long long tag) {
+    collect();
+    Slot& slot = slots[nextSlot];
+    if (slot.fence) {
+        deliver(slot, GL_TIMEOUT_IGNORED);
+    }
+
+    GLint previousFbo;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.tag = tag;
+    nextSlot = (nextSlot + 1) % slots.size();
+}
+
+bool FrameReadback::deliver(Slot& slot, GLuint64 timeout) {
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const Uint8* pixels = static_cast<const Uint8*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT));
+    if (pixels) {
+        onReady(pixels, slot.tag);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void FrameReadback::collect() {
+    // Oldest first so frames are delivered in submission order
+    for (size_t i = 0; i < slots.size(); ++i) {
+        Slot& slot = slots[(nextSlot + i) % slots.size()];
+        if (slot.fence && !deliver(slot, 0)) {
+            break;
+        }
+    }
+}
+
+void FrameReadback::flush() {
+    for (size_t i = 0; i < slots.size(); ++i) {
+        Slot& slot = slots[(nextSlot + i) % slots.size()];
+        if (slot.fence) {
+            deliver(slot, GL_TIMEOUT_IGNORED);
+        }
+    }
+}
+
+bool FrameReadback::hasPending() const {
+    for (const auto& slot : slots) {
+        if (slot.fence) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,87 @@
+#include "frame_writer.h"
+#include "image_io.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+FrameWriter::FrameWriter(int threadCount, size_t maxQueued)
+    : maxQueued(std::max<size_t>(1, maxQueued)), busyWorkers(0), stopping(false),
+      writtenFrames(0), droppedFrames(0), failedFrames(0) {
+    for (int i = 0; i < std::max(1, threadCount); ++i) {
+        workers.emplace_back(&FrameWriter::workerLoop, this);
+    }
+}
+
+FrameWriter::~FrameWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+bool FrameWriter::enqueue(const std::string& path, int width, int height, const Uint8* rgba) {
+    size_t size = static_cast<size_t>(width) * height * 4;
+    std::vector<Uint8> pixels;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.size() >= maxQueued) {
+            droppedFrames++;
+            return false;
+        }
+        if (!freeBuffers.empty()) {
+            pixels = std::move(freeBuffers.back());
+            freeBuffers.pop_back();
+        }
+    }
+
+    pixels.resize(size);
+    std::memcpy(pixels.data(), rgba, size);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({ path, width, height, std::move(pixels) });
+    }
+    workAvailable.notify_one();
+    return true;
+}
+
+void FrameWriter::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [this] { return queue.empty() && busyWorkers == 0; });
+}
+
+void FrameWriter::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        workAvailable.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+
+        Job job = std::move(queue.front());
+        queue.pop_front();
+        busyWorkers++;
+        lock.unlock();
+
+        try {
+            ImageIO::writeImage(job.path, job.width, job.height, job.pixels.data());
+            writtenFrames++;
+        }
+        catch (const std::exception& e) {
+            failedFrames++;
+            std::cerr << "Frame write failed: " << e.what() << std::endl;
+        }
+
+        lock.lock();
+        busyWorkers--;
+        freeBuffers.push_back(std::move(job.pixels));
+        if (queue.empty() && busyWorkers == 0) {
+            workDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include "headless_context.h"
+#include <GL/glew.h>
+#include <EGL/eglext.h>
+#include <stdexcept>
+
+HeadlessContext::HeadlessContext() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT) {
+    // Prefer Mesa's surfaceless platform, which needs no GPU device or display server
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        throw std::runtime_error("Failed to initialize EGL");
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        eglTerminate(display);
+        throw std::runtime_error("EGL does not support desktop OpenGL");
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    // Surfaceless platforms may expose no configs at all; EGL_KHR_no_config_context covers that
+    context = eglCreateContext(display, configCount > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        eglTerminate(display);
+        throw std::runtime_error("Failed to create an OpenGL 3.3 core context");
+    }
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        throw std::runtime_error("Failed to make the headless context current");
+    }
+
+    // GLEW built against GLX reports a missing X display here, which is harmless
+    glewExperimental = GL_TRUE;
+    GLenum status = glewInit();
+    if (status != GLEW_OK && status != GLEW_ERROR_NO_GLX_DISPLAY) {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        throw std::runtime_error("Failed to initialize GLEW");
+    }
+    // glewInit may leave a GL_INVALID_ENUM behind on core profiles
+    glGetError();
+}
+
+HeadlessContext::~HeadlessContext() {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+}
@@ -0,0 +1,344 @@
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "fractal_manager.h"
+#include "headless_context.h"
+#include "image_io.h"
+#include "poster_exporter.h"
+#include "scene_io.h"
+#include "screen_animator.h"
+
+namespace {
+    struct Options {
+        std::string scenePath;
+        std::string outputPath = "fractus.png";
+        std::string recordPath;
+        std::string animationPath;
+        int iterations = 200;
+        int width = 1920;
+        int height = 1080;
+        Config::AccumulationFormat format = Config::ACCUMULATION_FORMAT;
+        Config::CompositorBackend backend = Config::COMPOSITOR_BACKEND;
+        Config::RenderEngine engine = Config::RENDER_ENGINE;
+        std::string saveScenePath;
+        int posterWidth = 0;
+        float posterSamples = Config::POSTER_SAMPLES_PER_PIXEL;
+        bool benchmarkFormats = false;
+        bool compareBackends = false;
+    };
+
+    const Config::AccumulationFormat ALL_FORMATS[] = {
+        Config::AccumulationFormat::RGBA8,
+        Config::AccumulationFormat::RGBA16F,
+        Config::AccumulationFormat::R11G11B10F,
+        Config::AccumulationFormat::RGBA32F
+    };
+
+    Config::AccumulationFormat parseFormat(const std::string& value) {
+        for (auto format : ALL_FORMATS) {
+            if (value == AccumulationFormats::name(format)) {
+                return format;
+            }
+        }
+        throw std::invalid_argument("Unknown format " + value);
+    }
+
+    Config::CompositorBackend parseBackend(const std::string& value) {
+        if (value == "gpu") return Config::CompositorBackend::Gpu;
+        if (value == "cpu") return Config::CompositorBackend::Cpu;
+        throw std::invalid_argument("Unknown backend " + value);
+    }
+
+    Config::RenderEngine parseEngine(const std::string& value) {
+        if (value == "feedback") return Config::RenderEngine::Feedback;
+        if (value == "chaos") return Config::RenderEngine::ChaosGame;
+        throw std::invalid_argument("Unknown engine " + value);
+    }
+
+    void printUsage() {
+        std::cerr << "Usage: fractus_headless --scene <file> [--iterations N] [--width W] [--height H] [--output <file.png|file.pam>] [--record <file.y4m|->]\n"
+                  << "                        [--format RGBA8|RGBA16F|R11G11B10F|RGBA32F] [--backend gpu|cpu]\n"
+                  << "                        [--engine feedback|chaos] [--benchmark-formats] [--compare-backends]\n"
+                  << "                        [--poster WIDTH] [--poster-samples PER_PIXEL] [--save-scene PATH] [--animation <file>]\n";
+    }
+
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--benchmark-formats") {
+                options.benchmarkFormats = true;
+                continue;
+            }
+            if (arg == "--compare-backends") {
+                options.compareBackends = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--scene") options.scenePath = value;
+            else if (arg == "--output") options.outputPath = value;
+            else if (arg == "--record") options.recordPath = value;
+            else if (arg == "--animation") options.animationPath = value;
+            else if (arg == "--iterations") options.iterations = std::stoi(value);
+            else if (arg == "--width") options.width = std::stoi(value);
+            else if (arg == "--height") options.height = std::stoi(value);
+            else if (arg == "--format") options.format = parseFormat(value);
+            else if (arg == "--backend") options.backend = parseBackend(value);
+            else if (arg == "--engine") options.engine = parseEngine(value);
+            else if (arg == "--save-scene") options.saveScenePath = value;
+            else if (arg == "--poster") {
+                options.posterWidth = std::stoi(value);
+                if (options.posterWidth <= 0) {
+                    throw std::invalid_argument("--poster needs a positive width");
+                }
+            }
+            else if (arg == "--poster-samples") options.posterSamples = std::stof(value);
+            else throw std::invalid_argument("Unknown option " + arg);
+        }
+        if (options.scenePath.empty() || options.width <= 0 || options.height <= 0 || options.iterations < 0) {
+            throw std::invalid_argument("A scene and a positive size are required");
+        }
+        // Posters are streamed band by band, which only the PNG writer does
+        const std::string& output = options.outputPath;
+        if (options.posterWidth > 0 && (output.size() < 4 || output.compare(output.size() - 4, 4, ".png") != 0)) {
+            throw std::invalid_argument("--poster writes PNG, so --output must end in .png");
+        }
+        return options;
+    }
+
+    struct FormatResult {
+        double msPerIteration;
+        double gigabytesPerSecond;
+        int convergedAfter;
+        std::vector<Uint8> pixels;
+    };
+
+    // Modelled traffic of one feedback pass: clearing the target, building the mip chain,
+    // and for every covered pixel a texture fetch plus the blend's read and write
+    double bytesPerIteration(const Options& options, const ScreenStore& screens, size_t bytesPerPixel) {
+        double framePixels = static_cast<double>(options.width) * options.height;
+        double pixels = framePixels;
+        if (Config::USE_MIPMAPPED_SAMPLING) {
+            pixels += framePixels * 5.0 / 3.0;
+        }
+        for (uint32_t i = 0; i < screens.size(); ++i) {
+            pixels += 3.0 * std::min(framePixels, static_cast<double>(screens.area(i)));
+        }
+        return pixels * bytesPerPixel;
+    }
+
+    FormatResult runFormat(const Options& options, const ScreenStore& screens, const glm::mat4& projection, Config::AccumulationFormat format) {
+        FormatResult result;
+        {
+            // A new revision every frame keeps convergence detection from skipping passes
+            FractalManager fractalManager(options.width, options.height, projection, format);
+            fractalManager.setAdaptiveIterations(false);
+            fractalManager.processFrame(screens, 0, 0);
+            glFinish();
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 1; frame <= options.iterations; ++frame) {
+                fractalManager.processFrame(screens, frame, frame);
+            }
+            glFinish();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            result.msPerIteration = 1000.0 * seconds / std::max(1, options.iterations);
+            result.gigabytesPerSecond = bytesPerIteration(options, screens, AccumulationFormats::bytesPerPixel(format)) / (result.msPerIteration * 1e6);
+        }
+
+        FractalManager fractalManager(options.width, options.height, projection, format);
+        fractalManager.setAdaptiveIterations(false);
+        result.convergedAfter = -1;
+        for (int frame = 0; frame < options.iterations; ++frame) {
+            fractalManager.processFrame(screens, 0, frame);
+            if (fractalManager.isIdle()) {
+                result.convergedAfter = frame;
+                break;
+            }
+        }
+        fractalManager.readPresentedFrame(result.pixels);
+        return result;
+    }
+
+    // Times every accumulation format on the scene and compares its converged image with RGBA32F
+    void benchmarkFormats(const Options& options, const ScreenStore& screens, const glm::mat4& projection) {
+        std::vector<FormatResult> results;
+        for (auto format : ALL_FORMATS) {
+            results.push_back(runFormat(options, screens, projection, format));
+        }
+        const std::vector<Uint8>& reference = results.back().pixels;
+
+        std::printf("%-11s %6s %9s %9s %10s %8s %9s\n", "format", "B/px", "ms/iter", "est GB/s", "converged", "max err", "mean err");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const FormatResult& result = results[i];
+            int maxError = 0;
+            double totalError = 0.0;
+            for (size_t p = 0; p < reference.size(); ++p) {
+                int error = std::abs(static_cast<int>(result.pixels[p]) - static_cast<int>(reference[p]));
+                maxError = std::max(maxError, error);
+                totalError += error;
+            }
+            char converged[16] = "-";
+            if (result.convergedAfter >= 0) {
+                std::snprintf(converged, sizeof(converged), "%d", result.convergedAfter);
+            }
+            std::printf("%-11s %6zu %9.3f %9.2f %10s %8d %9.3f\n", AccumulationFormats::name(ALL_FORMATS[i]),
+                AccumulationFormats::bytesPerPixel(ALL_FORMATS[i]), result.msPerIteration, result.gigabytesPerSecond,
+                converged, maxError, totalError / std::max<size_t>(1, reference.size()));
+        }
+    }
+
+    // Renders the scene with both compositors and reports their speed and how far apart the results are
+    void compareBackends(const Options& options, const ScreenStore& screens, const glm::mat4& projection) {
+        const Config::CompositorBackend backends[] = { Config::CompositorBackend::Gpu, Config::CompositorBackend::Cpu };
+        std::vector<Uint8> frames[2];
+        for (int i = 0; i < 2; ++i) {
+            FractalManager fractalManager(options.width, options.height, projection, options.format, backends[i]);
+            fractalManager.setAdaptiveIterations(false);
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < options.iterations; ++frame) {
+                fractalManager.processFrame(screens, frame, frame);
+            }
+            fractalManager.readFrame(frames[i]);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("%s: %.3f ms/iter\n", i == 0 ? "gpu" : "cpu", 1000.0 * seconds / std::max(1, options.iterations));
+        }
+
+        int maxError = 0;
+        double totalError = 0.0;
+        for (size_t p = 0; p < frames[0].size(); ++p) {
+            int error = std::abs(static_cast<int>(frames[0][p]) - static_cast<int>(frames[1][p]));
+            maxError = std::max(maxError, error);
+            totalError += error;
+        }
+        std::printf("max difference %d, mean difference %.4f (8-bit steps)\n", maxError, totalError / std::max<size_t>(1, frames[0].size()));
+    }
+
+    // Chaos-game render at posterWidth, streamed to the output PNG band by band
+    void exportPoster(const Options& options, const std::vector<Screen>& screens) {
+        std::vector<ScreenInstance> instances;
+        for (const Screen& screen : screens) {
+            instances.push_back(ScreenInstance::from(screen));
+        }
+        ThreadPool pool(Config::CPU_COMPOSITOR_THREADS);
+        PosterExporter exporter(instances, options.width, options.height, pool);
+
+        auto start = std::chrono::steady_clock::now();
+        int reported = -1;
+        exporter.exportPng(options.outputPath, options.posterWidth, options.posterSamples, [&](float fraction) {
+            int percent = static_cast<int>(fraction * 100.0f);
+            if (percent != reported) {
+                reported = percent;
+                std::fprintf(stderr, "\rposter %3d%%", percent);
+                std::fflush(stderr);
+            }
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "\n" << options.outputPath << " written in " << seconds << " s" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    try {
+        // A binary scene is mapped and checked once; its records also feed setInstances below
+        std::unique_ptr<MappedScene> mapped;
+        std::vector<Screen> screens;
+        if (SceneIO::isBinary(options.scenePath)) {
+            mapped = std::make_unique<MappedScene>(options.scenePath);
+            screens = SceneIO::fromRecords(mapped->data(), mapped->size());
+        }
+        else {
+            screens = SceneIO::loadText(options.scenePath);
+        }
+        if (!options.saveScenePath.empty()) {
+            // Converts between the text and binary formats, chosen by extension
+            SceneIO::save(options.saveScenePath, screens);
+            return 0;
+        }
+        if (options.posterWidth > 0) {
+            // CPU only, so no GL context is needed
+            exportPoster(options, screens);
+            return 0;
+        }
+
+        ScreenStore store;
+        store.assign(screens);
+        HeadlessContext context;
+
+        glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(options.width), static_cast<float>(options.height), 0.0f, -1.0f, 1.0f);
+        if (options.benchmarkFormats) {
+            benchmarkFormats(options, store, projection);
+            return 0;
+        }
+        if (options.compareBackends) {
+            compareBackends(options, store, projection);
+            return 0;
+        }
+
+        FractalManager fractalManager(options.width, options.height, projection, options.format, options.backend);
+        fractalManager.setAdaptiveIterations(false);
+        fractalManager.setEngine(options.engine);
+        if (mapped) {
+            fractalManager.setInstances(mapped->data(), mapped->size(), 0);
+        }
+        if (!options.recordPath.empty()) {
+            // One video frame per iteration; offline, so wait for the writer instead of dropping
+            fractalManager.startRecording(options.recordPath, Config::FPS, false);
+        }
+
+        // Offline animation steps exactly 1 / FPS per iteration, so every recorded frame is
+        // at its own time no matter how long it takes to render
+        ScreenAnimator animator;
+        if (!options.animationPath.empty()) {
+            animator.load(options.animationPath, store);
+        }
+
+        // As in ScreenManager::applyAnimation, only a frame that changed a screen is a new
+        // revision, so renderers keep converging once every track is held
+        unsigned int revision = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < options.iterations; ++frame) {
+            if (!animator.empty() && !animator.apply(static_cast<double>(frame) / Config::FPS, store).empty()) {
+                revision++;
+            }
+            fractalManager.processFrame(store, revision, frame);
+            store.clearDirty();
+        }
+        fractalManager.stopRecording();
+        std::vector<Uint8> pixels;
+        fractalManager.readPresentedFrame(pixels);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        ImageIO::writeImage(options.outputPath, options.width, options.height, pixels.data());
+
+        std::cerr << options.iterations << " iterations of " << screens.size() << " screens at "
+                  << options.width << "x" << options.height << " in " << seconds << " s ("
+                  << (seconds > 0.0 ? options.iterations / seconds : 0.0) << " it/s)" << std::endl;
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
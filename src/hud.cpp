@@ -0,0 +1,175 @@
+#include "hud.h"
+#include "config.h"
+#include "shader_sources.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cctype>
+
+namespace {
+    constexpr int GLYPH_WIDTH = 5;
+    constexpr int GLYPH_HEIGHT = 7;
+    constexpr int CELL_WIDTH = 6;
+    constexpr int CELL_HEIGHT = 8;
+    constexpr int FIRST_GLYPH = 32;
+    constexpr int GLYPH_COUNT = 64;
+    // Extra fully lit cell after the glyphs, used for the backdrop
+    constexpr int SOLID_CELL = GLYPH_COUNT;
+    constexpr int ATLAS_WIDTH = (GLYPH_COUNT + 1) * CELL_WIDTH;
+
+    // ASCII 32 (space) to 95 (underscore), one 5-bit row per byte, leftmost pixel in bit 4
+    constexpr unsigned char FONT_5X7[GLYPH_COUNT][GLYPH_HEIGHT] = {
+        { 0, 0, 0, 0, 0, 0, 0 },        { 4, 4, 4, 4, 4, 0, 4 },        { 10, 10, 10, 0, 0, 0, 0 },
+        { 10, 10, 31, 10, 31, 10, 10 }, { 4, 15, 20, 14, 5, 30, 4 },    { 24, 25, 2, 4, 8, 19, 3 },
+        { 12, 18, 20, 8, 21, 18, 13 },  { 12, 4, 8, 0, 0, 0, 0 },       { 2, 4, 8, 8, 8, 4, 2 },
+        { 8, 4, 2, 2, 2, 4, 8 },        { 0, 4, 21, 14, 21, 4, 0 },     { 0, 4, 4, 31, 4, 4, 0 },
+        { 0, 0, 0, 0, 12, 4, 8 },       { 0, 0, 0, 31, 0, 0, 0 },       { 0, 0, 0, 0, 0, 12, 12 },
+        { 0, 1, 2, 4, 8, 16, 0 },       { 14, 17, 19, 21, 25, 17, 14 }, { 4, 12, 4, 4, 4, 4, 14 },
+        { 14, 17, 1, 2, 4, 8, 31 },     { 31, 2, 4, 2, 1, 17, 14 },     { 2, 6, 10, 18, 31, 2, 2 },
+        { 31, 16, 30, 1, 1, 17, 14 },   { 6, 8, 16, 30, 17, 17, 14 },   { 31, 1, 2, 4, 8, 8, 8 },
+        { 14, 17, 17, 14, 17, 17, 14 }, { 14, 17, 17, 15, 1, 2, 12 },   { 0, 12, 12, 0, 12, 12, 0 },
+        { 0, 12, 12, 0, 12, 4, 8 },     { 2, 4, 8, 16, 8, 4, 2 },       { 0, 0, 31, 0, 31, 0, 0 },
+        { 8, 4, 2, 1, 2, 4, 8 },        { 14, 17, 1, 2, 4, 0, 4 },      { 14, 17, 1, 13, 21, 21, 14 },
+        { 14, 17, 17, 17, 31, 17, 17 }, { 30, 17, 17, 30, 17, 17, 30 }, { 14, 17, 16, 16, 16, 17, 14 },
+        { 28, 18, 17, 17, 17, 18, 28 }, { 31, 16, 16, 30, 16, 16, 31 }, { 31, 16, 16, 30, 16, 16, 16 },
+        { 14, 17, 16, 23, 17, 17, 15 }, { 17, 17, 17, 31, 17, 17, 17 }, { 14, 4, 4, 4, 4, 4, 14 },
+        { 7, 2, 2, 2, 2, 18, 12 },      { 17, 18, 20, 24, 20, 18, 17 }, { 16, 16, 16, 16, 16, 16, 31 },
+        { 17, 27, 21, 21, 17, 17, 17 }, { 17, 17, 25, 21, 19, 17, 17 }, { 14, 17, 17, 17, 17, 17, 14 },
+        { 30, 17, 17, 30, 16, 16, 16 }, { 14, 17, 17, 17, 21, 18, 13 }, { 30, 17, 17, 30, 20, 18, 17 },
+        { 15, 16, 16, 14, 1, 1, 30 },   { 31, 4, 4, 4, 4, 4, 4 },       { 17, 17, 17, 17, 17, 17, 14 },
+        { 17, 17, 17, 17, 17, 10, 4 },  { 17, 17, 17, 21, 21, 21, 10 }, { 17, 17, 10, 4, 10, 17, 17 },
+        { 17, 17, 17, 10, 4, 4, 4 },    { 31, 1, 2, 4, 8, 16, 31 },     { 14, 8, 8, 8, 8, 8, 14 },
+        { 0, 16, 8, 4, 2, 1, 0 },       { 14, 2, 2, 2, 2, 2, 14 },      { 4, 10, 17, 0, 0, 0, 0 },
+        { 0, 0, 0, 0, 0, 0, 31 }
+    };
+}
+
+Hud::Hud(int width, int height) : vertexCapacity(0), vertexCount(0) {
+    shader = std::make_unique<ShaderProgram>(ShaderSources::HUD_VERTEX, ShaderSources::HUD_FRAGMENT);
+    projectionLoc = shader->getUniformLocation("projection");
+    fontLoc = shader->getUniformLocation("font");
+    colorLoc = shader->getUniformLocation("color");
+    projection = glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, -1.0f, 1.0f);
+
+    std::vector<unsigned char> atlas(ATLAS_WIDTH * CELL_HEIGHT, 0);
+    for (int glyph = 0; glyph < GLYPH_COUNT; ++glyph) {
+        for (int row = 0; row < GLYPH_HEIGHT; ++row) {
+            for (int col = 0; col < GLYPH_WIDTH; ++col) {
+                if (FONT_5X7[glyph][row] & (1 << (GLYPH_WIDTH - 1 - col))) {
+                    atlas[row * ATLAS_WIDTH + glyph * CELL_WIDTH + col] = 255;
+                }
+            }
+        }
+    }
+    for (int row = 0; row < CELL_HEIGHT; ++row) {
+        for (int col = 0; col < CELL_WIDTH; ++col) {
+            atlas[row * ATLAS_WIDTH + SOLID_CELL * CELL_WIDTH + col] = 255;
+        }
+    }
+
+    glGenTextures(1, &fontTexture);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, CELL_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+Hud::~Hud() {
+    glDeleteTextures(1, &fontTexture);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+void Hud::appendQuad(float x, float y, float w, float h, int cell) {
+    float u0 = static_cast<float>(cell * CELL_WIDTH) / ATLAS_WIDTH;
+    float u1 = static_cast<float>(cell * CELL_WIDTH + GLYPH_WIDTH) / ATLAS_WIDTH;
+    float v0 = 0.0f;
+    float v1 = static_cast<float>(GLYPH_HEIGHT) / CELL_HEIGHT;
+    const float quad[6][4] = {
+        { x, y, u0, v0 }, { x + w, y, u1, v0 }, { x + w, y + h, u1, v1 },
+        { x, y, u0, v0 }, { x + w, y + h, u1, v1 }, { x, y + h, u0, v1 }
+    };
+    for (const auto& vertex : quad) {
+        vertices.insert(vertices.end(), vertex, vertex + 4);
+    }
+}
+
+void Hud::setLines(const std::vector<std::string>& lines) {
+    if (lines == currentLines) {
+        return;
+    }
+    currentLines = lines;
+
+    const float scale = static_cast<float>(Config::HUD_SCALE);
+    const float margin = 4.0f * scale;
+    size_t longest = 0;
+    for (const auto& line : lines) {
+        longest = std::max(longest, line.size());
+    }
+
+    vertices.clear();
+    if (!lines.empty()) {
+        appendQuad(0.0f, 0.0f, longest * CELL_WIDTH * scale + 2.0f * margin,
+            lines.size() * CELL_HEIGHT * scale + 2.0f * margin, SOLID_CELL);
+    }
+    for (size_t row = 0; row < lines.size(); ++row) {
+        for (size_t col = 0; col < lines[row].size(); ++col) {
+            int c = std::toupper(static_cast<unsigned char>(lines[row][col]));
+            if (c <= FIRST_GLYPH || c >= FIRST_GLYPH + GLYPH_COUNT) {
+                continue;
+            }
+            appendQuad(margin + col * CELL_WIDTH * scale, margin + row * CELL_HEIGHT * scale,
+                GLYPH_WIDTH * scale, GLYPH_HEIGHT * scale, c - FIRST_GLYPH);
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (vertices.size() > vertexCapacity) {
+        vertexCapacity = vertices.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (!vertices.empty()) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vertexCount = static_cast<GLsizei>(vertices.size() / 4);
+}
+
+void Hud::draw() {
+    if (vertexCount == 0) {
+        return;
+    }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    shader->use();
+    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, &projection[0][0]);
+    glUniform1i(fontLoc, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glBindVertexArray(vao);
+
+    // Backdrop first, then the glyphs
+    glUniform4f(colorLoc, 0.0f, 0.0f, 0.0f, 0.6f);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glUniform4f(colorLoc, 0.85f, 1.0f, 0.85f, 1.0f);
+    glDrawArrays(GL_TRIANGLES, 6, vertexCount - 6);
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
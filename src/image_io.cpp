@@ -0,0 +1,400 @@
+#include "image_io.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    void putBigEndian(Uint8* out, uint32_t value) {
+        out[0] = static_cast<Uint8>(value >> 24);
+        out[1] = static_cast<Uint8>(value >> 16);
+        out[2] = static_cast<Uint8>(value >> 8);
+        out[3] = static_cast<Uint8>(value);
+    }
+
+    uint32_t getBigEndian(const Uint8* in) {
+        return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+               (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+    }
+
+    Uint8 paeth(int a, int b, int c) {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) return static_cast<Uint8>(a);
+        return static_cast<Uint8>(pb <= pc ? b : c);
+    }
+
+    void expandToRgba(const Uint8* source, int channels, size_t pixelCount, std::vector<Uint8>& rgba) {
+        rgba.resize(pixelCount * 4);
+        if (channels == 4) {
+            std::memcpy(rgba.data(), source, rgba.size());
+            return;
+        }
+        for (size_t i = 0; i < pixelCount; ++i) {
+            rgba[i * 4 + 0] = source[i * 3 + 0];
+            rgba[i * 4 + 1] = source[i * 3 + 1];
+            rgba[i * 4 + 2] = source[i * 3 + 2];
+            rgba[i * 4 + 3] = 255;
+        }
+    }
+
+    constexpr int PARALLEL_BLOCK_ROWS = 64;
+
+    // Raw deflate of one block of unfiltered rows. Blocks end on a sync flush so the next
+    // one can start at a byte boundary; the image's last block finishes the stream instead.
+    void deflateBlock(const Uint8* rgba, int width, int rows, bool last, std::vector<Uint8>& out, uLong& adler) {
+        z_stream block;
+        std::memset(&block, 0, sizeof(block));
+        if (deflateInit2(&block, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("Failed to initialize zlib");
+        }
+
+        size_t stride = static_cast<size_t>(width) * 4;
+        std::vector<Uint8> row(stride + 1, 0);
+        out.resize(deflateBound(&block, static_cast<uLong>(rows * row.size())) + 64);
+        block.next_out = out.data();
+        block.avail_out = static_cast<uInt>(out.size());
+        adler = adler32(0L, Z_NULL, 0);
+
+        for (int y = 0; y < rows; ++y) {
+            std::memcpy(row.data() + 1, rgba + y * stride, stride);
+            adler = adler32(adler, row.data(), static_cast<uInt>(row.size()));
+            block.next_in = row.data();
+            block.avail_in = static_cast<uInt>(row.size());
+            int flush = y + 1 < rows ? Z_NO_FLUSH : (last ? Z_FINISH : Z_SYNC_FLUSH);
+            for (;;) {
+                int result = deflate(&block, flush);
+                if (block.avail_out != 0 && (flush != Z_FINISH || result == Z_STREAM_END)) {
+                    break;
+                }
+                size_t used = out.size() - block.avail_out;
+                out.resize(out.size() * 2);
+                block.next_out = out.data() + used;
+                block.avail_out = static_cast<uInt>(out.size() - used);
+            }
+        }
+        out.resize(out.size() - block.avail_out);
+        deflateEnd(&block);
+    }
+
+    bool hasExtension(const std::string& path, const char* extension) {
+        size_t length = std::strlen(extension);
+        return path.size() >= length && path.compare(path.size() - length, length, extension) == 0;
+    }
+}
+
+PngWriter::PngWriter(const std::string& path, int width, int height, ThreadPool* pool)
+    : file(nullptr), pool(pool), width(width), height(height), rowsWritten(0), finished(false),
+      rowBuffer(static_cast<size_t>(width) * 4 + 1), outBuffer(1 << 16), adler(adler32(0L, Z_NULL, 0)) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Could not open " + path + " for writing");
+    }
+
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit(&stream, Z_BEST_SPEED) != Z_OK) {
+        std::fclose(file);
+        throw std::runtime_error("Failed to initialize zlib");
+    }
+    stream.next_out = outBuffer.data();
+    stream.avail_out = static_cast<uInt>(outBuffer.size());
+
+    static const Uint8 signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    std::fwrite(signature, 1, sizeof(signature), file);
+
+    Uint8 header[13];
+    putBigEndian(header, width);
+    putBigEndian(header + 4, height);
+    header[8] = 8;   // bit depth
+    header[9] = 6;   // RGBA
+    header[10] = 0;  // deflate
+    header[11] = 0;  // adaptive filtering
+    header[12] = 0;  // no interlace
+    writeChunk("IHDR", header, sizeof(header));
+}
+
+PngWriter::~PngWriter() {
+    deflateEnd(&stream);
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+void PngWriter::writeChunk(const char* type, const Uint8* data, size_t size) {
+    Uint8 word[4];
+    putBigEndian(word, static_cast<uint32_t>(size));
+    std::fwrite(word, 1, 4, file);
+    std::fwrite(type, 1, 4, file);
+    if (size) {
+        std::fwrite(data, 1, size, file);
+    }
+
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+    if (size) {
+        crc = crc32(crc, data, static_cast<uInt>(size));
+    }
+    putBigEndian(word, static_cast<uint32_t>(crc));
+    std::fwrite(word, 1, 4, file);
+}
+
+void PngWriter::flushDeflate(int flush) {
+    // IDAT chunks are only emitted when the output buffer fills up, or at the end
+    for (;;) {
+        deflate(&stream, flush);
+        if (stream.avail_out != 0) {
+            break;
+        }
+        writeChunk("IDAT", outBuffer.data(), outBuffer.size());
+        stream.next_out = outBuffer.data();
+        stream.avail_out = static_cast<uInt>(outBuffer.size());
+    }
+
+    size_t pending = outBuffer.size() - stream.avail_out;
+    if (flush == Z_FINISH && pending) {
+        writeChunk("IDAT", outBuffer.data(), pending);
+    }
+}
+
+void PngWriter::writeRows(const Uint8* rgba, int rows) {
+    if (finished || rowsWritten + rows > height) {
+        throw std::runtime_error("PNG row count exceeds image height");
+    }
+
+    if (pool) {
+        writeRowsParallel(rgba, rows);
+        return;
+    }
+
+    size_t stride = static_cast<size_t>(width) * 4;
+    for (int y = 0; y < rows; ++y) {
+        // Filter type 0 keeps encoding cheap; zlib still finds the long runs
+        rowBuffer[0] = 0;
+        std::memcpy(rowBuffer.data() + 1, rgba + y * stride, stride);
+        stream.next_in = rowBuffer.data();
+        stream.avail_in = static_cast<uInt>(rowBuffer.size());
+        flushDeflate(Z_NO_FLUSH);
+    }
+    rowsWritten += rows;
+}
+
+void PngWriter::writeRowsParallel(const Uint8* rgba, int rows) {
+    if (rowsWritten == 0) {
+        // zlib header: deflate, 32K window, fastest
+        static const Uint8 header[2] = { 0x78, 0x01 };
+        writeChunk("IDAT", header, sizeof(header));
+    }
+
+    size_t stride = static_cast<size_t>(width) * 4;
+    bool lastRows = rowsWritten + rows == height;
+    size_t blockCount = (rows + PARALLEL_BLOCK_ROWS - 1) / PARALLEL_BLOCK_ROWS;
+    blocks.resize(blockCount);
+    blockAdlers.resize(blockCount);
+    pool->parallelFor(blockCount, [&](size_t index, int) {
+        int first = static_cast<int>(index) * PARALLEL_BLOCK_ROWS;
+        int count = std::min(PARALLEL_BLOCK_ROWS, rows - first);
+        deflateBlock(rgba + first * stride, width, count, lastRows && index + 1 == blockCount, blocks[index], blockAdlers[index]);
+    });
+
+    for (size_t i = 0; i < blockCount; ++i) {
+        int count = std::min(PARALLEL_BLOCK_ROWS, rows - static_cast<int>(i) * PARALLEL_BLOCK_ROWS);
+        adler = adler32_combine(adler, blockAdlers[i], static_cast<z_off_t>(count * (stride + 1)));
+        writeChunk("IDAT", blocks[i].data(), blocks[i].size());
+    }
+    rowsWritten += rows;
+}
+
+void PngWriter::finish() {
+    if (finished) {
+        return;
+    }
+    if (rowsWritten != height) {
+        throw std::runtime_error("PNG finished before all rows were written");
+    }
+
+    if (pool) {
+        Uint8 trailer[4];
+        putBigEndian(trailer, static_cast<uint32_t>(adler));
+        writeChunk("IDAT", trailer, sizeof(trailer));
+    }
+    else {
+        stream.next_in = nullptr;
+        stream.avail_in = 0;
+        flushDeflate(Z_FINISH);
+    }
+    writeChunk("IEND", nullptr, 0);
+    finished = true;
+
+    if (std::fclose(file) != 0) {
+        file = nullptr;
+        throw std::runtime_error("Failed to write PNG");
+    }
+    file = nullptr;
+}
+
+namespace ImageIO {
+    void writePNG(const std::string& path, int width, int height, const Uint8* rgba) {
+        PngWriter writer(path, width, height);
+        writer.writeRows(rgba, height);
+        writer.finish();
+    }
+
+    void writePAM(const std::string& path, int width, int height, const Uint8* rgba) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Could not open " + path + " for writing");
+        }
+        file << "P7\nWIDTH " << width << "\nHEIGHT " << height
+             << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+        file.write(reinterpret_cast<const char*>(rgba), static_cast<std::streamsize>(width) * height * 4);
+        if (!file) {
+            throw std::runtime_error("Failed to write " + path);
+        }
+    }
+
+    void writeImage(const std::string& path, int width, int height, const Uint8* rgba) {
+        if (hasExtension(path, ".pam")) {
+            writePAM(path, width, height, rgba);
+        }
+        else if (hasExtension(path, ".png")) {
+            writePNG(path, width, height, rgba);
+        }
+        else {
+            throw std::runtime_error("Unsupported image format: " + path);
+        }
+    }
+
+    void readPNG(const std::string& path, int& width, int& height, std::vector<Uint8>& rgba) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Could not open " + path);
+        }
+
+        static const Uint8 expected[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+        Uint8 signature[8];
+        file.read(reinterpret_cast<char*>(signature), sizeof(signature));
+        if (!file || std::memcmp(signature, expected, sizeof(expected)) != 0) {
+            throw std::runtime_error(path + " is not a PNG file");
+        }
+
+        int channels = 0;
+        width = height = 0;
+        std::vector<Uint8> compressed;
+        std::vector<Uint8> data;
+        for (;;) {
+            Uint8 header[8];
+            file.read(reinterpret_cast<char*>(header), sizeof(header));
+            if (!file) {
+                throw std::runtime_error("Truncated PNG: " + path);
+            }
+            uint32_t length = getBigEndian(header);
+            std::string type(reinterpret_cast<const char*>(header + 4), 4);
+            data.resize(length);
+            file.read(reinterpret_cast<char*>(data.data()), length);
+            file.ignore(4);  // CRC
+            if (!file) {
+                throw std::runtime_error("Truncated PNG: " + path);
+            }
+
+            if (type == "IHDR") {
+                width = static_cast<int>(getBigEndian(data.data()));
+                height = static_cast<int>(getBigEndian(data.data() + 4));
+                int bitDepth = data[8];
+                int colorType = data[9];
+                int interlace = data[12];
+                if (bitDepth != 8 || (colorType != 2 && colorType != 6) || interlace != 0) {
+                    throw std::runtime_error("Unsupported PNG layout: " + path);
+                }
+                channels = colorType == 6 ? 4 : 3;
+            }
+            else if (type == "IDAT") {
+                compressed.insert(compressed.end(), data.begin(), data.end());
+            }
+            else if (type == "IEND") {
+                break;
+            }
+        }
+        if (channels == 0) {
+            throw std::runtime_error("PNG without a header: " + path);
+        }
+
+        size_t stride = static_cast<size_t>(width) * channels;
+        std::vector<Uint8> raw((stride + 1) * height);
+        uLongf rawSize = static_cast<uLongf>(raw.size());
+        if (uncompress(raw.data(), &rawSize, compressed.data(), static_cast<uLong>(compressed.size())) != Z_OK || rawSize != raw.size()) {
+            throw std::runtime_error("Corrupt PNG data: " + path);
+        }
+
+        // Undo the per-row filters in place; each row ends up packed at raw + y * stride
+        std::vector<Uint8> zeroRow(stride, 0);
+        for (int y = 0; y < height; ++y) {
+            Uint8 filter = raw[y * (stride + 1)];
+            const Uint8* in = raw.data() + y * (stride + 1) + 1;
+            Uint8* out = raw.data() + y * stride;
+            const Uint8* prev = y > 0 ? raw.data() + (y - 1) * stride : zeroRow.data();
+            for (size_t i = 0; i < stride; ++i) {
+                int a = i >= static_cast<size_t>(channels) ? out[i - channels] : 0;
+                int b = prev[i];
+                int c = i >= static_cast<size_t>(channels) ? prev[i - channels] : 0;
+                Uint8 value = in[i];
+                switch (filter) {
+                case 0: break;
+                case 1: value = static_cast<Uint8>(value + a); break;
+                case 2: value = static_cast<Uint8>(value + b); break;
+                case 3: value = static_cast<Uint8>(value + (a + b) / 2); break;
+                case 4: value = static_cast<Uint8>(value + paeth(a, b, c)); break;
+                default:
+                    throw std::runtime_error("Corrupt PNG filter: " + path);
+                }
+                out[i] = value;
+            }
+        }
+
+        expandToRgba(raw.data(), channels, static_cast<size_t>(width) * height, rgba);
+    }
+
+    void readPAM(const std::string& path, int& width, int& height, std::vector<Uint8>& rgba) {
+        std::ifstream file(path, std::ios::binary);
+        std::string token;
+        if (!file || !(file >> token) || token != "P7") {
+            throw std::runtime_error(path + " is not a PAM file");
+        }
+
+        int depth = 0;
+        int maxValue = 0;
+        width = height = 0;
+        while (file >> token && token != "ENDHDR") {
+            if (token == "WIDTH") file >> width;
+            else if (token == "HEIGHT") file >> height;
+            else if (token == "DEPTH") file >> depth;
+            else if (token == "MAXVAL") file >> maxValue;
+            else if (token == "TUPLTYPE") file >> token;
+            else if (token[0] == '#') std::getline(file, token);
+        }
+        file.get();
+        if (!file || width <= 0 || height <= 0 || maxValue != 255 || (depth != 3 && depth != 4)) {
+            throw std::runtime_error("Unsupported PAM layout: " + path);
+        }
+
+        std::vector<Uint8> raw(static_cast<size_t>(width) * height * depth);
+        file.read(reinterpret_cast<char*>(raw.data()), static_cast<std::streamsize>(raw.size()));
+        if (!file) {
+            throw std::runtime_error("Truncated PAM: " + path);
+        }
+        expandToRgba(raw.data(), depth, static_cast<size_t>(width) * height, rgba);
+    }
+
+    void readImage(const std::string& path, int& width, int& height, std::vector<Uint8>& rgba) {
+        if (hasExtension(path, ".pam")) {
+            readPAM(path, width, height, rgba);
+        }
+        else if (hasExtension(path, ".png")) {
+            readPNG(path, width, height, rgba);
+        }
+        else {
+            throw std::runtime_error("Unsupported image format: " + path);
+        }
+    }
+}
@@ -0,0 +1,208 @@
+#include "input_log.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+    const char MAGIC[8] = { 'F', 'R', 'I', 'N', 'P', 'U', 'T', '\0' };
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t TRACKED_KEY_COUNT = sizeof(InputLog::TRACKED_KEYS) / sizeof(InputLog::TRACKED_KEYS[0]);
+    static_assert(TRACKED_KEY_COUNT <= 16, "Tracked keys must fit InputFrame::keys");
+
+    int16_t clampCoordinate(int value) {
+        return static_cast<int16_t>(std::max(-32768, std::min(32767, value)));
+    }
+
+    // False for event types InputManager ignores, which are left out of the log
+    bool encode(const SDL_Event& event, InputLog::EventRecord& record) {
+        record = {};
+        switch (event.type) {
+        case SDL_QUIT:
+            record.kind = InputLog::EventKind::Quit;
+            return true;
+        case SDL_MOUSEBUTTONDOWN:
+            record.kind = InputLog::EventKind::MouseButtonDown;
+            record.button = event.button.button;
+            record.a = event.button.x;
+            record.b = event.button.y;
+            return true;
+        case SDL_MOUSEWHEEL:
+            record.kind = InputLog::EventKind::MouseWheel;
+            record.a = event.wheel.y;
+            return true;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            record.kind = event.type == SDL_KEYDOWN ? InputLog::EventKind::KeyDown : InputLog::EventKind::KeyUp;
+            record.a = event.key.keysym.sym;
+            record.b = event.key.keysym.scancode;
+            return true;
+        case SDL_MOUSEMOTION:
+            record.kind = InputLog::EventKind::MouseMotion;
+            record.a = event.motion.x;
+            record.b = event.motion.y;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    SDL_Event decode(const InputLog::EventRecord& record) {
+        SDL_Event event;
+        std::memset(&event, 0, sizeof(event));
+        switch (record.kind) {
+        case InputLog::EventKind::Quit:
+            event.type = SDL_QUIT;
+            break;
+        case InputLog::EventKind::MouseButtonDown:
+            event.type = SDL_MOUSEBUTTONDOWN;
+            event.button.button = record.button;
+            event.button.state = SDL_PRESSED;
+            event.button.x = record.a;
+            event.button.y = record.b;
+            break;
+        case InputLog::EventKind::MouseWheel:
+            event.type = SDL_MOUSEWHEEL;
+            event.wheel.y = record.a;
+            break;
+        case InputLog::EventKind::KeyDown:
+        case InputLog::EventKind::KeyUp:
+            event.type = record.kind == InputLog::EventKind::KeyDown ? SDL_KEYDOWN : SDL_KEYUP;
+            event.key.state = record.kind == InputLog::EventKind::KeyDown ? SDL_PRESSED : SDL_RELEASED;
+            event.key.keysym.sym = record.a;
+            event.key.keysym.scancode = static_cast<SDL_Scancode>(record.b);
+            break;
+        case InputLog::EventKind::MouseMotion:
+            event.type = SDL_MOUSEMOTION;
+            event.motion.x = record.a;
+            event.motion.y = record.b;
+            break;
+        default:
+            throw std::runtime_error("Unknown event in input log");
+        }
+        return event;
+    }
+}
+
+bool InputFrame::isKeyDown(SDL_Scancode scancode) const {
+    for (size_t i = 0; i < TRACKED_KEY_COUNT; ++i) {
+        if (InputLog::TRACKED_KEYS[i] == scancode) {
+            return (keys >> i) & 1;
+        }
+    }
+    return false;
+}
+
+namespace InputLog {
+    InputFrame capture(float deltaSeconds) {
+        InputFrame frame;
+        frame.deltaSeconds = deltaSeconds;
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            frame.events.push_back(event);
+        }
+        frame.mouseButtons = SDL_GetMouseState(&frame.mouseX, &frame.mouseY);
+        const Uint8* keyState = SDL_GetKeyboardState(nullptr);
+        for (size_t i = 0; i < TRACKED_KEY_COUNT; ++i) {
+            if (keyState[TRACKED_KEYS[i]]) {
+                frame.keys |= static_cast<uint16_t>(1u << i);
+            }
+        }
+        return frame;
+    }
+}
+
+InputRecorder::InputRecorder(const std::string& path, int width, int height, const std::vector<ScreenInstance>& scene)
+    : file(path, std::ios::binary) {
+    if (!file) {
+        throw std::runtime_error("Failed to open input log for writing: " + path);
+    }
+    InputLog::FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.width = width;
+    header.height = height;
+    header.screenCount = static_cast<uint32_t>(scene.size());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(scene.data()), static_cast<std::streamsize>(scene.size() * sizeof(ScreenInstance)));
+    if (!file) {
+        throw std::runtime_error("Failed to write input log: " + path);
+    }
+}
+
+void InputRecorder::write(const InputFrame& frame) {
+    events.clear();
+    for (const SDL_Event& event : frame.events) {
+        InputLog::EventRecord record;
+        if (encode(event, record) && events.size() < UINT16_MAX) {
+            events.push_back(record);
+        }
+    }
+
+    InputLog::FrameRecord record = {};
+    record.deltaSeconds = frame.deltaSeconds;
+    record.mouseX = clampCoordinate(frame.mouseX);
+    record.mouseY = clampCoordinate(frame.mouseY);
+    record.keys = frame.keys;
+    record.eventCount = static_cast<uint16_t>(events.size());
+    record.mouseButtons = static_cast<uint8_t>(frame.mouseButtons);
+    file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    file.write(reinterpret_cast<const char*>(events.data()), static_cast<std::streamsize>(events.size() * sizeof(InputLog::EventRecord)));
+    if (!file) {
+        throw std::runtime_error("Failed to write input log");
+    }
+}
+
+InputReplay::InputReplay(const std::string& path) : cursor(0), width(0), height(0) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open input log: " + path);
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    InputLog::FileHeader header;
+    if (data.size() < sizeof(header)) {
+        throw std::runtime_error("Input log is truncated: " + path);
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        throw std::runtime_error("Not a supported input log: " + path);
+    }
+    if (header.width <= 0 || header.height <= 0 ||
+        header.screenCount > (data.size() - sizeof(header)) / sizeof(ScreenInstance)) {
+        throw std::runtime_error("Input log header is corrupt: " + path);
+    }
+    width = header.width;
+    height = header.height;
+    scene.resize(header.screenCount);
+    std::memcpy(scene.data(), data.data() + sizeof(header), scene.size() * sizeof(ScreenInstance));
+    cursor = sizeof(header) + scene.size() * sizeof(ScreenInstance);
+}
+
+bool InputReplay::next(InputFrame& frame) {
+    InputLog::FrameRecord record;
+    if (data.size() - cursor < sizeof(record)) {
+        return false;
+    }
+    std::memcpy(&record, data.data() + cursor, sizeof(record));
+    size_t eventBytes = record.eventCount * sizeof(InputLog::EventRecord);
+    // A recording cut off mid-frame ends at the last whole frame
+    if (data.size() - cursor - sizeof(record) < eventBytes) {
+        return false;
+    }
+    cursor += sizeof(record);
+
+    frame.deltaSeconds = record.deltaSeconds;
+    frame.mouseX = record.mouseX;
+    frame.mouseY = record.mouseY;
+    frame.mouseButtons = record.mouseButtons;
+    frame.keys = record.keys;
+    frame.events.clear();
+    for (uint16_t i = 0; i < record.eventCount; ++i) {
+        InputLog::EventRecord event;
+        std::memcpy(&event, data.data() + cursor, sizeof(event));
+        cursor += sizeof(event);
+        frame.events.push_back(decode(event));
+    }
+    return true;
+}
@@ -12,14 +12,16 @@
 #include "screen.h"
 #include "screen_manager.h"
 #include "fractal_manager.h"
-#include "math_utils.h"
 #include "shader_manager.h"
+#include "shader_sources.h"
 #include "input_manager.h"
+#include "scene_io.h"
 #include <iostream>
+#include <cstdio>
 #include <ctime>
 #include <fstream>
 
-InputManager::InputManager() {
+InputManager::InputManager(const std::string& replayPath) {
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         throw std::runtime_error(SDL_GetError());
     }
@@ -28,11 +30,24 @@ InputManager::InputManager() {
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
-    int displayIndex = 0;
-    SDL_Rect displayBounds;
-    SDL_GetDisplayBounds(displayIndex, &displayBounds);
-    width = displayBounds.w;
-    height = displayBounds.h;
+    if (!replayPath.empty()) {
+        try {
+            inputReplay = std::make_unique<InputReplay>(replayPath);
+        }
+        catch (...) {
+            SDL_Quit();
+            throw;
+        }
+        width = inputReplay->getWidth();
+        height = inputReplay->getHeight();
+    }
+    else {
+        int displayIndex = 0;
+        SDL_Rect displayBounds;
+        SDL_GetDisplayBounds(displayIndex, &displayBounds);
+        width = displayBounds.w;
+        height = displayBounds.h;
+    }
     
     window = SDL_CreateWindow("Fractal Visualizer", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_BORDERLESS);
 
@@ -56,40 +71,8 @@ InputManager::InputManager() {
     glViewport(0, 0, width, height);
     glEnable(GL_BLEND);
     glBlendFunc(GL_ONE, GL_ONE);
-    const char* vertexShaderSrc = R"(
-        #version 330 core
-        layout(location = 0) in vec2 pos;
-        layout(location = 1) in vec2 texCoord;
-        uniform mat4 projection;
-        uniform mat4 model;
-        out vec2 vTexCoord;
-        void main() {
-            gl_Position = projection * model * vec4(pos, 0.0, 1.0);
-            vTexCoord = texCoord;
-        }
-    )";
-    const char* textureFragmentShaderSrc = R"(
-        #version 330 core
-        in vec2 vTexCoord;
-        uniform sampler2D tex;
-        uniform vec4 color;
-        out vec4 fragColor;
-        void main() {
-            vec4 texColor = texture(tex, vTexCoord);
-            fragColor = texColor * color;
-        }
-    )";
-    const char* colorFragmentShaderSrc = R"(
-        #version 330 core
-        uniform vec4 color;
-        out vec4 fragColor;
-        void main() {
-            fragColor = color;
-        }
-    )";
-    
-    textureShaderProgram = ShaderManager::createShaderProgram(vertexShaderSrc, textureFragmentShaderSrc);
-    colorShaderProgram = ShaderManager::createShaderProgram(vertexShaderSrc, colorFragmentShaderSrc);
+    colorShader = std::make_unique<ShaderProgram>(ShaderSources::QUAD_VERTEX, ShaderSources::COLOR_FRAGMENT);
+    outlineUniforms = OtherRenders::resolveOutlineUniforms(*colorShader);
     projection = glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, -1.0f, 1.0f);
     float vertices[] = {
         0.0f, 0.0f, 0.0f, 0.0f,
@@ -109,46 +92,141 @@ InputManager::InputManager() {
     glEnableVertexAttribArray(1);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
-    fractalManager = std::make_unique<FractalManager>(width, height, textureShaderProgram, colorShaderProgram, projection);
+    fractalManager = std::make_unique<FractalManager>(width, height, projection);
     screenManager = std::make_unique<ScreenManager>(width, height);
+    profiler = std::make_unique<Profiler>();
+    hud = std::make_unique<Hud>(width, height);
+    framePacer = std::make_unique<FramePacer>(Config::PACING_MODE, Config::FPS);
+    capturedFrames = 0;
+    pendingAlpha = 0.0f;
     frameCounter = 0;
     scalingMode = false;
     scaleStartPos = { 0, 0 };
     originalDimensions = { 0, 0 };
     frozenFrame = 0;
+    currentFrame = 0;
+    unrendered = { 0, 0 };
+    snapshots = std::make_unique<SceneSnapshots>();
+    rendering = false;
     tempWidth = 0;
     tempHeight = 0;
+    animator = std::make_unique<ScreenAnimator>();
+    animationTime = 0.0;
+    animationPlaying = true;
+
+    if (inputReplay) {
+        // Fixed work per frame and no pacing sleeps, so frame times only reflect the build
+        screenManager->setScreens(SceneIO::fromRecords(inputReplay->getScene().data(), inputReplay->getScene().size()));
+        fractalManager->setAdaptiveIterations(false);
+        framePacer->setMode(Config::PacingMode::Uncapped);
+    }
+    else {
+        fractalManager->setDynamicResolution(Config::DYNAMIC_RESOLUTION);
+    }
 }
 
 InputManager::~InputManager() {
+    stopRenderThread();
     if (frozenFrame) {
         glDeleteTextures(1, &frozenFrame);
     }
-    glDeleteProgram(textureShaderProgram);
-    glDeleteProgram(colorShaderProgram);
     glDeleteBuffers(1, &vbo);
     glDeleteVertexArrays(1, &vao);
     fractalManager.reset();
     screenManager.reset();
+    profiler.reset();
+    hud.reset();
+    colorShader.reset();
     SDL_GL_DeleteContext(glContext);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
 void InputManager::run() {
+    // Replays render in lockstep with their input so frame times stay comparable
+    bool threaded = Config::RENDER_THREAD && !inputReplay;
+    publishScene(0.0f, 0.0f);
+    if (threaded) {
+        SDL_GL_MakeCurrent(window, nullptr);
+        rendering = true;
+        renderThread = std::thread(&InputManager::renderLoop, this);
+    }
+
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 inputPeriod = frequency / Config::INPUT_RATE;
+    Uint64 lastTick = SDL_GetPerformanceCounter();
+    auto elapsedMs = [frequency](Uint64 since) {
+        return static_cast<float>((SDL_GetPerformanceCounter() - since) * 1000.0 / frequency);
+    };
     running = true;
     while (running) {
-        running = handleEvents();
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        float deltaSeconds;
+        if (threaded) {
+            deltaSeconds = std::min(static_cast<float>(frameStart - lastTick) / frequency, Config::MAX_FRAME_DELTA);
+            lastTick = frameStart;
+        }
+        else {
+            deltaSeconds = framePacer->beginFrame();
+        }
+
+        running = handleEvents(deltaSeconds) && (!threaded || rendering);
+        float eventsMs = elapsedMs(frameStart);
+        Uint64 updateStart = SDL_GetPerformanceCounter();
         update();
-        draw();
-        frameCounter++;
-        SDL_Delay(1000 / Config::FPS);
+        publishScene(eventsMs, elapsedMs(updateStart));
+
+        if (threaded) {
+            Uint64 elapsed = SDL_GetPerformanceCounter() - frameStart;
+            if (elapsed < inputPeriod) {
+                SDL_Delay(static_cast<Uint32>((inputPeriod - elapsed) * 1000 / frequency));
+            }
+            continue;
+        }
+        renderFrame();
+        framePacer->endFrame();
+        profiler->endFrame();
+        if (inputReplay) {
+            replayFrameMs.push_back(elapsedMs(frameStart));
+        }
+    }
+
+    stopRenderThread();
+    if (renderError) {
+        std::rethrow_exception(renderError);
+    }
+    if (inputReplay) {
+        reportReplay();
     }
 }
 
-bool InputManager::handleEvents() {
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
+void InputManager::recordInput(const std::string& path) {
+    std::vector<ScreenInstance> scene(screenManager->getStore().size());
+    screenManager->getStore().writeInstances(scene.data(), { 0, static_cast<uint32_t>(scene.size()) });
+    inputRecorder = std::make_unique<InputRecorder>(path, width, height, scene);
+}
+
+bool InputManager::handleEvents(float deltaSeconds) {
+    if (inputReplay) {
+        // Live input is ignored apart from closing the window
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                return false;
+            }
+        }
+        if (!inputReplay->next(input)) {
+            return false;
+        }
+    }
+    else {
+        input = InputLog::capture(deltaSeconds);
+    }
+    if (inputRecorder) {
+        inputRecorder->write(input);
+    }
+
+    for (const SDL_Event& event : input.events) {
         switch (event.type) {
         case SDL_QUIT:
             return false;
@@ -163,6 +241,56 @@ bool InputManager::handleEvents() {
             }
             break;
         case SDL_KEYDOWN:
+            // A replay ignores pacing and every key that reads or writes local files, so it
+            // stays deterministic and leaves the saved scene alone
+            if (event.key.keysym.sym == SDLK_F3) {
+                settings.showHud = !settings.showHud;
+            }
+            else if (event.key.keysym.sym == SDLK_F4 && !inputReplay) {
+                settings.pacingCycles++;
+            }
+            else if (event.key.keysym.sym == SDLK_F5 && !inputReplay) {
+                settings.capturing = !settings.capturing;
+            }
+            else if (event.key.keysym.sym == SDLK_p) {
+                animationPlaying = !animationPlaying;
+            }
+            else if (event.key.keysym.sym == SDLK_h) {
+                toggleColorAnimation(true);
+            }
+            else if (event.key.keysym.sym == SDLK_j) {
+                toggleColorAnimation(false);
+            }
+            else if (event.key.keysym.sym == SDLK_F7 && !inputReplay) {
+                settings.recording = !settings.recording;
+            }
+            else if (event.key.keysym.sym == SDLK_F8) {
+                int next = (static_cast<int>(settings.toneMap) + 1) % 3;
+                settings.toneMap = static_cast<Config::ToneMap>(next);
+            }
+            else if (event.key.keysym.sym == SDLK_F9) {
+                bool chaos = settings.engine == Config::RenderEngine::ChaosGame;
+                settings.engine = chaos ? Config::RenderEngine::Feedback : Config::RenderEngine::ChaosGame;
+            }
+            else if (event.key.keysym.sym == SDLK_F10 && !inputReplay) {
+                try {
+                    saveScene(Config::SCENE_PATH);
+                }
+                catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                }
+            }
+            else if (event.key.keysym.sym == SDLK_F11 && !inputReplay) {
+                try {
+                    loadScene(Config::SCENE_PATH);
+                }
+                catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                }
+            }
+            else if (event.key.keysym.sym == SDLK_F6 && !inputReplay) {
+                settings.frameReloads++;
+            }
             handleTempScaling(event);
             break;
         case SDL_KEYUP:
@@ -174,27 +302,30 @@ bool InputManager::handleEvents() {
         }
     }
 
-    const Uint8* keyState = SDL_GetKeyboardState(nullptr);
-    if (keyState[SDL_SCANCODE_ESCAPE]) {
+    if (input.isKeyDown(SDL_SCANCODE_ESCAPE)) {
         return false;
     }
-    if (keyState[SDL_SCANCODE_D]) {
+    if (input.isKeyDown(SDL_SCANCODE_LEFTBRACKET) != input.isKeyDown(SDL_SCANCODE_RIGHTBRACKET)) {
+        float direction = input.isKeyDown(SDL_SCANCODE_RIGHTBRACKET) ? 1.0f : -1.0f;
+        settings.exposure *= std::exp2(direction * Config::EXPOSURE_SPEED * input.deltaSeconds);
+    }
+    if (input.isKeyDown(SDL_SCANCODE_D)) {
         handleKeyPress("rotate_clockwise");
     }
-    else if (keyState[SDL_SCANCODE_A]) {
+    else if (input.isKeyDown(SDL_SCANCODE_A)) {
         handleKeyPress("rotate_counterclockwise");
     }
-    else if (keyState[SDL_SCANCODE_W]) {
+    else if (input.isKeyDown(SDL_SCANCODE_W)) {
         handleKeyPress("strengthen");
     }
-    else if (keyState[SDL_SCANCODE_S]) {
+    else if (input.isKeyDown(SDL_SCANCODE_S)) {
         handleKeyPress("weaken");
     }
     else if (Config::DEV_TOOLS) {
-        if (keyState[SDL_SCANCODE_UP]) {
+        if (input.isKeyDown(SDL_SCANCODE_UP)) {
             handleKeyPress("cycle_hue");
         }
-        else if (keyState[SDL_SCANCODE_DOWN]) {
+        else if (input.isKeyDown(SDL_SCANCODE_DOWN)) {
             handleKeyPress("cycle_saturation");
         }
     }
@@ -202,14 +333,13 @@ bool InputManager::handleEvents() {
 }
 
 void InputManager::handleTempScaling(const SDL_Event& event) {
-    if (event.key.keysym.sym == SDLK_SPACE && screenManager->getSelectedScreen()) {
+    if (event.key.keysym.sym == SDLK_SPACE && screenManager->hasSelection()) {
         scalingMode = true;
-        int x, y;
-        SDL_GetMouseState(&x, &y);
-        scaleStartPos = { static_cast<float>(x), static_cast<float>(y) };
+        scaleStartPos = { static_cast<float>(input.mouseX), static_cast<float>(input.mouseY) };
+        Screen selected = screenManager->getSelectedScreen();
         originalDimensions = {
-            static_cast<float>(screenManager->getSelectedScreen()->getWidth()),
-            static_cast<float>(screenManager->getSelectedScreen()->getHeight())
+            static_cast<float>(selected.getWidth()),
+            static_cast<float>(selected.getHeight())
         };
         tempWidth = static_cast<int>(originalDimensions.x);
         tempHeight = static_cast<int>(originalDimensions.y);
@@ -218,9 +348,7 @@ void InputManager::handleTempScaling(const SDL_Event& event) {
 
 void InputManager::handleScalingMotion(const SDL_Event& event) {
     if (scalingMode) {
-        int x, y;
-        SDL_GetMouseState(&x, &y);
-        SDL_FPoint currentPos = { static_cast<float>(x), static_cast<float>(y) };
+        SDL_FPoint currentPos = { static_cast<float>(input.mouseX), static_cast<float>(input.mouseY) };
         float deltaX = currentPos.x - scaleStartPos.x;
         float deltaY = currentPos.y - scaleStartPos.y;
         tempWidth = std::max(Config::MIN_SCREEN_SIZE, std::min(static_cast<int>(originalDimensions.x + deltaX), static_cast<int>(width * Config::MAX_SCREEN_RATIO)));
@@ -231,8 +359,11 @@ void InputManager::handleScalingMotion(const SDL_Event& event) {
 void InputManager::handleExitScaling(const SDL_Event& event) {
     if (event.key.keysym.sym == SDLK_SPACE && scalingMode) {
         scalingMode = false;
-        screenManager->getSelectedScreen()->setWidth(tempWidth);
-        screenManager->getSelectedScreen()->setHeight(tempHeight);
+        if (!screenManager->hasSelection()) return;
+        Screen selected = screenManager->getSelectedScreen();
+        selected.setWidth(tempWidth);
+        selected.setHeight(tempHeight);
+        screenManager->updateSelected(selected);
     }
 }
 
@@ -242,110 +373,310 @@ void InputManager::handleMouseClick(const SDL_MouseButtonEvent& event) {
     case SDL_BUTTON_LEFT:
         screenManager->handleSelection(pos);
         break;
-    case SDL_BUTTON_MIDDLE: {
-        Screen* newScreen = screenManager->createScreen(pos);
+    case SDL_BUTTON_MIDDLE:
+        screenManager->createScreen(pos);
         screenManager->handleSelection(pos);
         break;
-    }
     case SDL_BUTTON_RIGHT:
         screenManager->handleSelection(pos);
-        if (screenManager->getSelectedScreen()) {
-            Screen* selected = screenManager->getSelectedScreen();
-            auto& screens = const_cast<std::vector<Screen>&>(screenManager->getScreens());
-            auto it = std::find_if(screens.begin(), screens.end(),
-                [selected](const Screen& s) { return &s == selected; });
-            if (it != screens.end()) {
-                screens.erase(it);
-            }
-            screenManager = std::make_unique<ScreenManager>(*screenManager);
-        }
+        screenManager->deleteSelected();
         break;
     }
 }
 
 void InputManager::handleKeyPress(const std::string& event) {
-    Screen* selected = screenManager->getSelectedScreen();
-    if (!selected) return;
+    if (!screenManager->hasSelection()) return;
+    float dt = input.deltaSeconds;
     if (event == "rotate_clockwise") {
-        screenManager->handleRotation(-Config::ROTATION_SPEED);
+        screenManager->handleRotation(-Config::ROTATION_SPEED * dt);
     }
     else if (event == "rotate_counterclockwise") {
-        screenManager->handleRotation(Config::ROTATION_SPEED);
+        screenManager->handleRotation(Config::ROTATION_SPEED * dt);
     }
     else if (event == "cycle_hue") {
-        handleColorRotation();
+        handleColorRotation(Config::COLOR_ROTATION_SPEED * dt);
     }
     else if (event == "cycle_saturation") {
-        handleSaturation();
+        handleSaturation(Config::SATURATION_CYCLE_SPEED * dt);
     }
     else if (event == "strengthen") {
-        handleStrengthen();
+        handleAlphaChange(Config::ALPHA_CHANGE_SPEED * dt);
     }
     else if (event == "weaken") {
-        handleWeaken();
+        handleAlphaChange(-Config::ALPHA_CHANGE_SPEED * dt);
     }
 }
 
-void InputManager::handleColorRotation() {
-    Screen* selected = screenManager->getSelectedScreen();
-    if (!selected) return;
-    SDL_Color color = selected->getColor();
-    float h, s, v;
-    MathUtils::rgbToHsv(color.r, color.g, color.b, h, s, v);
-    h = fmod(h + Config::COLOR_ROTATION_SPEED, 1.0f);
-    Uint8 r, g, b;
-    MathUtils::hsvToRgb(h, s, v, r, g, b);
-    SDL_Color newColor = { r, g, b, color.a };
-    selected->setColor(newColor);
+// Hue and saturation edits move the screen's ColorAnimation phase; the compositing shader
+// applies it, so the stored color and the 8-bit channels are never round-tripped through HSV
+
+void InputManager::handleColorRotation(float amount) {
+    if (!screenManager->hasSelection()) return;
+    Screen selected = screenManager->getSelectedScreen();
+    ColorAnimation animation = selected.getColorAnimation();
+    animation.huePhase = fmod(animation.huePhase + amount, 1.0f);
+    selected.setColorAnimation(animation);
+    screenManager->updateSelected(selected);
 }
 
-void InputManager::handleSaturation() {
-    Screen* selected = screenManager->getSelectedScreen();
-    if (!selected) return;
-    SDL_Color color = selected->getColor();
-    float h, s, v;
-    MathUtils::rgbToHsv(color.r, color.g, color.b, h, s, v);
-    s = fmod(static_cast<float>(s) - Config::SATURATION_CYCLE_SPEED + 1.0f, 1.0f);
-    Uint8 r, g, b;
-    MathUtils::hsvToRgb(h, s, v, r, g, b);
-    SDL_Color newColor = { r, g, b, color.a };
-    selected->setColor(newColor);
+void InputManager::handleSaturation(float amount) {
+    if (!screenManager->hasSelection()) return;
+    Screen selected = screenManager->getSelectedScreen();
+    ColorAnimation animation = selected.getColorAnimation();
+    animation.saturationPhase = fmod(animation.saturationPhase - amount + 1.0f, 1.0f);
+    selected.setColorAnimation(animation);
+    screenManager->updateSelected(selected);
 }
 
-void InputManager::handleStrengthen() {
-    Screen* selected = screenManager->getSelectedScreen();
-    if (!selected) return;
-    SDL_Color color = selected->getColor();
-    Uint8 newAlpha = static_cast<int>(std::min(static_cast<float>(Config::MAX_SCREEN_ALPHA), std::ceil(color.a + Config::ALPHA_CHANGE_SPEED)));
-    SDL_Color newColor = { color.r, color.g, color.b, newAlpha };
-    selected->setColor(newColor);
+void InputManager::toggleColorAnimation(bool hue) {
+    if (!screenManager->hasSelection()) return;
+    Screen selected = screenManager->getSelectedScreen();
+    ColorAnimation animation = selected.getColorAnimation();
+    if (hue) {
+        animation.hueRate = animation.hueRate != 0.0f ? 0.0f : Config::HUE_CYCLE_RATE;
+    }
+    else {
+        bool pulsing = animation.saturationRate != 0.0f;
+        animation.saturationRate = pulsing ? 0.0f : Config::SATURATION_PULSE_RATE;
+        animation.saturationRange = pulsing ? 0.0f : Config::SATURATION_PULSE_RANGE;
+    }
+    selected.setColorAnimation(animation);
+    screenManager->updateSelected(selected);
 }
 
-void InputManager::handleWeaken() {
-    Screen* selected = screenManager->getSelectedScreen();
-    if (!selected) return;
-    SDL_Color color = selected->getColor();
-    Uint8 newAlpha = std::max(0.0f, static_cast<float>(color.a - Config::ALPHA_CHANGE_SPEED));
-    SDL_Color newColor = { color.r, color.g, color.b, newAlpha };
-    selected->setColor(newColor);
+void InputManager::handleAlphaChange(float amount) {
+    if (!screenManager->hasSelection()) return;
+    Screen selected = screenManager->getSelectedScreen();
+    SDL_Color color = selected.getColor();
+    pendingAlpha += amount;
+    int step = static_cast<int>(pendingAlpha);
+    if (step == 0) return;
+    pendingAlpha -= step;
+    int newAlpha = std::max(0, std::min(static_cast<int>(Config::MAX_SCREEN_ALPHA), color.a + step));
+    if (newAlpha == color.a) {
+        pendingAlpha = 0.0f;
+        return;
+    }
+    selected.setColor({ color.r, color.g, color.b, static_cast<Uint8>(newAlpha) });
+    screenManager->updateSelected(selected);
 }
 
 void InputManager::update() {
     if (!scalingMode) {
-        int x, y;
-        SDL_GetMouseState(&x, &y);
-        SDL_FPoint mousePos = { static_cast<float>(x), static_cast<float>(y) };
-        screenManager->handleDragging(mousePos);
-        currentFrame = fractalManager->processFrame(screenManager->getScreens(), frameCounter);
+        SDL_FPoint mousePos = { static_cast<float>(input.mouseX), static_cast<float>(input.mouseY) };
+        screenManager->handleDragging(mousePos, (input.mouseButtons & SDL_BUTTON_LMASK) != 0);
+        if (animationPlaying && !animator->empty()) {
+            animationTime += input.deltaSeconds;
+            screenManager->applyAnimation(*animator, animationTime);
+        }
+    }
+}
+
+void InputManager::publishScene(float eventsMs, float updateMs) {
+    SceneSnapshot& scene = snapshots->prepare(screenManager->getStore(), screenManager->getRevision());
+    scene.selection.reset();
+    if (screenManager->hasSelection()) {
+        scene.selection = screenManager->getSelectedScreen();
+    }
+    scene.scalingMode = scalingMode;
+    scene.tempWidth = tempWidth;
+    scene.tempHeight = tempHeight;
+    scene.settings = settings;
+    scene.eventsMs = eventsMs;
+    scene.updateMs = updateMs;
+    snapshots->publish();
+    screenManager->clearDirty();
+}
+
+void InputManager::renderLoop() {
+    SDL_GL_MakeCurrent(window, glContext);
+    try {
+        while (rendering) {
+            framePacer->beginFrame();
+            renderFrame();
+            framePacer->endFrame();
+            profiler->endFrame();
+        }
+    }
+    catch (...) {
+        renderError = std::current_exception();
+        rendering = false;
     }
+    SDL_GL_MakeCurrent(window, nullptr);
 }
 
-void InputManager::draw() {
+void InputManager::stopRenderThread() {
+    if (!renderThread.joinable()) {
+        return;
+    }
+    rendering = false;
+    renderThread.join();
+    SDL_GL_MakeCurrent(window, glContext);
+}
+
+void InputManager::renderFrame() {
+    bool fresh = snapshots->acquire();
+    const SceneSnapshot& scene = snapshots->latest();
+    if (fresh) {
+        profiler->addCpuSample(CpuSection::HandleEvents, scene.eventsMs);
+        profiler->addCpuSample(CpuSection::Update, scene.updateMs);
+        applySettings(scene.settings);
+        unrendered = unrendered.united(scene.changed);
+    }
+
+    profiler->beginCpu(CpuSection::Draw);
+    if (!scene.scalingMode) {
+        profiler->beginGpu(GpuSection::Composite);
+        currentFrame = fractalManager->processFrame(scene.instances.data(), scene.instances.size(), unrendered, scene.revision, frameCounter);
+        unrendered = { 0, 0 };
+        profiler->endGpu(GpuSection::Composite);
+        if (applied.capturing) {
+            fractalManager->saveFrame(currentFrame, capturedFrames++);
+        }
+    }
+    draw(scene);
+    profiler->endCpu(CpuSection::Draw);
+    frameCounter++;
+}
+
+void InputManager::applySettings(const RenderSettings& requested) {
+    fractalManager->setExposure(requested.exposure);
+    fractalManager->setToneMap(requested.toneMap);
+    fractalManager->setEngine(requested.engine);
+    for (unsigned int i = applied.pacingCycles; i != requested.pacingCycles; ++i) {
+        framePacer->cycleMode();
+    }
+    if (requested.recording != applied.recording) {
+        setRecording(requested.recording);
+    }
+    if (requested.frameReloads != applied.frameReloads && capturedFrames > 0) {
+        fractalManager->flushSavedFrames();
+        try {
+            currentFrame = fractalManager->loadPreviousFrame(capturedFrames - 1);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    applied = requested;
+}
+
+void InputManager::draw(const SceneSnapshot& scene) {
     glClearColor(Config::BACKGROUND_COLOR.r / 255.0f, Config::BACKGROUND_COLOR.g / 255.0f, Config::BACKGROUND_COLOR.b / 255.0f, Config::BACKGROUND_COLOR.a / 255.0f);
     glClear(GL_COLOR_BUFFER_BIT);
+    profiler->beginGpu(GpuSection::Present);
     fractalManager->renderCurrentFrame();
+    profiler->endGpu(GpuSection::Present);
     
-    OtherRenders::drawSelectionOutline(screenManager->getSelectedScreen(), scalingMode, tempWidth, tempHeight, colorShaderProgram, projection, vao);
+    profiler->beginGpu(GpuSection::Outline);
+    if (scene.selection) {
+        OtherRenders::drawSelectionOutline(&*scene.selection, scene.scalingMode, scene.tempWidth, scene.tempHeight, *colorShader, outlineUniforms, projection, vao);
+    }
+    profiler->endGpu(GpuSection::Outline);
+
+    if (applied.showHud) {
+        if (frameCounter % Config::HUD_REFRESH_FRAMES == 0) {
+            updateHud(scene);
+        }
+        hud->draw();
+    }
     
     SDL_GL_SwapWindow(window);
+}
+
+void InputManager::loadScene(const std::string& path) {
+    // Tracks point at the old scene's screens
+    animator->clear();
+    screenManager->setScreens(SceneIO::load(path));
+}
+
+void InputManager::saveScene(const std::string& path) const {
+    SceneIO::save(path, screenManager->getScreens());
+}
+
+void InputManager::loadAnimation(const std::string& path) {
+    animator->load(path, screenManager->getStore());
+    animationTime = 0.0;
+}
+
+void InputManager::reportReplay() const {
+    if (replayFrameMs.empty()) {
+        return;
+    }
+    std::vector<float> sorted = replayFrameMs;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](float p) {
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+    };
+    double total = 0.0;
+    for (float ms : sorted) {
+        total += ms;
+    }
+    std::printf("replay: %zu frames at %dx%d in %.3f s\n", sorted.size(), width, height, total / 1000.0);
+    std::printf("frame ms: mean %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+        total / sorted.size(), percentile(0.50f), percentile(0.95f), percentile(0.99f), sorted.back());
+}
+
+void InputManager::setRecording(bool on) {
+    if (!on) {
+        fractalManager->stopRecording();
+        return;
+    }
+    try {
+        fractalManager->startRecording(Config::RECORDING_PATH, Config::FPS, true);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void InputManager::updateHud(const SceneSnapshot& scene) {
+    auto row = [](const char* name, const Profiler::Stats& stats) {
+        char line[96];
+        std::snprintf(line, sizeof(line), "%-10s %6.2f %6.2f %6.2f %6.2f", name, stats.average, stats.p50, stats.p95, stats.p99);
+        return std::string(line);
+    };
+
+    Profiler::Stats frame = profiler->getStats(CpuSection::Frame);
+    char header[96];
+    std::snprintf(header, sizeof(header), "FPS %.1f  SCREENS %zu  %s %.1f MB  EXPOSURE %.2f",
+        frame.average > 0.0f ? 1000.0f / frame.average : 0.0f,
+        scene.instances.size(),
+        AccumulationFormats::name(fractalManager->getAccumulationFormat()),
+        fractalManager->getTextureMemoryBytes() / (1024.0 * 1024.0),
+        fractalManager->getExposure());
+    char iterations[96];
+    if (fractalManager->getEngine() == Config::RenderEngine::ChaosGame) {
+        std::snprintf(iterations, sizeof(iterations), "CHAOS GAME %.1fM POINTS  %s  PACING %s",
+            fractalManager->getChaosSampleCount() / 1e6, fractalManager->isIdle() ? "IDLE" : "ACTIVE", framePacer->getModeName());
+    }
+    else {
+        std::snprintf(iterations, sizeof(iterations), "ITERATIONS/FRAME %d  SCALE %d%%  %s  PACING %s",
+            fractalManager->getIterationsPerFrame(), static_cast<int>(std::lround(fractalManager->getResolutionScale() * 100)),
+            fractalManager->isIdle() ? "IDLE" : "ACTIVE", framePacer->getModeName());
+    }
+
+    char capture[96];
+    std::snprintf(capture, sizeof(capture), "CAPTURE %s  %d FRAMES  %zu DROPPED",
+        applied.capturing ? "ON" : "OFF", capturedFrames, fractalManager->getDroppedFrames());
+    char recording[96] = "RECORDING OFF";
+    if (const VideoRecorder* recorder = fractalManager->getRecorder()) {
+        std::snprintf(recording, sizeof(recording), "RECORDING %dX%d  %zu FRAMES  %zu DROPPED",
+            recorder->getVideoWidth(), recorder->getVideoHeight(), recorder->getWrittenFrames(), recorder->getDroppedFrames());
+    }
+
+    hud->setLines({
+        header,
+        iterations,
+        capture,
+        recording,
+        "MS            AVG    P50    P95    P99",
+        row("FRAME", frame),
+        row("GPU COMP", profiler->getStats(GpuSection::Composite)),
+        row("GPU PRES", profiler->getStats(GpuSection::Present)),
+        row("GPU OUTL", profiler->getStats(GpuSection::Outline)),
+        row("CPU EVENT", profiler->getStats(CpuSection::HandleEvents)),
+        row("CPU UPDATE", profiler->getStats(CpuSection::Update)),
+        row("CPU RENDER", profiler->getStats(CpuSection::Draw))
+    });
 }
\ No newline at end of file
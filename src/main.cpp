@@ -1,16 +1,44 @@
 #include "input_manager.h"
+#include <cstring>
 
 #ifdef _WIN32
 #undef main
 #endif
 
+// fractus [scene] [--animation FILE] [--record-input FILE] | fractus --replay FILE [--animation FILE]
 int main(int argc, char* argv[]) {
     try {
-        InputManager visualizer;
+        std::string scenePath, animationPath, recordPath, replayPath;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) {
+                recordPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--animation") == 0 && i + 1 < argc) {
+                animationPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+                replayPath = argv[++i];
+            }
+            else {
+                scenePath = argv[i];
+            }
+        }
+
+        InputManager visualizer(replayPath);
+        if (replayPath.empty() && !scenePath.empty()) {
+            visualizer.loadScene(scenePath);
+        }
+        if (!animationPath.empty()) {
+            visualizer.loadAnimation(animationPath);
+        }
+        if (!recordPath.empty()) {
+            visualizer.recordInput(recordPath);
+        }
         visualizer.run();
         return 0;
     }
     catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
         return 1;
     }
-}
\ No newline at end of file
+}
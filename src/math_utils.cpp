@@ -1,9 +1,241 @@
 #include "math_utils.h"
 #include "config.h"
+#include "vec4.h"
 #include <cmath>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <stdexcept>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Points per block in the interpolants' batch evaluate(): four doubles is one AVX register or
+// two SSE2 ones, and the fixed-size inner loops are what the vectorizer turns into them
+constexpr size_t INTERPOLANT_LANES = 4;
+
+// The batch color kernels are written once against a lane type: Width colors at a time, each
+// in its own lane, with masks and selects instead of branches. Wider lane types run the bulk
+// of a span and ScalarLanes finishes the tail, so every width performs the same float ops.
+namespace {
+    struct ScalarLanes {
+        using F = float;
+        using I = uint32_t;
+        using Mask = bool;
+        static constexpr size_t WIDTH = 1;
+
+        static F load(const float* p) { return *p; }
+        static void store(float* p, F a) { *p = a; }
+        static F set(float a) { return a; }
+        static F add(F a, F b) { return a + b; }
+        static F sub(F a, F b) { return a - b; }
+        static F mul(F a, F b) { return a * b; }
+        static F div(F a, F b) { return a / b; }
+        static F min(F a, F b) { return a < b ? a : b; }
+        static F max(F a, F b) { return a > b ? a : b; }
+        static F floor(F a) { return std::floor(a); }
+        static Mask equal(F a, F b) { return a == b; }
+        static Mask greater(F a, F b) { return a > b; }
+        static Mask greaterEqual(F a, F b) { return a >= b; }
+        static F select(Mask m, F a, F b) { return m ? a : b; }
+
+        static I loadPacked(const SDL_Color* p) { I packed; std::memcpy(&packed, p, 4); return packed; }
+        static void storePacked(SDL_Color* p, I packed) { std::memcpy(p, &packed, 4); }
+        static F byteToFloat(I packed, int shift) { return static_cast<float>((packed >> shift) & 0xff); }
+        static I truncate(F a) { return static_cast<I>(a); }
+        static I shiftLeft(I a, int shift) { return a << shift; }
+        static I bitOr(I a, I b) { return a | b; }
+        static I bitAnd(I a, uint32_t b) { return a & b; }
+    };
+
+#ifdef FRACTUS_SSE2
+    struct SseLanes {
+        using F = __m128;
+        using I = __m128i;
+        using Mask = __m128;
+        static constexpr size_t WIDTH = 4;
+
+        static F load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, F a) { _mm_storeu_ps(p, a); }
+        static F set(float a) { return _mm_set1_ps(a); }
+        static F add(F a, F b) { return _mm_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        static F div(F a, F b) { return _mm_div_ps(a, b); }
+        static F min(F a, F b) { return _mm_min_ps(a, b); }
+        static F max(F a, F b) { return _mm_max_ps(a, b); }
+        // SSE2 has no round instruction, so floor goes through an int32 truncation. Floats of
+        // magnitude 2^23 or more are already whole and NaN fails the compare; both pass through
+        // unchanged, as from std::floor, instead of becoming INT_MIN.
+        static F floor(F a) {
+            F truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+            F floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a), _mm_set1_ps(1.0f)));
+            F magnitude = _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+            return select(_mm_cmplt_ps(magnitude, _mm_set1_ps(8388608.0f)), floored, a);
+        }
+        static Mask equal(F a, F b) { return _mm_cmpeq_ps(a, b); }
+        static Mask greater(F a, F b) { return _mm_cmpgt_ps(a, b); }
+        static Mask greaterEqual(F a, F b) { return _mm_cmpge_ps(a, b); }
+        static F select(Mask m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+        static I loadPacked(const SDL_Color* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+        static void storePacked(SDL_Color* p, I packed) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), packed); }
+        static F byteToFloat(I packed, int shift) {
+            return _mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(packed, _mm_cvtsi32_si128(shift)), _mm_set1_epi32(0xff)));
+        }
+        static I truncate(F a) { return _mm_cvttps_epi32(a); }
+        static I shiftLeft(I a, int shift) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(shift)); }
+        static I bitOr(I a, I b) { return _mm_or_si128(a, b); }
+        static I bitAnd(I a, uint32_t b) { return _mm_and_si128(a, _mm_set1_epi32(static_cast<int>(b))); }
+    };
+#endif
+
+#ifdef __AVX2__
+    struct AvxLanes {
+        using F = __m256;
+        using I = __m256i;
+        using Mask = __m256;
+        static constexpr size_t WIDTH = 8;
+
+        static F load(const float* p) { return _mm256_loadu_ps(p); }
+        static void store(float* p, F a) { _mm256_storeu_ps(p, a); }
+        static F set(float a) { return _mm256_set1_ps(a); }
+        static F add(F a, F b) { return _mm256_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        static F div(F a, F b) { return _mm256_div_ps(a, b); }
+        static F min(F a, F b) { return _mm256_min_ps(a, b); }
+        static F max(F a, F b) { return _mm256_max_ps(a, b); }
+        static F floor(F a) { return _mm256_floor_ps(a); }
+        static Mask equal(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static Mask greater(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static Mask greaterEqual(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        static F select(Mask m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+
+        static I loadPacked(const SDL_Color* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void storePacked(SDL_Color* p, I packed) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), packed); }
+        static F byteToFloat(I packed, int shift) {
+            return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(packed, _mm_cvtsi32_si128(shift)), _mm256_set1_epi32(0xff)));
+        }
+        static I truncate(F a) { return _mm256_cvttps_epi32(a); }
+        static I shiftLeft(I a, int shift) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(shift)); }
+        static I bitOr(I a, I b) { return _mm256_or_si256(a, b); }
+        static I bitAnd(I a, uint32_t b) { return _mm256_and_si256(a, _mm256_set1_epi32(static_cast<int>(b))); }
+    };
+    using WideLanes = AvxLanes;
+#elif defined(FRACTUS_SSE2)
+    using WideLanes = SseLanes;
+#else
+    using WideLanes = ScalarLanes;
+#endif
+
+    // One channel of the sector-free HSV formula: v - v s clamp(min(k, 4 - k), 0, 1) with
+    // k = (n + 6h) mod 6, where n is 5, 3 and 1 for red, green and blue
+    template <typename L>
+    typename L::F hsvChannel(float n, typename L::F sixHue, typename L::F v, typename L::F vs) {
+        typename L::F k = L::add(L::set(n), sixHue);
+        k = L::sub(k, L::select(L::greaterEqual(k, L::set(6.0f)), L::set(6.0f), L::set(0.0f)));
+        typename L::F x = L::min(L::min(k, L::sub(L::set(4.0f), k)), L::set(1.0f));
+        return L::sub(v, L::mul(vs, L::max(x, L::set(0.0f))));
+    }
+
+    template <typename L>
+    void hsvToRgbLanes(const float* h, const float* s, const float* v, size_t i, typename L::F& r, typename L::F& g, typename L::F& b) {
+        typename L::F hue = L::load(h + i);
+        typename L::F sixHue = L::mul(L::sub(hue, L::floor(hue)), L::set(6.0f));
+        typename L::F value = L::load(v + i);
+        typename L::F vs = L::mul(value, L::load(s + i));
+        r = hsvChannel<L>(5.0f, sixHue, value, vs);
+        g = hsvChannel<L>(3.0f, sixHue, value, vs);
+        b = hsvChannel<L>(1.0f, sixHue, value, vs);
+    }
+
+    // Same operations, in the same order, as the scalar MathUtils::rgbToHsv
+    template <typename L>
+    void rgbToHsvLanes(typename L::F r, typename L::F g, typename L::F b, typename L::F& h, typename L::F& s, typename L::F& v) {
+        typename L::F zero = L::set(0.0f);
+        typename L::F one = L::set(1.0f);
+        typename L::F max = L::max(L::max(r, g), b);
+        typename L::F min = L::min(L::min(r, g), b);
+        typename L::F delta = L::sub(max, min);
+        v = max;
+        typename L::Mask lit = L::greater(max, zero);
+        s = L::select(lit, L::div(delta, L::select(lit, max, one)), zero);
+
+        typename L::Mask chromatic = L::greater(delta, zero);
+        typename L::F divisor = L::select(chromatic, delta, one);
+        typename L::F fromRed = L::div(L::sub(g, b), divisor);
+        typename L::F fromGreen = L::add(L::div(L::sub(b, r), divisor), L::set(2.0f));
+        typename L::F fromBlue = L::add(L::div(L::sub(r, g), divisor), L::set(4.0f));
+        typename L::F hue = L::select(L::equal(max, r), fromRed, L::select(L::equal(max, g), fromGreen, fromBlue));
+        hue = L::select(chromatic, L::div(hue, L::set(6.0f)), zero);
+        h = L::add(hue, L::select(L::greater(zero, hue), one, zero));
+    }
+
+    template <typename L>
+    size_t hsvToRgbFloat(const float* h, const float* s, const float* v, float* r, float* g, float* b, size_t begin, size_t count) {
+        size_t i = begin;
+        for (; i + L::WIDTH <= count; i += L::WIDTH) {
+            typename L::F red, green, blue;
+            hsvToRgbLanes<L>(h, s, v, i, red, green, blue);
+            L::store(r + i, red);
+            L::store(g + i, green);
+            L::store(b + i, blue);
+        }
+        return i;
+    }
+
+    template <typename L>
+    typename L::I unorm8(typename L::F c) {
+        typename L::F clamped = L::min(L::max(c, L::set(0.0f)), L::set(1.0f));
+        return L::truncate(L::mul(clamped, L::set(255.0f)));
+    }
+
+    template <typename L>
+    size_t hsvToRgbPacked(const float* h, const float* s, const float* v, SDL_Color* colors, size_t begin, size_t count) {
+        size_t i = begin;
+        for (; i + L::WIDTH <= count; i += L::WIDTH) {
+            typename L::F red, green, blue;
+            hsvToRgbLanes<L>(h, s, v, i, red, green, blue);
+            typename L::I packed = L::bitAnd(L::loadPacked(colors + i), 0xff000000u);
+            packed = L::bitOr(packed, unorm8<L>(red));
+            packed = L::bitOr(packed, L::shiftLeft(unorm8<L>(green), 8));
+            packed = L::bitOr(packed, L::shiftLeft(unorm8<L>(blue), 16));
+            L::storePacked(colors + i, packed);
+        }
+        return i;
+    }
+
+    template <typename L>
+    size_t rgbToHsvFloat(const float* r, const float* g, const float* b, float* h, float* s, float* v, size_t begin, size_t count) {
+        size_t i = begin;
+        for (; i + L::WIDTH <= count; i += L::WIDTH) {
+            typename L::F hue, saturation, value;
+            rgbToHsvLanes<L>(L::load(r + i), L::load(g + i), L::load(b + i), hue, saturation, value);
+            L::store(h + i, hue);
+            L::store(s + i, saturation);
+            L::store(v + i, value);
+        }
+        return i;
+    }
+
+    template <typename L>
+    size_t rgbToHsvPacked(const SDL_Color* colors, float* h, float* s, float* v, size_t begin, size_t count) {
+        size_t i = begin;
+        for (; i + L::WIDTH <= count; i += L::WIDTH) {
+            typename L::I packed = L::loadPacked(colors + i);
+            typename L::F scale = L::set(255.0f);
+            typename L::F hue, saturation, value;
+            rgbToHsvLanes<L>(L::div(L::byteToFloat(packed, 0), scale), L::div(L::byteToFloat(packed, 8), scale),
+                L::div(L::byteToFloat(packed, 16), scale), hue, saturation, value);
+            L::store(h + i, hue);
+            L::store(s + i, saturation);
+            L::store(v + i, value);
+        }
+        return i;
+    }
+}
 
 namespace MathUtils {
     void hsvToRgb(float h, float s, float v, Uint8& r, Uint8& g, Uint8& b) {
@@ -54,6 +286,26 @@ namespace MathUtils {
         if (h < 0.0f) h += 1.0f;
     }
 
+    void hsvToRgb(const float* h, const float* s, const float* v, float* r, float* g, float* b, size_t count) {
+        size_t done = hsvToRgbFloat<WideLanes>(h, s, v, r, g, b, 0, count);
+        hsvToRgbFloat<ScalarLanes>(h, s, v, r, g, b, done, count);
+    }
+
+    void hsvToRgb(const float* h, const float* s, const float* v, SDL_Color* colors, size_t count) {
+        size_t done = hsvToRgbPacked<WideLanes>(h, s, v, colors, 0, count);
+        hsvToRgbPacked<ScalarLanes>(h, s, v, colors, done, count);
+    }
+
+    void rgbToHsv(const float* r, const float* g, const float* b, float* h, float* s, float* v, size_t count) {
+        size_t done = rgbToHsvFloat<WideLanes>(r, g, b, h, s, v, 0, count);
+        rgbToHsvFloat<ScalarLanes>(r, g, b, h, s, v, done, count);
+    }
+
+    void rgbToHsv(const SDL_Color* colors, float* h, float* s, float* v, size_t count) {
+        size_t done = rgbToHsvPacked<WideLanes>(colors, h, s, v, 0, count);
+        rgbToHsvPacked<ScalarLanes>(colors, h, s, v, done, count);
+    }
+
     double linearInterpolate(double y0, double y1, double t) {
         return y0 + t * (y1 - y0);
     }
@@ -157,18 +409,7 @@ namespace MathUtils {
     }
 
     double newtonInterpolate(const std::vector<double>& x, const std::vector<double>& y, double xi) {
-        auto table = dividedDifferences(x, y);
-        size_t n = x.size();
-
-        double result = table[0][0];
-        double product = 1.0;
-
-        for (size_t i = 1; i < n; ++i) {
-            product *= (xi - x[i - 1]);
-            result += table[0][i] * product;
-        }
-
-        return result;
+        return NewtonPolynomial(x, y).evaluate(xi);
     }
 
     double barycentricInterpolate(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& w, double xi) {
@@ -192,96 +433,219 @@ namespace MathUtils {
         return numerator / denominator;
     }
 
-    class CubicSpline {
-    private:
-        std::vector<double> x, y, a, b, c, d;
+    double bilinearInterpolate(double q00, double q01, double q10, double q11, double x, double y) {
+        double r1 = linearInterpolate(q00, q10, x);
+        double r2 = linearInterpolate(q01, q11, x);
+        return linearInterpolate(r1, r2, y);
+    }
+
+    std::vector<double> chebyshevNodes(int n, double a = -1.0, double b = 1.0) {
+        std::vector<double> nodes(n);
+        for (int i = 0; i < n; ++i) {
+            double t = cos(Config::PI * (2 * i + 1) / (2 * n));
+            nodes[i] = 0.5 * (a + b) + 0.5 * (b - a) * t;
+        }
+        return nodes;
+    }
+
+    std::vector<double> chebyshevWeights(const std::vector<double>& nodes) {
+        size_t n = nodes.size();
+        std::vector<double> weights(n);
+
+        // Closed form for the first-kind nodes chebyshevNodes returns: (-1)^i sin((2i + 1) pi / 2n)
+        for (size_t i = 0; i < n; ++i) {
+            double w = sin(Config::PI * (2 * i + 1) / (2 * n));
+            weights[i] = i % 2 == 0 ? w : -w;
+        }
+
+        return weights;
+    }
 
-    public:
-        CubicSpline(const std::vector<double>& x_vals, const std::vector<double>& y_vals) 
-            : x(x_vals), y(y_vals) {
-            if (x.size() != y.size() || x.size() < 3) {
-                throw std::invalid_argument("Need at least 3 points for cubic spline");
+    NewtonPolynomial::NewtonPolynomial(const std::vector<double>& x, const std::vector<double>& y)
+        : nodes(x), coefficients(y) {
+        if (x.size() != y.size() || x.empty()) {
+            throw std::invalid_argument("x and y vectors must have same, non-zero size");
+        }
+        // Divided differences in place: after pass j, coefficients[j] is f[x_0 .. x_j]
+        size_t n = nodes.size();
+        for (size_t j = 1; j < n; ++j) {
+            for (size_t i = n - 1; i >= j; --i) {
+                coefficients[i] = (coefficients[i] - coefficients[i - 1]) / (nodes[i] - nodes[i - j]);
             }
-            computeCoefficients();
         }
+    }
 
-        void computeCoefficients() {
-            size_t n = x.size() - 1;
-            a = y;
-            b.resize(n);
-            c.resize(n + 1);
-            d.resize(n);
+    double NewtonPolynomial::evaluate(double xi) const {
+        size_t n = coefficients.size();
+        double result = coefficients[n - 1];
+        for (size_t i = n - 1; i-- > 0;) {
+            result = result * (xi - nodes[i]) + coefficients[i];
+        }
+        return result;
+    }
 
-            std::vector<double> h(n);
-            for (size_t i = 0; i < n; ++i) {
-                h[i] = x[i + 1] - x[i];
+    void NewtonPolynomial::evaluate(const double* xs, double* ys, size_t count) const {
+        size_t n = coefficients.size();
+        size_t p = 0;
+        for (; p + INTERPOLANT_LANES <= count; p += INTERPOLANT_LANES) {
+            double result[INTERPOLANT_LANES];
+            for (size_t l = 0; l < INTERPOLANT_LANES; ++l) {
+                result[l] = coefficients[n - 1];
             }
+            for (size_t i = n - 1; i-- > 0;) {
+                for (size_t l = 0; l < INTERPOLANT_LANES; ++l) {
+                    result[l] = result[l] * (xs[p + l] - nodes[i]) + coefficients[i];
+                }
+            }
+            for (size_t l = 0; l < INTERPOLANT_LANES; ++l) {
+                ys[p + l] = result[l];
+            }
+        }
+        for (; p < count; ++p) {
+            ys[p] = evaluate(xs[p]);
+        }
+    }
 
-            std::vector<double> alpha(n);
-            for (size_t i = 1; i < n; ++i) {
-                alpha[i] = 3.0 * (a[i + 1] - a[i]) / h[i] - 3.0 * (a[i] - a[i - 1]) / h[i - 1];
+    BarycentricInterpolant::BarycentricInterpolant(const std::vector<double>& x, const std::vector<double>& y)
+        : nodes(x), values(y), weights(x.size(), 1.0) {
+        if (x.size() != y.size() || x.empty()) {
+            throw std::invalid_argument("x and y vectors must have same, non-zero size");
+        }
+        // Differences are scaled by 4 / (interval length) so the products of many nodes stay
+        // in range; a common factor in the weights cancels out of the barycentric quotient
+        auto [lo, hi] = std::minmax_element(x.begin(), x.end());
+        double scale = *hi > *lo ? 4.0 / (*hi - *lo) : 1.0;
+        for (size_t i = 0; i < x.size(); ++i) {
+            for (size_t j = 0; j < x.size(); ++j) {
+                if (i != j) {
+                    weights[i] *= (x[i] - x[j]) * scale;
+                }
             }
+            weights[i] = 1.0 / weights[i];
+        }
+    }
 
-            std::vector<double> l(n + 1), mu(n + 1), z(n + 1);
-            l[0] = 1.0;
-            mu[0] = 0.0;
-            z[0] = 0.0;
+    BarycentricInterpolant::BarycentricInterpolant(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& w)
+        : nodes(x), values(y), weights(w) {
+        if (x.size() != y.size() || x.size() != w.size() || x.empty()) {
+            throw std::invalid_argument("All vectors must have same, non-zero size");
+        }
+    }
+
+    double BarycentricInterpolant::evaluate(double xi) const {
+        return barycentricInterpolate(nodes, values, weights, xi);
+    }
 
-            for (size_t i = 1; i < n; ++i) {
-                l[i] = 2.0 * (x[i + 1] - x[i - 1]) - h[i - 1] * mu[i - 1];
-                mu[i] = h[i] / l[i];
-                z[i] = (alpha[i] - h[i - 1] * z[i - 1]) / l[i];
+    void BarycentricInterpolant::evaluate(const double* xs, double* ys, size_t count) const {
+        size_t n = nodes.size();
+        size_t p = 0;
+        for (; p + INTERPOLANT_LANES <= count; p += INTERPOLANT_LANES) {
+            double numerator[INTERPOLANT_LANES] = {}, denominator[INTERPOLANT_LANES] = {};
+            double nearest[INTERPOLANT_LANES];
+            for (size_t l = 0; l < INTERPOLANT_LANES; ++l) {
+                nearest[l] = 1.0;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t l = 0; l < INTERPOLANT_LANES; ++l) {
+                    double diff = xs[p + l] - nodes[i];
+                    nearest[l] = std::min(nearest[l], std::abs(diff));
+                    double temp = weights[i] / diff;
+                    numerator[l] += temp * values[i];
+                    denominator[l] += temp;
+                }
             }
+            bool onNode = false;
+            for (size_t l = 0; l < INTERPOLANT_LANES; ++l) {
+                ys[p + l] = numerator[l] / denominator[l];
+                onNode |= nearest[l] < 1e-12;
+            }
+            // A point on a node divides by (nearly) zero; redo the block with the scalar check
+            if (onNode) {
+                for (size_t l = 0; l < INTERPOLANT_LANES; ++l) {
+                    ys[p + l] = evaluate(xs[p + l]);
+                }
+            }
+        }
+        for (; p < count; ++p) {
+            ys[p] = evaluate(xs[p]);
+        }
+    }
 
-            l[n] = 1.0;
-            z[n] = 0.0;
-            c[n] = 0.0;
+    CubicSpline::CubicSpline(const std::vector<double>& x, const std::vector<double>& y) : knots(x) {
+        if (x.size() != y.size() || x.size() < 3) {
+            throw std::invalid_argument("Need at least 3 points for cubic spline");
+        }
+        size_t n = x.size() - 1;
 
-            for (int j = n - 1; j >= 0; --j) {
-                c[j] = z[j] - mu[j] * c[j + 1];
-                b[j] = (a[j + 1] - a[j]) / h[j] - h[j] * (c[j + 1] + 2.0 * c[j]) / 3.0;
-                d[j] = (c[j + 1] - c[j]) / (3.0 * h[j]);
-            }
+        std::vector<double> h(n);
+        for (size_t i = 0; i < n; ++i) {
+            h[i] = x[i + 1] - x[i];
         }
 
-        double interpolate(double xi) const {
-            auto it = std::lower_bound(x.begin(), x.end(), xi);
-            if (it == x.begin()) it++;
-            if (it == x.end()) it--;
+        std::vector<double> alpha(n);
+        for (size_t i = 1; i < n; ++i) {
+            alpha[i] = 3.0 * (y[i + 1] - y[i]) / h[i] - 3.0 * (y[i] - y[i - 1]) / h[i - 1];
+        }
 
-            size_t j = it - x.begin() - 1;
-            double dx = xi - x[j];
+        std::vector<double> l(n + 1), mu(n + 1), z(n + 1), c(n + 1);
+        l[0] = 1.0;
+        mu[0] = 0.0;
+        z[0] = 0.0;
 
-            return a[j] + b[j] * dx + c[j] * dx * dx + d[j] * dx * dx * dx;
+        for (size_t i = 1; i < n; ++i) {
+            l[i] = 2.0 * (x[i + 1] - x[i - 1]) - h[i - 1] * mu[i - 1];
+            mu[i] = h[i] / l[i];
+            z[i] = (alpha[i] - h[i - 1] * z[i - 1]) / l[i];
         }
-    };
 
-    double bilinearInterpolate(double q00, double q01, double q10, double q11, double x, double y) {
-        double r1 = linearInterpolate(q00, q10, x);
-        double r2 = linearInterpolate(q01, q11, x);
-        return linearInterpolate(r1, r2, y);
+        l[n] = 1.0;
+        z[n] = 0.0;
+        c[n] = 0.0;
+
+        coefficients.resize(4 * n);
+        for (size_t j = n; j-- > 0;) {
+            c[j] = z[j] - mu[j] * c[j + 1];
+            double* segment = &coefficients[4 * j];
+            segment[0] = y[j];
+            segment[1] = (y[j + 1] - y[j]) / h[j] - h[j] * (c[j + 1] + 2.0 * c[j]) / 3.0;
+            segment[2] = c[j];
+            segment[3] = (c[j + 1] - c[j]) / (3.0 * h[j]);
+        }
     }
 
-    std::vector<double> chebyshevNodes(int n, double a = -1.0, double b = 1.0) {
-        std::vector<double> nodes(n);
-        for (int i = 0; i < n; ++i) {
-            double t = cos(Config::PI * (2 * i + 1) / (2 * n));
-            nodes[i] = 0.5 * (a + b) + 0.5 * (b - a) * t;
-        }
-        return nodes;
+    size_t CubicSpline::findSegment(double xi) const {
+        auto it = std::lower_bound(knots.begin(), knots.end(), xi);
+        if (it == knots.begin()) it++;
+        if (it == knots.end()) it--;
+        return it - knots.begin() - 1;
     }
 
-    std::vector<double> chebyshevWeights(const std::vector<double>& nodes) {
-        size_t n = nodes.size();
-        std::vector<double> weights(n);
+    double CubicSpline::evaluateSegment(size_t segment, double xi) const {
+        const double* k = &coefficients[4 * segment];
+        double dx = xi - knots[segment];
+        return k[0] + dx * (k[1] + dx * (k[2] + dx * k[3]));
+    }
 
-        for (size_t i = 0; i < n; ++i) {
-            weights[i] = pow(-1, i);
-            if (i == 0 || i == n - 1) {
-                weights[i] *= 0.5;
+    double CubicSpline::evaluate(double xi) const {
+        return evaluateSegment(findSegment(xi), xi);
+    }
+
+    void CubicSpline::evaluate(const double* xs, double* ys, size_t count) const {
+        size_t last = knots.size() - 2;
+        size_t segment = 0;
+        for (size_t p = 0; p < count; ++p) {
+            double xi = xs[p];
+            // Ascending points stay in or walk a little past the previous segment; a step back
+            // falls back to the binary search. Segment j covers (x_j, x_j+1], as in findSegment.
+            if (segment > 0 && xi <= knots[segment]) {
+                segment = findSegment(xi);
             }
+            else {
+                while (segment < last && xi > knots[segment + 1]) {
+                    ++segment;
+                }
+            }
+            ys[p] = evaluateSegment(segment, xi);
         }
-
-        return weights;
     }
 }
\ No newline at end of file
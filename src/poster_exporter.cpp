@@ -0,0 +1,325 @@
+#include "poster_exporter.h"
+#include "screen_instance.h"
+#include "image_io.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    void transformBox(float xx, float xy, float xOffset, float yx, float yy, float yOffset,
+        float minX, float minY, float maxX, float maxY, float box[4]) {
+        box[0] = box[1] = 1e30f;
+        box[2] = box[3] = -1e30f;
+        for (int corner = 0; corner < 4; ++corner) {
+            float x = (corner & 1) ? maxX : minX;
+            float y = (corner & 2) ? maxY : minY;
+            float tx = xx * x + xy * y + xOffset;
+            float ty = yx * x + yy * y + yOffset;
+            box[0] = std::min(box[0], tx);
+            box[1] = std::min(box[1], ty);
+            box[2] = std::max(box[2], tx);
+            box[3] = std::max(box[3], ty);
+        }
+    }
+}
+
+PosterExporter::PosterExporter(const std::vector<ScreenInstance>& screens, int sceneWidth, int sceneHeight, ThreadPool& pool)
+    : sceneWidth(sceneWidth), sceneHeight(sceneHeight), pool(pool),
+      minX(0.0f), minY(0.0f), maxX(static_cast<float>(sceneWidth)), maxY(static_cast<float>(sceneHeight)) {
+    // A poster is a still, so animated colors are taken at time 0
+    IfsMaps::build(screens, sceneWidth, sceneHeight, 0.0f, maps, cumulativeWeights);
+    if (!maps.empty()) {
+        findBounds();
+    }
+
+    int streamCount = std::max(1, std::min(pool.getThreadCount(), Config::CHAOS_MAX_STREAMS));
+    streams.resize(streamCount);
+    for (int i = 0; i < streamCount; ++i) {
+        Stream& stream = streams[i];
+        stream.random = ChaosRandom(0x9e3779b97f4a7c15ULL, i);
+        stream.x = minX + stream.random.unit() * (maxX - minX);
+        stream.y = minY + stream.random.unit() * (maxY - minY);
+        stream.r = stream.g = stream.b = 0.0f;
+    }
+}
+
+void PosterExporter::findBounds() {
+    // Extent of a sampled orbit, then grown until every map keeps the box inside itself,
+    // which guarantees it holds the whole attractor
+    ChaosRandom random(0x2545f4914f6cdd1dULL);
+    const float limit = 4.0f * std::max(sceneWidth, sceneHeight);
+    float x = 0.5f * sceneWidth;
+    float y = 0.5f * sceneHeight;
+    minX = minY = 1e30f;
+    maxX = maxY = -1e30f;
+    for (int i = 0; i < Config::CHAOS_WARMUP_ITERATIONS + Config::POSTER_BOUNDS_SAMPLES; ++i) {
+        const IfsMap& map = maps[IfsMaps::pick(cumulativeWeights, random.unit())];
+        float nextX = map.xx * x + map.xy * y + map.xOffset;
+        float nextY = map.yx * x + map.yy * y + map.yOffset;
+        x = std::max(-limit, std::min(nextX, limit));
+        y = std::max(-limit, std::min(nextY, limit));
+        if (i >= Config::CHAOS_WARMUP_ITERATIONS) {
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+        }
+    }
+
+    for (int round = 0; round < 64; ++round) {
+        bool grew = false;
+        for (const IfsMap& map : maps) {
+            float box[4];
+            transformBox(map.xx, map.xy, map.xOffset, map.yx, map.yy, map.yOffset, minX, minY, maxX, maxY, box);
+            float margin = 1e-4f * (maxX - minX + maxY - minY);
+            if (box[0] < minX - margin || box[1] < minY - margin || box[2] > maxX + margin || box[3] > maxY + margin) {
+                grew = true;
+            }
+            minX = std::max(-limit, std::min(minX, box[0]));
+            minY = std::max(-limit, std::min(minY, box[1]));
+            maxX = std::min(limit, std::max(maxX, box[2]));
+            maxY = std::min(limit, std::max(maxY, box[3]));
+        }
+        if (!grew) {
+            break;
+        }
+    }
+}
+
+void PosterExporter::buildWords(Band& band, float scale) const {
+    band.words.clear();
+    band.cumulativeProbabilities.clear();
+    band.probability = 0.0;
+    if (maps.empty()) {
+        return;
+    }
+
+    const float top = band.firstRow / scale;
+    const float bottom = (band.firstRow + band.rows) / scale;
+    const float targetHeight = (bottom - top) * Config::POSTER_WORD_EXTENT;
+    auto touchesBand = [&](const Word& word, float box[4]) {
+        transformBox(word.xx, word.xy, word.xOffset, word.yx, word.yy, word.yOffset, minX, minY, maxX, maxY, box);
+        return box[2] >= 0.0f && box[0] < sceneWidth && box[3] >= top && box[1] < bottom;
+    };
+
+    const double totalWeight = cumulativeWeights.back();
+    std::vector<Word> words = { Word{ 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f } };
+    std::vector<double> probabilities = { 1.0 };
+    std::vector<Word> nextWords;
+    std::vector<double> nextProbabilities;
+    bool expanded = true;
+    for (int depth = 0; expanded && depth < 64; ++depth) {
+        expanded = false;
+        nextWords.clear();
+        nextProbabilities.clear();
+        for (size_t i = 0; i < words.size(); ++i) {
+            const Word& word = words[i];
+            float box[4];
+            if (!touchesBand(word, box)) {
+                continue;
+            }
+            size_t remaining = words.size() - i - 1;
+            if (box[3] - box[1] <= targetHeight || nextWords.size() + remaining + maps.size() > static_cast<size_t>(Config::POSTER_MAX_WORDS)) {
+                nextWords.push_back(word);
+                nextProbabilities.push_back(probabilities[i]);
+                continue;
+            }
+
+            // word o map: the map is applied first, then the word
+            expanded = true;
+            for (size_t j = 0; j < maps.size(); ++j) {
+                const IfsMap& map = maps[j];
+                Word child;
+                child.xx = word.xx * map.xx + word.xy * map.yx;
+                child.xy = word.xx * map.xy + word.xy * map.yy;
+                child.xOffset = word.xx * map.xOffset + word.xy * map.yOffset + word.xOffset;
+                child.yx = word.yx * map.xx + word.yy * map.yx;
+                child.yy = word.yx * map.xy + word.yy * map.yy;
+                child.yOffset = word.yx * map.xOffset + word.yy * map.yOffset + word.yOffset;
+                child.keep = word.keep * (1.0f - map.alpha);
+                child.r = word.keep * map.alpha * map.r + word.r;
+                child.g = word.keep * map.alpha * map.g + word.g;
+                child.b = word.keep * map.alpha * map.b + word.b;
+                float childBox[4];
+                if (touchesBand(child, childBox)) {
+                    double weight = cumulativeWeights[j] - (j > 0 ? cumulativeWeights[j - 1] : 0.0f);
+                    nextWords.push_back(child);
+                    nextProbabilities.push_back(probabilities[i] * weight / totalWeight);
+                }
+            }
+        }
+        words.swap(nextWords);
+        probabilities.swap(nextProbabilities);
+    }
+
+    band.words = std::move(words);
+    band.cumulativeProbabilities.reserve(probabilities.size());
+    for (double probability : probabilities) {
+        band.probability += probability;
+        band.cumulativeProbabilities.push_back(band.probability);
+    }
+}
+
+void PosterExporter::sample(Band& band, float scale, int width, uint64_t samples) {
+    const size_t binCount = static_cast<size_t>(band.rows) * width;
+    const float limit = 4.0f * std::max(sceneWidth, sceneHeight);
+    const uint64_t share = samples / streams.size();
+
+    pool.parallelFor(streams.size(), [&](size_t index, int) {
+        Stream& stream = streams[index];
+        Bin* bins = stream.bins.data();
+        std::fill(bins, bins + binCount, Bin{ 0.0f, 0.0f, 0.0f, 0 });
+        if (band.words.empty()) {
+            return;
+        }
+
+        for (uint64_t i = 0; i < share; ++i) {
+            const IfsMap& map = maps[IfsMaps::pick(cumulativeWeights, stream.random.unit())];
+            float x = map.xx * stream.x + map.xy * stream.y + map.xOffset;
+            float y = map.yx * stream.x + map.yy * stream.y + map.yOffset;
+            if (!(std::fabs(x) < limit && std::fabs(y) < limit)) {
+                x = minX + stream.random.unit() * (maxX - minX);
+                y = minY + stream.random.unit() * (maxY - minY);
+            }
+            stream.x = x;
+            stream.y = y;
+            stream.r += (map.r - stream.r) * map.alpha;
+            stream.g += (map.g - stream.g) * map.alpha;
+            stream.b += (map.b - stream.b) * map.alpha;
+
+            double target = stream.random.next() * (1.0 / 4294967296.0) * band.probability;
+            size_t pick = std::upper_bound(band.cumulativeProbabilities.begin(), band.cumulativeProbabilities.end(), target)
+                - band.cumulativeProbabilities.begin();
+            const Word& word = band.words[std::min(pick, band.words.size() - 1)];
+            float px = (word.xx * x + word.xy * y + word.xOffset) * scale;
+            float py = (word.yx * x + word.yy * y + word.yOffset) * scale - band.firstRow;
+            if (px < 0.0f || py < 0.0f || px >= width || py >= band.rows) {
+                continue;
+            }
+            Bin& bin = bins[static_cast<size_t>(py) * width + static_cast<size_t>(px)];
+            bin.r += stream.r * word.keep + word.r;
+            bin.g += stream.g * word.keep + word.g;
+            bin.b += stream.b * word.keep + word.b;
+            ++bin.count;
+        }
+    });
+}
+
+float PosterExporter::peakDensity(const Band& band, int width, uint64_t samples) {
+    pool.parallelFor(static_cast<size_t>(band.rows), [&](size_t row, int) {
+        uint32_t rowMax = 0;
+        for (size_t p = row * width; p < (row + 1) * width; ++p) {
+            uint32_t count = 0;
+            for (const Stream& stream : streams) {
+                count += stream.bins[p].count;
+            }
+            rowMax = std::max(rowMax, count);
+        }
+        rowPeaks[row] = static_cast<float>(rowMax);
+    });
+    float peak = *std::max_element(rowPeaks.begin(), rowPeaks.begin() + band.rows);
+    return static_cast<float>(peak * band.probability / samples);
+}
+
+void PosterExporter::resolve(const Band& band, int width, uint64_t samples, float densityScale, float logPeak, std::vector<Uint8>& rgba) {
+    // Counts become attractor mass per pixel, then the count a whole-image chaos game with
+    // the same sample density would have collected, so bands tone-map identically
+    const float countScale = static_cast<float>(band.probability / samples) * densityScale;
+    const float inverseGamma = 1.0f / Config::CHAOS_GAMMA;
+    pool.parallelFor(static_cast<size_t>(band.rows), [&](size_t row, int) {
+        for (size_t p = row * width; p < (row + 1) * width; ++p) {
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            uint32_t count = 0;
+            for (const Stream& stream : streams) {
+                const Bin& bin = stream.bins[p];
+                r += bin.r;
+                g += bin.g;
+                b += bin.b;
+                count += bin.count;
+            }
+            Uint8* out = &rgba[p * 4];
+            if (count == 0 || logPeak <= 0.0f) {
+                out[0] = out[1] = out[2] = out[3] = 0;
+                continue;
+            }
+            float brightness = std::pow(std::min(std::log1p(count * countScale) / logPeak, 1.0f), inverseGamma);
+            float scale = brightness / count;
+            out[0] = static_cast<Uint8>(std::min(r * scale, 1.0f) * 255.0f + 0.5f);
+            out[1] = static_cast<Uint8>(std::min(g * scale, 1.0f) * 255.0f + 0.5f);
+            out[2] = static_cast<Uint8>(std::min(b * scale, 1.0f) * 255.0f + 0.5f);
+            out[3] = static_cast<Uint8>(brightness * 255.0f + 0.5f);
+        }
+    });
+}
+
+void PosterExporter::exportPng(const std::string& path, int width, float samplesPerPixel, const Progress& progress) {
+    if (width <= 0 || samplesPerPixel <= 0.0f) {
+        throw std::runtime_error("Poster width and sample density must be positive");
+    }
+    const int height = std::max(1, static_cast<int>(std::lround(static_cast<double>(sceneHeight) * width / sceneWidth)));
+    const float scale = static_cast<float>(width) / sceneWidth;
+
+    // Band height from the memory budget for every stream's histogram
+    size_t budget = static_cast<size_t>(Config::POSTER_MEMORY_MB) << 20;
+    size_t bytesPerRow = streams.size() * static_cast<size_t>(width) * sizeof(Bin);
+    int bandRows = static_cast<int>(std::max<size_t>(1, std::min<size_t>(height, budget / bytesPerRow)));
+    int bandCount = (height + bandRows - 1) / bandRows;
+    for (Stream& stream : streams) {
+        stream.bins.resize(static_cast<size_t>(bandRows) * width);
+    }
+    rowPeaks.resize(bandRows);
+
+    // Samples per band, and the whole-image sample count the tone map is calibrated to
+    auto bandSamples = [&](int rows, float density) {
+        uint64_t samples = static_cast<uint64_t>(static_cast<double>(density) * rows * width);
+        return std::max<uint64_t>(samples / streams.size(), 1) * streams.size();
+    };
+    const float densityScale = samplesPerPixel * static_cast<float>(width) * height;
+
+    for (Stream& stream : streams) {
+        if (!maps.empty()) {
+            for (int i = 0; i < Config::CHAOS_WARMUP_ITERATIONS; ++i) {
+                const IfsMap& map = maps[IfsMaps::pick(cumulativeWeights, stream.random.unit())];
+                float x = map.xx * stream.x + map.xy * stream.y + map.xOffset;
+                stream.y = map.yx * stream.x + map.yy * stream.y + map.yOffset;
+                stream.x = x;
+                stream.r += (map.r - stream.r) * map.alpha;
+                stream.g += (map.g - stream.g) * map.alpha;
+                stream.b += (map.b - stream.b) * map.alpha;
+            }
+        }
+    }
+
+    // First pass at reduced density only finds the peak the log tone map is normalized to
+    const float peakSamplesPerPixel = samplesPerPixel * Config::POSTER_PEAK_SAMPLE_RATIO;
+    float peak = 0.0f;
+    Band band;
+    for (int i = 0; i < bandCount; ++i) {
+        band.firstRow = i * bandRows;
+        band.rows = std::min(bandRows, height - band.firstRow);
+        buildWords(band, scale);
+        uint64_t samples = bandSamples(band.rows, peakSamplesPerPixel);
+        sample(band, scale, width, samples);
+        peak = std::max(peak, peakDensity(band, width, samples));
+        if (progress) {
+            progress(Config::POSTER_PEAK_PASS_SHARE * (i + 1) / bandCount);
+        }
+    }
+    const float logPeak = std::log1p(peak * densityScale);
+
+    PngWriter writer(path, width, height, &pool);
+    std::vector<Uint8> rgba(static_cast<size_t>(bandRows) * width * 4);
+    for (int i = 0; i < bandCount; ++i) {
+        band.firstRow = i * bandRows;
+        band.rows = std::min(bandRows, height - band.firstRow);
+        buildWords(band, scale);
+        uint64_t samples = bandSamples(band.rows, samplesPerPixel);
+        sample(band, scale, width, samples);
+        resolve(band, width, samples, densityScale, logPeak, rgba);
+        writer.writeRows(rgba.data(), band.rows);
+        if (progress) {
+            progress(Config::POSTER_PEAK_PASS_SHARE + (1.0f - Config::POSTER_PEAK_PASS_SHARE) * (i + 1) / bandCount);
+        }
+    }
+    writer.finish();
+}
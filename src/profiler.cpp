@@ -0,0 +1,104 @@
+#include "profiler.h"
+#include <algorithm>
+
+void Profiler::SampleWindow::push(float value) {
+    samples[next] = value;
+    next = (next + 1) % samples.size();
+    count = std::min(count + 1, samples.size());
+}
+
+Profiler::Stats Profiler::SampleWindow::compute() const {
+    Stats stats = { 0.0f, 0.0f, 0.0f, 0.0f };
+    if (count == 0) {
+        return stats;
+    }
+
+    std::array<float, WINDOW_SIZE> sorted;
+    std::copy(samples.begin(), samples.begin() + count, sorted.begin());
+    std::sort(sorted.begin(), sorted.begin() + count);
+
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        sum += sorted[i];
+    }
+    auto percentile = [&](float p) { return sorted[std::min(count - 1, static_cast<size_t>(p * count))]; };
+
+    stats.average = sum / count;
+    stats.p50 = percentile(0.50f);
+    stats.p95 = percentile(0.95f);
+    stats.p99 = percentile(0.99f);
+    return stats;
+}
+
+Profiler::Profiler() : parity(0), lastFrameEnd(0) {
+    for (size_t i = 0; i < GPU_COUNT; ++i) {
+        glGenQueries(2, queries[i]);
+        issued[i][0] = issued[i][1] = false;
+    }
+    for (auto& start : cpuStart) {
+        start = 0;
+    }
+    ticksToMs = 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+Profiler::~Profiler() {
+    for (size_t i = 0; i < GPU_COUNT; ++i) {
+        glDeleteQueries(2, queries[i]);
+    }
+}
+
+void Profiler::beginGpu(GpuSection section) {
+    glBeginQuery(GL_TIME_ELAPSED, queries[static_cast<size_t>(section)][parity]);
+}
+
+void Profiler::endGpu(GpuSection section) {
+    glEndQuery(GL_TIME_ELAPSED);
+    issued[static_cast<size_t>(section)][parity] = true;
+}
+
+void Profiler::beginCpu(CpuSection section) {
+    cpuStart[static_cast<size_t>(section)] = SDL_GetPerformanceCounter();
+}
+
+void Profiler::endCpu(CpuSection section) {
+    size_t index = static_cast<size_t>(section);
+    cpuWindows[index].push(static_cast<float>((SDL_GetPerformanceCounter() - cpuStart[index]) * ticksToMs));
+}
+
+void Profiler::addCpuSample(CpuSection section, float ms) {
+    cpuWindows[static_cast<size_t>(section)].push(ms);
+}
+
+void Profiler::endFrame() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (lastFrameEnd) {
+        cpuWindows[static_cast<size_t>(CpuSection::Frame)].push(static_cast<float>((now - lastFrameEnd) * ticksToMs));
+    }
+    lastFrameEnd = now;
+
+    // Switch to the other query set and harvest whatever it measured last frame
+    parity ^= 1;
+    for (size_t i = 0; i < GPU_COUNT; ++i) {
+        if (!issued[i][parity]) {
+            continue;
+        }
+        issued[i][parity] = false;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(queries[i][parity], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[i][parity], GL_QUERY_RESULT, &elapsed);
+        gpuWindows[i].push(static_cast<float>(elapsed / 1.0e6));
+    }
+}
+
+Profiler::Stats Profiler::getStats(GpuSection section) const {
+    return gpuWindows[static_cast<size_t>(section)].compute();
+}
+
+Profiler::Stats Profiler::getStats(CpuSection section) const {
+    return cpuWindows[static_cast<size_t>(section)].compute();
+}
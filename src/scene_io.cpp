@@ -0,0 +1,268 @@
+#include "scene_io.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char BINARY_MAGIC[8] = { 'F', 'R', 'A', 'C', 'T', 'U', 'S', 0 };
+    constexpr uint32_t BINARY_VERSION = 1;
+
+    uint32_t recordChecksum(const ScreenInstance* records, size_t count) {
+        // zlib takes at most 4 GB per call
+        uLong crc = crc32(0L, Z_NULL, 0);
+        const Bytef* bytes = reinterpret_cast<const Bytef*>(records);
+        size_t remaining = count * sizeof(ScreenInstance);
+        while (remaining > 0) {
+            uInt chunk = static_cast<uInt>(std::min<size_t>(remaining, 1u << 30));
+            crc = crc32(crc, bytes, chunk);
+            bytes += chunk;
+            remaining -= chunk;
+        }
+        return static_cast<uint32_t>(crc);
+    }
+}
+
+namespace SceneIO {
+    std::vector<Screen> loadText(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Could not open scene " + path);
+        }
+
+        std::vector<Screen> screens;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#') {
+                continue;
+            }
+
+            std::istringstream fields(line);
+            auto fail = [&](const std::string& message) {
+                return std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + message);
+            };
+            float x, y, rotation;
+            int width, height, r, g, b, a;
+            if (!(fields >> x >> y >> width >> height >> rotation >> r >> g >> b >> a)) {
+                throw fail("expected \"x y width height rotation r g b a\"");
+            }
+            if (width <= 0 || height <= 0) {
+                throw fail("width and height must be positive");
+            }
+            for (int channel : { r, g, b, a }) {
+                if (channel < 0 || channel > 255) {
+                    throw fail("color channels must be within 0-255");
+                }
+            }
+            SDL_Color color = {
+                static_cast<Uint8>(r), static_cast<Uint8>(g), static_cast<Uint8>(b), static_cast<Uint8>(a)
+            };
+            screens.emplace_back(x, y, width, height, rotation, color);
+
+            // Optional trailing color animation
+            ColorAnimation animation;
+            if (fields >> animation.hueRate) {
+                if (!(fields >> animation.huePhase >> animation.hueRange >> animation.saturationRate
+                        >> animation.saturationPhase >> animation.saturationRange)) {
+                    throw fail("expected \"hueRate huePhase hueRange saturationRate saturationPhase saturationRange\" after the color");
+                }
+                for (float rate : { animation.hueRate, animation.saturationRate }) {
+                    if (!(std::fabs(rate) <= ColorAnimation::MAX_RATE)) {
+                        throw fail("animation rates must be within +-2047/1024 cycles per second");
+                    }
+                }
+                for (float range : { animation.hueRange, animation.saturationRange }) {
+                    if (!(range >= 0.0f && range <= ColorAnimation::MAX_RANGE)) {
+                        throw fail("animation ranges must be within 0-0.5");
+                    }
+                }
+                screens.back().setColorAnimation(animation);
+            }
+        }
+        return screens;
+    }
+
+    void saveText(const std::string& path, const std::vector<Screen>& screens) {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Could not open " + path + " for writing");
+        }
+
+        file.precision(9);
+        file << "# x y width height rotation r g b a [hueRate huePhase hueRange saturationRate saturationPhase saturationRange]\n";
+        for (const auto& screen : screens) {
+            SDL_Color color = screen.getColor();
+            file << screen.getX() << ' ' << screen.getY() << ' '
+                 << screen.getWidth() << ' ' << screen.getHeight() << ' '
+                 << screen.getRotation() << ' '
+                 << static_cast<int>(color.r) << ' ' << static_cast<int>(color.g) << ' '
+                 << static_cast<int>(color.b) << ' ' << static_cast<int>(color.a);
+            ColorAnimation animation = screen.getColorAnimation();
+            if (!animation.isNone()) {
+                file << ' ' << animation.hueRate << ' ' << animation.huePhase << ' ' << animation.hueRange
+                     << ' ' << animation.saturationRate << ' ' << animation.saturationPhase << ' ' << animation.saturationRange;
+            }
+            file << '\n';
+        }
+    }
+
+    bool isBinary(const std::string& path) {
+        return path.size() >= 4 && path.compare(path.size() - 4, 4, ".fsb") == 0;
+    }
+
+    std::vector<Screen> fromRecords(const ScreenInstance* records, size_t count) {
+        std::vector<Screen> screens;
+        screens.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const ScreenInstance& record = records[i];
+            screens.emplace_back(record.x, record.y, static_cast<int>(record.width), static_cast<int>(record.height),
+                record.rotation, record.color);
+            screens.back().setColorAnimation(record.getColorAnimation());
+        }
+        return screens;
+    }
+
+    std::vector<Screen> loadBinary(const std::string& path) {
+        MappedScene scene(path);
+        return fromRecords(scene.data(), scene.size());
+    }
+
+    void saveBinary(const std::string& path, const std::vector<Screen>& screens) {
+        std::vector<ScreenInstance> records;
+        records.reserve(screens.size());
+        for (const auto& screen : screens) {
+            records.push_back(ScreenInstance::from(screen));
+        }
+
+        BinaryHeader header = {};
+        std::memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+        header.version = BINARY_VERSION;
+        header.recordSize = sizeof(ScreenInstance);
+        header.recordCount = records.size();
+        header.checksum = recordChecksum(records.data(), records.size());
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Could not open " + path + " for writing");
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(ScreenInstance)));
+        if (!file) {
+            throw std::runtime_error("Failed to write " + path);
+        }
+    }
+
+    std::vector<Screen> load(const std::string& path) {
+        return isBinary(path) ? loadBinary(path) : loadText(path);
+    }
+
+    void save(const std::string& path, const std::vector<Screen>& screens) {
+        if (isBinary(path)) {
+            saveBinary(path, screens);
+        }
+        else {
+            saveText(path, screens);
+        }
+    }
+}
+
+MappedScene::MappedScene(const std::string& path)
+    : mapping(nullptr), mappedBytes(0), records(nullptr), count(0) {
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    mappingHandle = nullptr;
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open scene " + path);
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    mappedBytes = static_cast<size_t>(fileSize.QuadPart);
+    if (mappedBytes > 0) {
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        mapping = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    }
+#else
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("Could not open scene " + path);
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        mappedBytes = static_cast<size_t>(status.st_size);
+        mapping = mmap(nullptr, mappedBytes, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+        }
+    }
+    close(descriptor);
+#endif
+    if (!mapping) {
+        unmap();
+        throw std::runtime_error("Could not map scene " + path);
+    }
+
+    try {
+        const SceneIO::BinaryHeader* header = static_cast<const SceneIO::BinaryHeader*>(mapping);
+        if (mappedBytes < sizeof(SceneIO::BinaryHeader) || std::memcmp(header->magic, BINARY_MAGIC, sizeof(header->magic)) != 0) {
+            throw std::runtime_error(path + " is not a binary scene");
+        }
+        if (header->version != BINARY_VERSION || header->recordSize != sizeof(ScreenInstance)) {
+            throw std::runtime_error(path + ": unsupported scene version " + std::to_string(header->version));
+        }
+        if (header->recordCount > (mappedBytes - sizeof(SceneIO::BinaryHeader)) / sizeof(ScreenInstance)) {
+            throw std::runtime_error(path + " is truncated");
+        }
+        records = reinterpret_cast<const ScreenInstance*>(static_cast<const char*>(mapping) + sizeof(SceneIO::BinaryHeader));
+        count = static_cast<size_t>(header->recordCount);
+        if (recordChecksum(records, count) != header->checksum) {
+            throw std::runtime_error(path + ": checksum mismatch");
+        }
+    }
+    catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+MappedScene::~MappedScene() {
+    unmap();
+}
+
+void MappedScene::unmap() {
+#ifdef _WIN32
+    if (mapping) {
+        UnmapViewOfFile(mapping);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+    }
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (mapping) {
+        munmap(mapping, mappedBytes);
+    }
+#endif
+    mapping = nullptr;
+    records = nullptr;
+    count = 0;
+}
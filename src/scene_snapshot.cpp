@@ -0,0 +1,33 @@
+#include "scene_snapshot.h"
+#include <algorithm>
+
+namespace {
+    constexpr ScreenStore::Range EVERYTHING = { 0, ScreenStore::NO_INDEX };
+
+    ScreenStore::Range clamp(ScreenStore::Range range, size_t size) {
+        uint32_t count = static_cast<uint32_t>(size);
+        return { std::min(range.begin, count), std::min(range.end, count) };
+    }
+}
+
+SceneSnapshots::SceneSnapshots() : stale{ EVERYTHING, EVERYTHING, EVERYTHING }, untaken(EVERYTHING) {}
+
+SceneSnapshot& SceneSnapshots::prepare(const ScreenStore& store, unsigned int revision) {
+    ScreenStore::Range written = store.getDirtyRange();
+    for (ScreenStore::Range& range : stale) {
+        range = range.united(written);
+    }
+
+    int index = slots.getBackIndex();
+    SceneSnapshot& snapshot = slots.back();
+    snapshot.instances.resize(store.size());
+    store.writeInstances(snapshot.instances.data(), clamp(stale[index], store.size()));
+    stale[index] = { 0, 0 };
+
+    // If the previous snapshot is still waiting, this one replaces it and has to carry its
+    // changes too. When the reader takes it in the meantime they are merely copied twice.
+    untaken = slots.isPending() ? untaken.united(written) : written;
+    snapshot.changed = clamp(untaken, store.size());
+    snapshot.revision = revision;
+    return snapshot;
+}
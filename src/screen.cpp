@@ -1,12 +1,78 @@
 #include "screen.h"
+#include "screen_instance.h"
+#include "math_utils.h"
 #include <cmath>
 #include <algorithm>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+namespace {
+    constexpr float RATE_STEPS = 1024.0f;
+    constexpr float PHASE_STEPS = 4096.0f;
+    constexpr float RANGE_STEPS = 510.0f;
+
+    uint32_t packWord(float rate, float phase, float range) {
+        int32_t rateBits = static_cast<int32_t>(std::lround(std::max(-2047.0f, std::min(2047.0f, rate * RATE_STEPS))));
+        float wrapped = phase - std::floor(phase);
+        uint32_t phaseBits = static_cast<uint32_t>(std::lround(wrapped * PHASE_STEPS)) & 0xFFFu;
+        uint32_t rangeBits = static_cast<uint32_t>(std::lround(std::max(0.0f, std::min(255.0f, range * RANGE_STEPS))));
+        return (static_cast<uint32_t>(rateBits) & 0xFFFu) | (phaseBits << 12) | (rangeBits << 24);
+    }
+
+    void unpackWord(uint32_t word, float& rate, float& phase, float& range) {
+        // Shifting the 12-bit rate to the top and back sign-extends it
+        rate = static_cast<float>(static_cast<int32_t>(word << 20) >> 20) / RATE_STEPS;
+        phase = static_cast<float>((word >> 12) & 0xFFFu) / PHASE_STEPS;
+        range = static_cast<float>(word >> 24) / RANGE_STEPS;
+    }
+
+    // Keeps one rate, phase and range within what packWord can hold
+    void limit(float& rate, float& phase, float& range) {
+        rate = std::max(-ColorAnimation::MAX_RATE, std::min(ColorAnimation::MAX_RATE, rate));
+        phase -= std::floor(phase);
+        range = std::max(0.0f, std::min(ColorAnimation::MAX_RANGE, range));
+    }
+
+    float animate(float value, float rate, float phase, float range, float t, bool clampSwing) {
+        float cycle = rate * t + phase;
+        if (range > 0.0f) {
+            value += range * std::sin(2.0f * static_cast<float>(Config::PI) * cycle);
+            return clampSwing ? std::max(0.0f, std::min(1.0f, value)) : value - std::floor(value);
+        }
+        value += cycle;
+        return value - std::floor(value);
+    }
+}
+
+bool ColorAnimation::isNone() const {
+    return hueRate == 0.0f && huePhase == 0.0f && hueRange == 0.0f &&
+        saturationRate == 0.0f && saturationPhase == 0.0f && saturationRange == 0.0f;
+}
+
+SDL_Color ColorAnimation::apply(SDL_Color base, float t) const {
+    float h, s, v;
+    MathUtils::rgbToHsv(base.r, base.g, base.b, h, s, v);
+    if (hueRate != 0.0f || huePhase != 0.0f || hueRange != 0.0f) {
+        h = animate(h, hueRate, huePhase, hueRange, t, false);
+    }
+    if (saturationRate != 0.0f || saturationPhase != 0.0f || saturationRange != 0.0f) {
+        s = animate(s, saturationRate, saturationPhase, saturationRange, t, true);
+    }
+    SDL_Color color = base;
+    MathUtils::hsvToRgb(h, s, v, color.r, color.g, color.b);
+    return color;
+}
+
 Screen::Screen(float x, float y, int width, int height, float rotation, SDL_Color color)
     : xCoord(x), yCoord(y), origWidth(width), origHeight(height), rotation(rotation), color(color) {
+    updateRotationCache();
+}
+
+void Screen::updateRotationCache() {
+    float angleRad = rotation * Config::PI / 180.0f;
+    cosRotation = std::cos(angleRad);
+    sinRotation = std::sin(angleRad);
 }
 
 void Screen::setX(float x) {
@@ -27,12 +93,19 @@ void Screen::setHeight(int height) {
 
 void Screen::setRotation(float rot) {
     rotation = rot;
+    updateRotationCache();
 }
 
 void Screen::setColor(SDL_Color col) {
     color = col;
 }
 
+void Screen::setColorAnimation(const ColorAnimation& animation) {
+    colorAnimation = animation;
+    limit(colorAnimation.hueRate, colorAnimation.huePhase, colorAnimation.hueRange);
+    limit(colorAnimation.saturationRate, colorAnimation.saturationPhase, colorAnimation.saturationRange);
+}
+
 float Screen::getX() const {
     return xCoord;
 }
@@ -68,18 +141,51 @@ SDL_Color Screen::getScaleOutlineColor() const {
 
 void Screen::rotate(float degrees) {
     rotation = fmod(rotation + degrees, 360.0f);
+    updateRotationCache();
 }
 
 SDL_FPoint Screen::getRotatedSize() const {
     float w = static_cast<float>(origWidth);
     float h = static_cast<float>(origHeight);
-    float angleRad = rotation * Config::PI / 180.0f;
 
-    float cos_a = std::abs(std::cos(angleRad));
-    float sin_a = std::abs(std::sin(angleRad));
+    float cos_a = std::abs(cosRotation);
+    float sin_a = std::abs(sinRotation);
     
     float newW = w * cos_a + h * sin_a;
     float newH = w * sin_a + h * cos_a;
     
     return { newW, newH };
 }
+
+bool Screen::contains(float px, float py) const {
+    // Rotate the offset by -rotation into the screen's own frame
+    float dx = px - xCoord;
+    float dy = py - yCoord;
+    float localX = dx * cosRotation + dy * sinRotation;
+    float localY = dy * cosRotation - dx * sinRotation;
+    return std::abs(localX) <= origWidth * 0.5f && std::abs(localY) <= origHeight * 0.5f;
+}
+
+ScreenInstance ScreenInstance::from(const Screen& screen) {
+    ScreenInstance instance = {};
+    instance.x = screen.getX();
+    instance.y = screen.getY();
+    instance.width = static_cast<float>(screen.getWidth());
+    instance.height = static_cast<float>(screen.getHeight());
+    instance.rotation = screen.getRotation();
+    instance.color = screen.getColor();
+    instance.setColorAnimation(screen.getColorAnimation());
+    return instance;
+}
+
+ColorAnimation ScreenInstance::getColorAnimation() const {
+    ColorAnimation animation;
+    unpackWord(colorAnimation[0], animation.hueRate, animation.huePhase, animation.hueRange);
+    unpackWord(colorAnimation[1], animation.saturationRate, animation.saturationPhase, animation.saturationRange);
+    return animation;
+}
+
+void ScreenInstance::setColorAnimation(const ColorAnimation& animation) {
+    colorAnimation[0] = packWord(animation.hueRate, animation.huePhase, animation.hueRange);
+    colorAnimation[1] = packWord(animation.saturationRate, animation.saturationPhase, animation.saturationRange);
+}
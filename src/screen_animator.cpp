@@ -0,0 +1,329 @@
+#include "screen_animator.h"
+#include "config.h"
+#include "math_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    const char* const FIELD_NAMES[] = { "x", "y", "width", "height", "rotation", "red", "green", "blue", "alpha" };
+    const char* const EASING_NAMES[] = { "step", "linear", "cosine", "smoothstep", "smootherstep", "catmullrom", "hermite" };
+
+    template <typename T, size_t N>
+    bool parseName(const std::string& name, const char* const (&names)[N], T& out) {
+        for (size_t i = 0; i < N; ++i) {
+            if (name == names[i]) {
+                out = static_cast<T>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t trackKey(ScreenHandle screen, ScreenField field) {
+        return (static_cast<uint64_t>(screen.slot) << 8) | static_cast<uint64_t>(field);
+    }
+
+    // The eased curve of segment k at s in [0, 1]
+    double ease(const std::vector<Keyframe>& keys, size_t k, double s) {
+        const Keyframe& from = keys[k];
+        const Keyframe& to = keys[k + 1];
+        double y0 = from.value, y1 = to.value;
+        switch (from.easing) {
+        case Easing::Step:
+            return y0;
+        case Easing::Linear:
+            return MathUtils::linearInterpolate(y0, y1, s);
+        case Easing::Cosine:
+            return MathUtils::cosineInterpolate(y0, y1, s);
+        case Easing::Smoothstep:
+            return MathUtils::smoothstepInterpolate(y0, y1, s);
+        case Easing::Smootherstep:
+            return MathUtils::smootherstepInterpolate(y0, y1, s);
+        case Easing::CatmullRom: {
+            double before = k > 0 ? keys[k - 1].value : y0;
+            double after = k + 2 < keys.size() ? keys[k + 2].value : y1;
+            return MathUtils::catmullRomInterpolate(before, y0, y1, after, s);
+        }
+        case Easing::Hermite: {
+            // Tangents are per second; the Hermite basis wants them per segment
+            double span = to.time - from.time;
+            return MathUtils::hermiteInterpolate(y0, y1, from.tangent * span, to.tangent * span, s);
+        }
+        }
+        return y0;
+    }
+}
+
+ScreenAnimator::ScreenAnimator() : duration(0.0) {
+    std::vector<double> chebyshev = MathUtils::chebyshevNodes(DEGREE + 1, 0.0, 1.0);
+    for (int i = 0; i <= DEGREE; ++i) {
+        nodes[i] = static_cast<float>(chebyshev[i]);
+    }
+}
+
+ScreenAnimator::~ScreenAnimator() = default;
+
+void ScreenAnimator::setTrack(ScreenHandle screen, ScreenField field, std::vector<Keyframe> keys, bool loop) {
+    if (keys.empty()) {
+        throw std::invalid_argument("An animation track needs at least one keyframe");
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const Keyframe& a, const Keyframe& b) { return a.time < b.time; });
+    for (size_t k = 1; k < keys.size(); ++k) {
+        if (keys[k].time == keys[k - 1].time) {
+            throw std::invalid_argument("Two keyframes of one track share a time");
+        }
+    }
+
+    // A replaced track gives up its keys, and the tracks after it shift down
+    auto existing = trackOf.find(trackKey(screen, field));
+    bool replacing = existing != trackOf.end();
+    uint32_t trackIndex = static_cast<uint32_t>(tracks.size());
+    if (replacing) {
+        trackIndex = existing->second;
+        Track& old = tracks[trackIndex];
+        keyTimes.erase(keyTimes.begin() + old.firstKey, keyTimes.begin() + old.firstKey + old.keyCount);
+        inverseSpans.erase(inverseSpans.begin() + old.firstKey, inverseSpans.begin() + old.firstKey + old.keyCount);
+        segments.erase(segments.begin() + old.firstKey, segments.begin() + old.firstKey + old.keyCount);
+        for (Track& track : tracks) {
+            if (track.firstKey > old.firstKey) {
+                track.firstKey -= old.keyCount;
+            }
+        }
+    }
+    else {
+        tracks.push_back({});
+        trackOf[trackKey(screen, field)] = trackIndex;
+    }
+
+    Track& track = tracks[trackIndex];
+    track.screen = screen;
+    track.field = field;
+    track.loop = loop;
+    track.firstKey = static_cast<uint32_t>(keyTimes.size());
+    track.keyCount = static_cast<uint32_t>(keys.size());
+    track.cursor = 0;
+    track.held = 0;
+
+    std::vector<double> samplePoints(nodes, nodes + DEGREE + 1);
+    std::vector<double> samples(DEGREE + 1);
+    for (size_t k = 0; k < keys.size(); ++k) {
+        keyTimes.push_back(keys[k].time);
+        Segment segment = {};
+        if (k + 1 < keys.size()) {
+            inverseSpans.push_back(static_cast<float>(1.0 / (keys[k + 1].time - keys[k].time)));
+            for (int i = 0; i <= DEGREE; ++i) {
+                samples[i] = ease(keys, k, samplePoints[i]);
+            }
+            MathUtils::NewtonPolynomial curve(samplePoints, samples);
+            for (int i = 0; i <= DEGREE; ++i) {
+                segment.coefficients[i] = static_cast<float>(curve.getCoefficients()[i]);
+            }
+        }
+        else {
+            inverseSpans.push_back(0.0f);
+            segment.coefficients[0] = keys[k].value;
+        }
+        segments.push_back(segment);
+    }
+
+    if (!replacing) {
+        duration = std::max(duration, keys.back().time);
+        return;
+    }
+    duration = 0.0;
+    for (const Track& t : tracks) {
+        duration = std::max(duration, keyTimes[t.firstKey + t.keyCount - 1]);
+    }
+}
+
+void ScreenAnimator::clear() {
+    tracks.clear();
+    trackOf.clear();
+    keyTimes.clear();
+    inverseSpans.clear();
+    segments.clear();
+    duration = 0.0;
+}
+
+float ScreenAnimator::localTime(Track& track, double time, const Segment*& segment, int8_t& held) {
+    uint32_t first = track.firstKey;
+    uint32_t last = first + track.keyCount - 1;
+    double start = keyTimes[first];
+    double end = keyTimes[last];
+    if (track.loop && end > start) {
+        double period = end - start;
+        time = start + (time - start) - std::floor((time - start) / period) * period;
+    }
+    held = 0;
+    if (time <= start) {
+        held = track.loop ? 0 : -1;
+        segment = &segments[first];
+        return 0.0f;
+    }
+    if (time >= end) {
+        held = track.loop ? 0 : 1;
+        segment = &segments[last];
+        return 0.0f;
+    }
+
+    // Playing forward stays in or just past the previous segment
+    uint32_t k = first + track.cursor;
+    if (keyTimes[k] > time) {
+        k = static_cast<uint32_t>(std::upper_bound(keyTimes.begin() + first, keyTimes.begin() + last + 1, time) - keyTimes.begin()) - 1;
+    }
+    else {
+        while (keyTimes[k + 1] <= time) {
+            ++k;
+        }
+    }
+    track.cursor = k - first;
+    segment = &segments[k];
+    return std::min(1.0f, static_cast<float>((time - keyTimes[k]) * inverseSpans[k]));
+}
+
+void ScreenAnimator::evaluateBlock(size_t block, double time, ScreenStore& store, ScreenStore::Range& written) {
+    constexpr size_t BLOCK = Config::ANIMATION_BLOCK_TRACKS;
+    size_t begin = block * BLOCK;
+    size_t count = std::min(BLOCK, tracks.size() - begin);
+
+    // Gather each track's segment into lanes, then run the same Horner loop over all of them
+    float s[BLOCK];
+    float coefficients[DEGREE + 1][BLOCK];
+    int8_t held[BLOCK];
+    for (size_t l = 0; l < count; ++l) {
+        const Segment* segment;
+        s[l] = localTime(tracks[begin + l], time, segment, held[l]);
+        for (int i = 0; i <= DEGREE; ++i) {
+            coefficients[i][l] = segment->coefficients[i];
+        }
+    }
+    float values[BLOCK];
+    for (size_t l = 0; l < count; ++l) {
+        values[l] = coefficients[DEGREE][l];
+    }
+    for (int i = DEGREE - 1; i >= 0; --i) {
+        float node = nodes[i];
+        for (size_t l = 0; l < count; ++l) {
+            values[l] = values[l] * (s[l] - node) + coefficients[i][l];
+        }
+    }
+
+    written = { ScreenStore::NO_INDEX, 0 };
+    for (size_t l = 0; l < count; ++l) {
+        Track& track = tracks[begin + l];
+        // Held at the same end as last time: the store already has this value
+        if (held[l] != 0 && held[l] == track.held) {
+            continue;
+        }
+        uint32_t index = store.indexOf(track.screen);
+        if (index == ScreenStore::NO_INDEX) {
+            continue;
+        }
+        track.held = held[l];
+        store.setField(index, track.field, values[l]);
+        written.begin = std::min(written.begin, index);
+        written.end = std::max(written.end, index + 1);
+    }
+}
+
+ScreenStore::Range ScreenAnimator::apply(double time, ScreenStore& store) {
+    size_t blocks = (tracks.size() + Config::ANIMATION_BLOCK_TRACKS - 1) / Config::ANIMATION_BLOCK_TRACKS;
+    blockRanges.assign(blocks, { ScreenStore::NO_INDEX, 0 });
+    if (blocks == 1) {
+        evaluateBlock(0, time, store, blockRanges[0]);
+    }
+    else if (blocks > 1) {
+        // Tracks in different blocks may share a screen, but never a field of it, so the
+        // blocks write disjoint memory
+        if (!pool) {
+            pool = std::make_unique<ThreadPool>(Config::ANIMATION_THREADS);
+        }
+        pool->parallelFor(blocks, [&](size_t block, int) {
+            evaluateBlock(block, time, store, blockRanges[block]);
+        });
+    }
+
+    ScreenStore::Range range = { ScreenStore::NO_INDEX, 0 };
+    for (const ScreenStore::Range& written : blockRanges) {
+        range.begin = std::min(range.begin, written.begin);
+        range.end = std::max(range.end, written.end);
+    }
+    if (range.empty()) {
+        return { 0, 0 };
+    }
+    store.markDirty(range);
+    return range;
+}
+
+void ScreenAnimator::load(const std::string& path, const ScreenStore& store) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Could not open animation " + path);
+    }
+
+    std::map<std::pair<uint32_t, ScreenField>, std::vector<Keyframe>> keys;
+    std::set<std::pair<uint32_t, ScreenField>> looping;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+
+        std::istringstream words(line);
+        std::string first, fieldName;
+        uint32_t screen;
+        ScreenField field;
+        auto fail = [&](const std::string& message) {
+            return std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + message);
+        };
+        bool loop = line.compare(start, 4, "loop") == 0;
+        if (loop) {
+            words >> first;
+        }
+        if (!(words >> screen >> fieldName)) {
+            throw fail("expected \"screen field time value [easing [tangent]]\" or \"loop screen field\"");
+        }
+        if (screen >= store.size()) {
+            throw fail("no screen " + std::to_string(screen) + " in the scene");
+        }
+        if (!parseName(fieldName, FIELD_NAMES, field)) {
+            throw fail("unknown field " + fieldName);
+        }
+        if (loop) {
+            looping.insert({ screen, field });
+            continue;
+        }
+
+        Keyframe key;
+        std::string easingName;
+        if (!(words >> key.time >> key.value)) {
+            throw fail("expected \"screen field time value [easing [tangent]]\"");
+        }
+        if (words >> easingName && !parseName(easingName, EASING_NAMES, key.easing)) {
+            throw fail("unknown easing " + easingName);
+        }
+        words >> key.tangent;
+        keys[{ screen, field }].push_back(key);
+    }
+
+    clear();
+    for (auto& [target, trackKeys] : keys) {
+        bool loop = looping.count(target) > 0;
+        try {
+            setTrack(store.handleAt(target.first), target.second, std::move(trackKeys), loop);
+        }
+        catch (const std::invalid_argument& e) {
+            throw std::runtime_error(path + ": screen " + std::to_string(target.first) + " " +
+                FIELD_NAMES[static_cast<int>(target.second)] + ": " + e.what());
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#include "screen_grid.h"
+#include <algorithm>
+#include <cmath>
+
+ScreenGrid::ScreenGrid(int width, int height, int cellSize)
+    : cellSize(std::max(1, cellSize)),
+      columns(std::max(1, (width + this->cellSize - 1) / this->cellSize)),
+      rows(std::max(1, (height + this->cellSize - 1) / this->cellSize)),
+      cells(static_cast<size_t>(columns) * rows) {
+}
+
+void ScreenGrid::rebuild(const std::vector<Screen>& screens) {
+    for (auto& cell : cells) {
+        cell.clear();
+    }
+    ranges.clear();
+    for (uint32_t i = 0; i < screens.size(); ++i) {
+        insert(i, screens[i]);
+    }
+}
+
+void ScreenGrid::insert(uint32_t index, const Screen& screen) {
+    if (ranges.size() <= index) {
+        ranges.resize(index + 1, CellRange{ 0, 0, -1, -1 });
+    }
+    ranges[index] = cellRange(screen);
+    addToCells(index, ranges[index]);
+}
+
+void ScreenGrid::update(uint32_t index, const Screen& screen) {
+    CellRange range = cellRange(screen);
+    if (range == ranges[index]) {
+        return;
+    }
+    removeFromCells(index, ranges[index]);
+    ranges[index] = range;
+    addToCells(index, range);
+}
+
+void ScreenGrid::remove(uint32_t index, uint32_t movedFrom) {
+    removeFromCells(index, ranges[index]);
+    if (movedFrom < ranges.size()) {
+        renameInCells(movedFrom, index, ranges[movedFrom]);
+        ranges[index] = ranges[movedFrom];
+        ranges.resize(movedFrom);
+    }
+    else {
+        ranges.resize(index);
+    }
+}
+
+const std::vector<uint32_t>* ScreenGrid::candidatesAt(float x, float y) const {
+    int column = static_cast<int>(std::floor(x / cellSize));
+    int row = static_cast<int>(std::floor(y / cellSize));
+    if (column < 0 || row < 0 || column >= columns || row >= rows) {
+        return nullptr;
+    }
+    return &cells[static_cast<size_t>(row) * columns + column];
+}
+
+ScreenGrid::CellRange ScreenGrid::cellRange(const Screen& screen) const {
+    SDL_FPoint size = screen.getRotatedSize();
+    float minX = screen.getX() - size.x * 0.5f;
+    float minY = screen.getY() - size.y * 0.5f;
+    float maxX = screen.getX() + size.x * 0.5f;
+    float maxY = screen.getY() + size.y * 0.5f;
+    if (maxX < 0.0f || maxY < 0.0f || minX >= columns * cellSize || minY >= rows * cellSize) {
+        return { 0, 0, -1, -1 };
+    }
+    return {
+        std::max(0, static_cast<int>(std::floor(minX / cellSize))),
+        std::max(0, static_cast<int>(std::floor(minY / cellSize))),
+        std::min(columns - 1, static_cast<int>(std::floor(maxX / cellSize))),
+        std::min(rows - 1, static_cast<int>(std::floor(maxY / cellSize)))
+    };
+}
+
+void ScreenGrid::addToCells(uint32_t index, const CellRange& range) {
+    for (int row = range.y0; row <= range.y1; ++row) {
+        for (int column = range.x0; column <= range.x1; ++column) {
+            cells[static_cast<size_t>(row) * columns + column].push_back(index);
+        }
+    }
+}
+
+void ScreenGrid::removeFromCells(uint32_t index, const CellRange& range) {
+    for (int row = range.y0; row <= range.y1; ++row) {
+        for (int column = range.x0; column <= range.x1; ++column) {
+            auto& cell = cells[static_cast<size_t>(row) * columns + column];
+            auto it = std::find(cell.begin(), cell.end(), index);
+            if (it != cell.end()) {
+                *it = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+}
+
+void ScreenGrid::renameInCells(uint32_t from, uint32_t to, const CellRange& range) {
+    for (int row = range.y0; row <= range.y1; ++row) {
+        for (int column = range.x0; column <= range.x1; ++column) {
+            auto& cell = cells[static_cast<size_t>(row) * columns + column];
+            std::replace(cell.begin(), cell.end(), from, to);
+        }
+    }
+}
@@ -8,99 +8,140 @@
 #include "config.h"
 
 ScreenManager::ScreenManager(int width, int height)
-    : selectedScreen(nullptr), width(width), height(height) {
+    : width(width), height(height), revision(0),
+      grid(width, height, Config::HIT_GRID_CELL_SIZE), gridStale(false) {
     dragOffset = { 0, 0 };
 }
 
-Screen* ScreenManager::createScreen(SDL_FPoint pos) {
+ScreenHandle ScreenManager::createScreen(SDL_FPoint pos) {
     int initialWidth = static_cast<int>(width * Config::INITIAL_SCREEN_SIZE_RATIO);
     int initialHeight = static_cast<int>(height * Config::INITIAL_SCREEN_SIZE_RATIO);
 
-    screens.emplace_back(pos.x, pos.y, initialWidth, initialHeight, 0,
-        Config::DEFAULT_SCREEN_COLOR);
-    return &screens.back();
+    Screen screen(pos.x, pos.y, initialWidth, initialHeight, 0, Config::DEFAULT_SCREEN_COLOR);
+    ScreenHandle handle = store.add(screen);
+    grid.insert(store.indexOf(handle), screen);
+    revision++;
+    return handle;
 }
 
-Screen* ScreenManager::handleSelection(SDL_FPoint mousePos) {
-    selectedScreen = findScreenAtPosition(mousePos.x, mousePos.y);
-    if (selectedScreen) {
-        dragOffset = {
-            mousePos.x - selectedScreen->getX(),
-            mousePos.y - selectedScreen->getY()
-        };
+void ScreenManager::setScreens(const std::vector<Screen>& newScreens) {
+    store.assign(newScreens);
+    selected = ScreenHandle();
+    grid.rebuild(newScreens);
+    gridStale = false;
+    revision++;
+}
+
+void ScreenManager::applyAnimation(ScreenAnimator& animator, double time) {
+    if (animator.apply(time, store).empty()) {
+        return;
     }
-    return selectedScreen;
+    gridStale = true;
+    revision++;
 }
 
-Screen* ScreenManager::findScreenAtPosition(float x, float y) const {
-    std::vector<Screen*> candidates;
+void ScreenManager::deleteSelected() {
+    uint32_t index = store.indexOf(selected);
+    if (index == ScreenStore::NO_INDEX) {
+        return;
+    }
+    // The last screen fills the hole, so only it changes index
+    uint32_t movedFrom = store.remove(selected);
+    grid.remove(index, movedFrom);
+    selected = ScreenHandle();
+    revision++;
+}
 
-    for (auto it = screens.rbegin(); it != screens.rend(); ++it) {
-        const Screen& screen = *it;
+Screen ScreenManager::getSelectedScreen() const {
+    return store.get(store.indexOf(selected));
+}
 
-        if (pointInRotatedRect(x, y,
-            { screen.getX(), screen.getY() },
-            screen.getWidth(), screen.getHeight(),
-            screen.getRotation())) {
-            candidates.push_back(const_cast<Screen*>(&screen));
-        }
+void ScreenManager::updateSelected(const Screen& screen) {
+    uint32_t index = store.indexOf(selected);
+    if (index == ScreenStore::NO_INDEX) {
+        return;
     }
+    store.set(index, screen);
+    grid.update(index, screen);
+    revision++;
+}
 
-    return selectSmallestFromCandidates(candidates);
+ScreenHandle ScreenManager::handleSelection(SDL_FPoint mousePos) {
+    if (gridStale) {
+        grid.rebuild(store.toScreens());
+        gridStale = false;
+    }
+    uint32_t index = findScreenAtPosition(mousePos.x, mousePos.y);
+    if (index == ScreenStore::NO_INDEX) {
+        selected = ScreenHandle();
+        return selected;
+    }
+    selected = store.handleAt(index);
+    dragOffset = {
+        mousePos.x - store.xs()[index],
+        mousePos.y - store.ys()[index]
+    };
+    return selected;
 }
 
-Screen* ScreenManager::selectSmallestFromCandidates(const std::vector<Screen*>& candidates) const {
-    if (candidates.empty()) {
-        return nullptr;
+uint32_t ScreenManager::findScreenAtPosition(float x, float y) const {
+    const std::vector<uint32_t>* candidates = grid.candidatesAt(x, y);
+    if (!candidates) {
+        return ScreenStore::NO_INDEX;
     }
 
-    return *std::min_element(candidates.begin(), candidates.end(),
-        [this](Screen* a, Screen* b) {
-            int areaA = a->getWidth() * a->getHeight();
-            int areaB = b->getWidth() * b->getHeight();
-
-            if (areaA != areaB) {
-                return areaA < areaB;
-            }
-
-            auto distA = std::distance(screens.begin(),
-                std::find_if(screens.begin(), screens.end(),
-                    [a](const Screen& s) { return &s == a; }));
-            auto distB = std::distance(screens.begin(),
-                std::find_if(screens.begin(), screens.end(),
-                    [b](const Screen& s) { return &s == b; }));
-            return distB < distA;
-        });
+    // Smallest screen under the point wins; among equal areas the one drawn last
+    uint32_t best = ScreenStore::NO_INDEX;
+    float bestArea = 0.0f;
+    for (uint32_t index : *candidates) {
+        if (!store.contains(index, x, y)) {
+            continue;
+        }
+        float area = store.area(index);
+        if (best == ScreenStore::NO_INDEX || area < bestArea || (area == bestArea && index > best)) {
+            best = index;
+            bestArea = area;
+        }
+    }
+    return best;
 }
 
-void ScreenManager::handleDragging(SDL_FPoint mousePos) {
-    if (selectedScreen && (SDL_GetMouseState(nullptr, nullptr) & SDL_BUTTON_LMASK)) {
+void ScreenManager::handleDragging(SDL_FPoint mousePos, bool buttonHeld) {
+    if (hasSelection() && buttonHeld) {
         float newX = mousePos.x - dragOffset.x;
         float newY = mousePos.y - dragOffset.y;
 
-        selectedScreen->setX(newX);
-        selectedScreen->setY(newY);
+        Screen screen = getSelectedScreen();
+        if (newX != screen.getX() || newY != screen.getY()) {
+            screen.setX(newX);
+            screen.setY(newY);
+            updateSelected(screen);
+        }
     }
 }
 
 void ScreenManager::handleScaling(int scrollY) {
-    if (selectedScreen && scrollY) {
+    if (hasSelection() && scrollY) {
         float scaleFactor = (scrollY > 0) ? Config::SCALE_FACTOR_UP : Config::SCALE_FACTOR_DOWN;
 
-        int newWidth = static_cast<int>(selectedScreen->getWidth() * scaleFactor);
-        int newHeight = static_cast<int>(selectedScreen->getHeight() * scaleFactor);
+        Screen screen = getSelectedScreen();
+        int newWidth = static_cast<int>(screen.getWidth() * scaleFactor);
+        int newHeight = static_cast<int>(screen.getHeight() * scaleFactor);
 
         newWidth = std::max(10, std::min(newWidth, static_cast<int>(width * Config::MAX_SCREEN_RATIO)));
         newHeight = std::max(10, std::min(newHeight, static_cast<int>(height * Config::MAX_SCREEN_RATIO)));
 
-        selectedScreen->setWidth(newWidth);
-        selectedScreen->setHeight(newHeight);
+        screen.setWidth(newWidth);
+        screen.setHeight(newHeight);
+        updateSelected(screen);
     }
 }
 
 void ScreenManager::handleRotation(float direction) {
-    if (selectedScreen) {
-        selectedScreen->rotate(direction);
+    if (hasSelection()) {
+        Screen screen = getSelectedScreen();
+        screen.rotate(direction);
+        updateSelected(screen);
     }
 }
 
@@ -117,21 +158,6 @@ SDL_FPoint ScreenManager::rotatePoint(float cx, float cy, float x, float y, floa
     return { cx + xNew, cy + yNew };
 }
 
-bool ScreenManager::pointInRotatedRect(float px, float py, SDL_FPoint rectCenter, float width, float height, float angle) {
-    float angleRad = -angle * Config::PI / 180.0f;
-    float dx = px - rectCenter.x;
-    float dy = py - rectCenter.y;
-    
-    float cosTheta = std::cos(angleRad);
-    float sinTheta = std::sin(angleRad);
-    
-    float localX = dx * cosTheta - dy * sinTheta;
-    float localY = dx * sinTheta + dy * cosTheta;
-    
-    return (localX >= -width/2 && localX <= width/2 && 
-            localY >= -height/2 && localY <= height/2);
-}
-
 float ScreenManager::isLeft(SDL_FPoint p0, SDL_FPoint p1, SDL_FPoint point) {
     return (p1.x - p0.x) * (point.y - p0.y) - (point.x - p0.x) * (p1.y - p0.y);
 }
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "screen_store.h"
+#include <algorithm>
+#include <cmath>
+
+ScreenHandle ScreenStore::add(const Screen& screen) {
+    uint32_t index = static_cast<uint32_t>(size());
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        slot = static_cast<uint32_t>(slots.size());
+        slots.push_back({ 0, 0 });
+    }
+    slots[slot].index = index;
+    slotOf.push_back(slot);
+
+    x.push_back(0.0f);
+    y.push_back(0.0f);
+    width.push_back(0.0f);
+    height.push_back(0.0f);
+    rotation.push_back(0.0f);
+    cosRotation.push_back(1.0f);
+    sinRotation.push_back(0.0f);
+    color.push_back({ 0, 0, 0, 0 });
+    colorAnimation.push_back({});
+    set(index, screen);
+    return { slot, slots[slot].generation };
+}
+
+uint32_t ScreenStore::remove(ScreenHandle handle) {
+    uint32_t index = indexOf(handle);
+    if (index == NO_INDEX) {
+        return NO_INDEX;
+    }
+    // Bumping the generation invalidates every copy of the handle before the slot is reused
+    slots[handle.slot].generation++;
+    freeSlots.push_back(handle.slot);
+
+    uint32_t last = static_cast<uint32_t>(size() - 1);
+    uint32_t moved = NO_INDEX;
+    if (index != last) {
+        x[index] = x[last];
+        y[index] = y[last];
+        width[index] = width[last];
+        height[index] = height[last];
+        rotation[index] = rotation[last];
+        cosRotation[index] = cosRotation[last];
+        sinRotation[index] = sinRotation[last];
+        color[index] = color[last];
+        colorAnimation[index] = colorAnimation[last];
+        slotOf[index] = slotOf[last];
+        slots[slotOf[index]].index = index;
+        markDirty(index);
+        moved = last;
+    }
+    x.pop_back();
+    y.pop_back();
+    width.pop_back();
+    height.pop_back();
+    rotation.pop_back();
+    cosRotation.pop_back();
+    sinRotation.pop_back();
+    color.pop_back();
+    colorAnimation.pop_back();
+    slotOf.pop_back();
+    return moved;
+}
+
+void ScreenStore::assign(const std::vector<Screen>& screens) {
+    clear();
+    for (const Screen& screen : screens) {
+        add(screen);
+    }
+}
+
+void ScreenStore::clear() {
+    // Live slots are retired rather than dropped, so handles into the old scene stay stale
+    for (uint32_t slot : slotOf) {
+        slots[slot].generation++;
+        freeSlots.push_back(slot);
+    }
+    slotOf.clear();
+    x.clear();
+    y.clear();
+    width.clear();
+    height.clear();
+    rotation.clear();
+    cosRotation.clear();
+    sinRotation.clear();
+    color.clear();
+    colorAnimation.clear();
+    dirty = { 0, 0 };
+}
+
+uint32_t ScreenStore::indexOf(ScreenHandle handle) const {
+    if (handle.slot >= slots.size()) {
+        return NO_INDEX;
+    }
+    const Slot& slot = slots[handle.slot];
+    if (slot.generation != handle.generation || slot.index >= slotOf.size() || slotOf[slot.index] != handle.slot) {
+        return NO_INDEX;
+    }
+    return slot.index;
+}
+
+Screen ScreenStore::get(uint32_t index) const {
+    Screen screen(x[index], y[index], static_cast<int>(width[index]), static_cast<int>(height[index]),
+        rotation[index], color[index]);
+    screen.setColorAnimation(colorAnimation[index]);
+    return screen;
+}
+
+void ScreenStore::set(uint32_t index, const Screen& screen) {
+    x[index] = screen.getX();
+    y[index] = screen.getY();
+    width[index] = static_cast<float>(screen.getWidth());
+    height[index] = static_cast<float>(screen.getHeight());
+    if (rotation[index] != screen.getRotation()) {
+        float angleRad = screen.getRotation() * Config::PI / 180.0f;
+        rotation[index] = screen.getRotation();
+        cosRotation[index] = std::cos(angleRad);
+        sinRotation[index] = std::sin(angleRad);
+    }
+    color[index] = screen.getColor();
+    colorAnimation[index] = screen.getColorAnimation();
+    markDirty(index);
+}
+
+void ScreenStore::setField(uint32_t index, ScreenField field, float value) {
+    auto channel = [value]() {
+        return static_cast<Uint8>(std::lround(std::max(0.0f, std::min(255.0f, value))));
+    };
+    switch (field) {
+    case ScreenField::X: x[index] = value; break;
+    case ScreenField::Y: y[index] = value; break;
+    case ScreenField::Width: width[index] = std::max(0.0f, value); break;
+    case ScreenField::Height: height[index] = std::max(0.0f, value); break;
+    case ScreenField::Rotation:
+        if (rotation[index] != value) {
+            float angleRad = value * Config::PI / 180.0f;
+            rotation[index] = value;
+            cosRotation[index] = std::cos(angleRad);
+            sinRotation[index] = std::sin(angleRad);
+        }
+        break;
+    case ScreenField::Red: color[index].r = channel(); break;
+    case ScreenField::Green: color[index].g = channel(); break;
+    case ScreenField::Blue: color[index].b = channel(); break;
+    case ScreenField::Alpha: color[index].a = channel(); break;
+    }
+}
+
+void ScreenStore::markDirty(Range range) {
+    if (range.empty()) {
+        return;
+    }
+    markDirty(range.begin);
+    markDirty(range.end - 1);
+}
+
+std::vector<Screen> ScreenStore::toScreens() const {
+    std::vector<Screen> screens;
+    screens.reserve(size());
+    for (uint32_t i = 0; i < size(); ++i) {
+        screens.push_back(get(i));
+    }
+    return screens;
+}
+
+bool ScreenStore::contains(uint32_t index, float px, float py) const {
+    float dx = px - x[index];
+    float dy = py - y[index];
+    float localX = dx * cosRotation[index] + dy * sinRotation[index];
+    float localY = dy * cosRotation[index] - dx * sinRotation[index];
+    return std::abs(localX) <= width[index] * 0.5f && std::abs(localY) <= height[index] * 0.5f;
+}
+
+void ScreenStore::writeInstances(ScreenInstance* out, Range range) const {
+    for (uint32_t i = range.begin; i < range.end; ++i) {
+        ScreenInstance& instance = out[i];
+        instance = {};
+        instance.x = x[i];
+        instance.y = y[i];
+        instance.width = width[i];
+        instance.height = height[i];
+        instance.rotation = rotation[i];
+        instance.color = color[i];
+        instance.setColorAnimation(colorAnimation[i]);
+    }
+}
+
+ScreenStore::Range ScreenStore::getDirtyRange() const {
+    uint32_t count = static_cast<uint32_t>(size());
+    return { std::min(dirty.begin, count), std::min(dirty.end, count) };
+}
+
+void ScreenStore::markDirty(uint32_t index) {
+    if (dirty.empty()) {
+        dirty = { index, index + 1 };
+        return;
+    }
+    dirty.begin = std::min(dirty.begin, index);
+    dirty.end = std::max(dirty.end, index + 1);
+}
@@ -1,5 +1,99 @@
 #include "shader_manager.h"
+#include "config.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace {
+    constexpr uint32_t PROGRAM_CACHE_MAGIC = 0x42505246; // "FRPB"
+
+    bool programBinariesSupported() {
+        if (!Config::USE_SHADER_CACHE || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)) {
+            return false;
+        }
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    uint64_t fnv1a(uint64_t hash, const char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::string cachePath(const std::string& key) {
+        return (std::filesystem::path(Config::SHADER_CACHE_DIR) / (key + ".bin")).string();
+    }
+}
+
+ShaderProgram::ShaderProgram(const char* vertexSrc, const char* fragmentSrc)
+    : program(0), fromCache(false) {
+    std::string key;
+    if (programBinariesSupported()) {
+        key = ShaderManager::programCacheKey(vertexSrc, fragmentSrc);
+        program = ShaderManager::loadCachedProgram(key);
+        fromCache = program != 0;
+    }
+
+    if (!program) {
+        program = ShaderManager::createShaderProgram(vertexSrc, fragmentSrc);
+        if (!key.empty()) {
+            ShaderManager::storeCachedProgram(program, key);
+        }
+    }
+
+    reflect();
+}
+
+ShaderProgram::~ShaderProgram() {
+    glDeleteProgram(program);
+}
+
+void ShaderProgram::reflect() {
+    GLint count = 0;
+    GLint maxLength = 0;
+    GLint size;
+    GLenum type;
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; ++i) {
+        glGetActiveUniform(program, i, maxLength, nullptr, &size, &type, name.data());
+        std::string uniformName(name.data());
+        // Arrays are reported as "name[0]"; callers look them up by their plain name
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+            uniformName.resize(uniformName.size() - 3);
+        }
+        uniforms[uniformName] = glGetUniformLocation(program, name.data());
+    }
+
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    name.assign(std::max(maxLength, 1), '\0');
+    for (GLint i = 0; i < count; ++i) {
+        glGetActiveAttrib(program, i, maxLength, nullptr, &size, &type, name.data());
+        attributes[name.data()] = glGetAttribLocation(program, name.data());
+    }
+}
+
+GLint ShaderProgram::getUniformLocation(const std::string& name) const {
+    auto it = uniforms.find(name);
+    return it != uniforms.end() ? it->second : -1;
+}
+
+GLint ShaderProgram::getAttributeLocation(const std::string& name) const {
+    auto it = attributes.find(name);
+    return it != attributes.end() ? it->second : -1;
+}
 
 namespace ShaderManager {
     GLuint createShaderProgram(const char* vertexSrc, const char* fragmentSrc) {
@@ -27,6 +121,9 @@ namespace ShaderManager {
         GLuint program = glCreateProgram();
         glAttachShader(program, vertexShader);
         glAttachShader(program, fragmentShader);
+        if (programBinariesSupported()) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glLinkProgram(program);
         glGetProgramiv(program, GL_LINK_STATUS, &success);
         if (!success) {
@@ -39,4 +136,76 @@ namespace ShaderManager {
         glDeleteShader(fragmentShader);
         return program;
     }
-}
\ No newline at end of file
+
+    std::string programCacheKey(const char* vertexSrc, const char* fragmentSrc) {
+        // Binaries are only valid for the exact driver that produced them
+        std::string driver;
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+            const GLubyte* value = glGetString(name);
+            driver += value ? reinterpret_cast<const char*>(value) : "";
+            driver += '\n';
+        }
+
+        uint64_t hash = 14695981039346656037ull;
+        hash = fnv1a(hash, vertexSrc, std::char_traits<char>::length(vertexSrc) + 1);
+        hash = fnv1a(hash, fragmentSrc, std::char_traits<char>::length(fragmentSrc) + 1);
+        hash = fnv1a(hash, driver.data(), driver.size());
+
+        char key[17];
+        std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+        return key;
+    }
+
+    GLuint loadCachedProgram(const std::string& key) {
+        std::ifstream file(cachePath(key), std::ios::binary);
+        if (!file) {
+            return 0;
+        }
+
+        uint32_t magic = 0;
+        GLenum format = 0;
+        file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        file.read(reinterpret_cast<char*>(&format), sizeof(format));
+        if (!file || magic != PROGRAM_CACHE_MAGIC) {
+            return 0;
+        }
+        std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (binary.empty()) {
+            return 0;
+        }
+
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // Stale or rejected binary (driver update etc.), fall back to compiling
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    void storeCachedProgram(GLuint program, const std::string& key) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(Config::SHADER_CACHE_DIR, error);
+        std::ofstream file(cachePath(key), std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Could not write shader cache entry " << key << std::endl;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&PROGRAM_CACHE_MAGIC), sizeof(PROGRAM_CACHE_MAGIC));
+        file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        file.write(binary.data(), binary.size());
+    }
+}
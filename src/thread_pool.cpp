@@ -0,0 +1,120 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount)
+    : job(nullptr), generation(0), activeWorkers(0), stopping(false) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (int i = 1; i < threadCount; ++i) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t index, int worker)>& body) {
+    if (count == 0) {
+        return;
+    }
+
+    size_t workers = queues.size();
+    for (size_t w = 0; w < workers; ++w) {
+        std::lock_guard<std::mutex> lock(queues[w]->mutex);
+        for (size_t i = w * count / workers; i < (w + 1) * count / workers; ++i) {
+            queues[w]->items.push_back(i);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        error = nullptr;
+        activeWorkers = static_cast<int>(threads.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    while (runOne(0)) {
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return activeWorkers == 0; });
+    job = nullptr;
+    if (error) {
+        std::exception_ptr pending = error;
+        error = nullptr;
+        std::rethrow_exception(pending);
+    }
+}
+
+bool ThreadPool::runOne(int worker) {
+    size_t index = 0;
+    bool found = false;
+    {
+        WorkQueue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.items.empty()) {
+            index = own.items.front();
+            own.items.pop_front();
+            found = true;
+        }
+    }
+    for (size_t offset = 1; !found && offset < queues.size(); ++offset) {
+        WorkQueue& victim = *queues[(worker + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty()) {
+            index = victim.items.back();
+            victim.items.pop_back();
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    try {
+        (*job)(index, worker);
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+    return true;
+}
+
+void ThreadPool::workerLoop(int worker) {
+    size_t seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        while (runOne(worker)) {
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0) {
+            done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#include "video_recorder.h"
+#include "config.h"
+#include "shader_sources.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#endif
+
+VideoRecorder::VideoRecorder(const std::string& path, int frameWidth, int frameHeight, int fps, GLuint quadVao, bool dropWhenBehind)
+    : videoWidth(frameWidth & ~7), videoHeight(frameHeight & ~3), quadVao(quadVao), dropWhenBehind(dropWhenBehind),
+      output(nullptr), ownsOutput(false), stopping(false), failed(false), writtenFrames(0), droppedFrames(0) {
+    if (videoWidth <= 0 || videoHeight <= 0) {
+        throw std::runtime_error("Frame is too small to record");
+    }
+    frameBytes = static_cast<size_t>(videoWidth) * videoHeight * 3 / 2;
+
+    if (path == "-") {
+        output = stdout;
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#else
+        // A closed pipe should end the recording, not the process
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+    }
+    else {
+        output = std::fopen(path.c_str(), "wb");
+        if (!output) {
+            throw std::runtime_error("Could not open " + path + " for writing");
+        }
+        ownsOutput = true;
+    }
+    std::fprintf(output, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XYSCSS=420JPEG\n", videoWidth, videoHeight, fps);
+
+    yuvShader = std::make_unique<ShaderProgram>(ShaderSources::FULLSCREEN_VERTEX, ShaderSources::YUV420_FRAGMENT);
+    yuvFrameLoc = yuvShader->getUniformLocation("frame");
+    yuvVideoSizeLoc = yuvShader->getUniformLocation("videoSize");
+
+    int packedWidth = videoWidth / 4;
+    int packedHeight = videoHeight * 3 / 2;
+    glGenTextures(1, &packedTexture);
+    glBindTexture(GL_TEXTURE_2D, packedTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, packedWidth, packedHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, packedTexture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    readback = std::make_unique<FrameReadback>(packedWidth, packedHeight, Config::FRAME_READBACK_BUFFERS,
+        [this](const Uint8* pixels, long long) {
+            std::vector<Uint8> frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                size_t limit = static_cast<size_t>(Config::RECORDING_QUEUE);
+                if (queue.size() >= limit) {
+                    if (this->dropWhenBehind) {
+                        droppedFrames++;
+                        return;
+                    }
+                    spaceAvailable.wait(lock, [this, limit] { return queue.size() < limit; });
+                }
+                if (!freeBuffers.empty()) {
+                    frame = std::move(freeBuffers.back());
+                    freeBuffers.pop_back();
+                }
+            }
+            frame.resize(frameBytes);
+            std::memcpy(frame.data(), pixels, frameBytes);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(std::move(frame));
+            }
+            frameAvailable.notify_one();
+        });
+
+    writer = std::thread(&VideoRecorder::writerLoop, this);
+}
+
+VideoRecorder::~VideoRecorder() {
+    readback->flush();
+    readback.reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frameAvailable.notify_one();
+    writer.join();
+
+    if (ownsOutput) {
+        std::fclose(output);
+    }
+    else {
+        std::fflush(output);
+    }
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &packedTexture);
+}
+
+void VideoRecorder::submit(GLuint frameTexture) {
+    GLint previousFbo;
+    GLint viewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, videoWidth / 4, videoHeight * 3 / 2);
+    yuvShader->use();
+    glUniform1i(yuvFrameLoc, 0);
+    glUniform2i(yuvVideoSizeLoc, videoWidth, videoHeight);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, frameTexture);
+    glBindVertexArray(quadVao);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+
+    readback->submit(packedTexture, 0);
+}
+
+void VideoRecorder::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        frameAvailable.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+        std::vector<Uint8> frame = std::move(queue.front());
+        queue.pop_front();
+        bool skip = failed;
+        lock.unlock();
+        spaceAvailable.notify_one();
+
+        bool ok = true;
+        if (!skip) {
+            ok = std::fwrite("FRAME\n", 1, 6, output) == 6 && std::fwrite(frame.data(), 1, frame.size(), output) == frame.size();
+            if (!ok) {
+                std::cerr << "Recording stopped: the output stream could not be written" << std::endl;
+            }
+        }
+
+        lock.lock();
+        if (!ok) {
+            failed = true;
+        }
+        else if (!skip) {
+            writtenFrames++;
+        }
+        freeBuffers.push_back(std::move(frame));
+    }
+}
+
+size_t VideoRecorder::getWrittenFrames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writtenFrames;
+}
+
+size_t VideoRecorder::getDroppedFrames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return droppedFrames;
+}
@@ -0,0 +1,265 @@
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "math_utils.h"
+
+// Checks the batch color conversions against the scalar MathUtils functions. Every input goes
+// through the batch calls twice: in long spans, which run the widest lanes the build has, and
+// one color per call, which runs the scalar lanes that finish each span's tail.
+// rgbToHsv is checked over all 2^24 colors, hsvToRgb over random and edge-case inputs.
+// The interpolants' batch evaluate() is checked against their scalar evaluate() the same way.
+namespace {
+    // HSV components, hue measured around the circle
+    constexpr float HSV_TOLERANCE = 1e-6f;
+    // 8-bit steps. Both forms truncate value * 255, but the batch kernels reach the value through
+    // a different order of float operations, so a product near a whole step can truncate either way.
+    constexpr int RGB_TOLERANCE = 1;
+    // 8-bit steps outside the scalar function's step, for the float form which is not rounded
+    constexpr double FLOAT_RGB_TOLERANCE = 0.01;
+    // Relative to the interpolated value, or absolute below 1
+    constexpr double INTERPOLANT_TOLERANCE = 1e-12;
+    // Newton against Lagrange, and Chebyshev weights against the direct product
+    constexpr double FORMULA_TOLERANCE = 1e-9;
+    constexpr size_t SPAN = 4096;
+    constexpr size_t RANDOM_HSV_COLORS = 1 << 22;
+
+    struct Check {
+        const char* name;
+        double maxError = 0.0;
+        size_t failures = 0;
+
+        void record(double error, double tolerance) {
+            maxError = std::max(maxError, error);
+            if (error > tolerance) {
+                ++failures;
+            }
+        }
+
+        bool report(double tolerance) const {
+            std::printf("%-32s max error %-10g tolerance %-10g %s\n", name, maxError, tolerance, failures ? "FAIL" : "ok");
+            return failures == 0;
+        }
+    };
+
+    float hueDistance(float a, float b) {
+        float d = std::fabs(a - b);
+        return std::min(d, 1.0f - d);
+    }
+
+    // How far value * 255 lies outside the 8-bit step the scalar function truncated to
+    double stepError(float value, Uint8 truncated) {
+        double scaled = value * 255.0;
+        return std::max({ 0.0, truncated - scaled, scaled - (truncated + 1) });
+    }
+
+    // Runs convert over [0, count) either in SPAN-sized calls or one element per call
+    template <typename Convert>
+    void forEachSpan(size_t count, bool single, Convert convert) {
+        size_t step = single ? 1 : SPAN;
+        for (size_t i = 0; i < count; i += step) {
+            convert(i, std::min(step, count - i));
+        }
+    }
+
+    bool testRgbToHsv() {
+        const size_t count = size_t(1) << 24;
+        std::vector<SDL_Color> colors(count);
+        std::vector<float> r(count), g(count), b(count);
+        for (size_t i = 0; i < count; ++i) {
+            colors[i] = { static_cast<Uint8>(i >> 16), static_cast<Uint8>(i >> 8), static_cast<Uint8>(i), static_cast<Uint8>(i * 7) };
+            r[i] = colors[i].r / 255.0f;
+            g[i] = colors[i].g / 255.0f;
+            b[i] = colors[i].b / 255.0f;
+        }
+
+        std::vector<float> h(count), s(count), v(count);
+        bool passed = true;
+        for (bool single : { false, true }) {
+            for (bool packed : { false, true }) {
+                forEachSpan(count, single, [&](size_t i, size_t n) {
+                    if (packed) {
+                        MathUtils::rgbToHsv(&colors[i], &h[i], &s[i], &v[i], n);
+                    }
+                    else {
+                        MathUtils::rgbToHsv(&r[i], &g[i], &b[i], &h[i], &s[i], &v[i], n);
+                    }
+                });
+
+                Check check{ packed ? (single ? "rgbToHsv RGBA8, scalar lanes" : "rgbToHsv RGBA8, wide lanes")
+                                    : (single ? "rgbToHsv float, scalar lanes" : "rgbToHsv float, wide lanes") };
+                for (size_t i = 0; i < count; ++i) {
+                    float hue, saturation, value;
+                    MathUtils::rgbToHsv(colors[i].r, colors[i].g, colors[i].b, hue, saturation, value);
+                    bool inRange = h[i] >= 0.0f && h[i] < 1.0f;
+                    check.record(inRange ? hueDistance(h[i], hue) : 1.0, HSV_TOLERANCE);
+                    check.record(std::fabs(s[i] - saturation), HSV_TOLERANCE);
+                    check.record(std::fabs(v[i] - value), HSV_TOLERANCE);
+                }
+                passed = check.report(HSV_TOLERANCE) && passed;
+            }
+        }
+        return passed;
+    }
+
+    bool testHsvToRgb() {
+        std::vector<float> h, s, v;
+        // Sector boundaries, grey, black and white, hues at the ends of [0, 1), and whole hues too
+        // large for an int32 truncation, which must still wrap to 0
+        for (float hue : { 0.0f, 1.0f / 6.0f, 2.0f / 6.0f, 0.5f, 4.0f / 6.0f, 5.0f / 6.0f, std::nextafter(1.0f, 0.0f),
+                           16777216.0f, 2147483648.0f, -2147483648.0f, 3e9f, -3e9f, 1e30f, -1e30f }) {
+            for (float saturation : { 0.0f, 0.5f, 1.0f }) {
+                for (float value : { 0.0f, 0.5f, 1.0f }) {
+                    h.push_back(hue);
+                    s.push_back(saturation);
+                    v.push_back(value);
+                }
+            }
+        }
+        std::mt19937 random(20);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        while (h.size() < RANDOM_HSV_COLORS) {
+            h.push_back(std::min(unit(random), std::nextafter(1.0f, 0.0f)));
+            s.push_back(unit(random));
+            v.push_back(unit(random));
+        }
+        const size_t count = h.size();
+
+        std::vector<float> r(count), g(count), b(count);
+        std::vector<SDL_Color> colors(count);
+        bool passed = true;
+        for (bool single : { false, true }) {
+            for (bool packed : { false, true }) {
+                for (SDL_Color& color : colors) {
+                    color = { 0, 0, 0, 42 };
+                }
+                forEachSpan(count, single, [&](size_t i, size_t n) {
+                    if (packed) {
+                        MathUtils::hsvToRgb(&h[i], &s[i], &v[i], &colors[i], n);
+                    }
+                    else {
+                        MathUtils::hsvToRgb(&h[i], &s[i], &v[i], &r[i], &g[i], &b[i], n);
+                    }
+                });
+
+                Check check{ packed ? (single ? "hsvToRgb RGBA8, scalar lanes" : "hsvToRgb RGBA8, wide lanes")
+                                    : (single ? "hsvToRgb float, scalar lanes" : "hsvToRgb float, wide lanes") };
+                for (size_t i = 0; i < count; ++i) {
+                    Uint8 red, green, blue;
+                    MathUtils::hsvToRgb(h[i], s[i], v[i], red, green, blue);
+                    if (packed) {
+                        check.record(std::abs(colors[i].r - red), RGB_TOLERANCE);
+                        check.record(std::abs(colors[i].g - green), RGB_TOLERANCE);
+                        check.record(std::abs(colors[i].b - blue), RGB_TOLERANCE);
+                        // The packed form must leave alpha alone
+                        check.record(colors[i].a == 42 ? 0.0 : 255.0, RGB_TOLERANCE);
+                    }
+                    else {
+                        check.record(stepError(r[i], red), FLOAT_RGB_TOLERANCE);
+                        check.record(stepError(g[i], green), FLOAT_RGB_TOLERANCE);
+                        check.record(stepError(b[i], blue), FLOAT_RGB_TOLERANCE);
+                    }
+                }
+                passed = check.report(packed ? RGB_TOLERANCE : FLOAT_RGB_TOLERANCE) && passed;
+            }
+        }
+        return passed;
+    }
+
+    double relativeError(double value, double expected) {
+        return std::fabs(value - expected) / std::max(1.0, std::fabs(expected));
+    }
+
+    double sampleFunction(double x) {
+        return std::sin(3.0 * x) + 0.25 * x * x;
+    }
+
+    // Evaluates in one call and checks every point against the scalar evaluate()
+    template <typename Interpolant>
+    bool testBatchEvaluate(const char* name, const Interpolant& interpolant, const std::vector<double>& xs) {
+        std::vector<double> ys(xs.size());
+        interpolant.evaluate(xs.data(), ys.data(), xs.size());
+        Check check{ name };
+        for (size_t i = 0; i < xs.size(); ++i) {
+            check.record(relativeError(ys[i], interpolant.evaluate(xs[i])), INTERPOLANT_TOLERANCE);
+        }
+        return check.report(INTERPOLANT_TOLERANCE);
+    }
+
+    bool testInterpolants() {
+        std::vector<double> x = MathUtils::chebyshevNodes(16, -2.0, 3.0);
+        std::sort(x.begin(), x.end());
+        std::vector<double> y(x.size());
+        for (size_t i = 0; i < x.size(); ++i) {
+            y[i] = sampleFunction(x[i]);
+        }
+
+        // An ascending sweep past both ends, then every node in whole lane blocks so the
+        // barycentric form takes its node-hit fallback, then random points out of order for
+        // the spline's search. The odd count leaves a tail for the scalar loop.
+        std::vector<double> xs;
+        for (int i = 0; i <= 1000; ++i) {
+            xs.push_back(-2.5 + 6.0 * i / 1000);
+        }
+        while (xs.size() % 4 != 0) {
+            xs.push_back(3.5);
+        }
+        xs.insert(xs.end(), x.begin(), x.end());
+        std::mt19937 random(21);
+        std::uniform_real_distribution<double> domain(-2.5, 3.5);
+        for (int i = 0; i < 1001; ++i) {
+            xs.push_back(domain(random));
+        }
+
+        bool passed = testBatchEvaluate("NewtonPolynomial batch", MathUtils::NewtonPolynomial(x, y), xs);
+        passed = testBatchEvaluate("BarycentricInterpolant batch", MathUtils::BarycentricInterpolant(x, y), xs) && passed;
+        passed = testBatchEvaluate("CubicSpline batch", MathUtils::CubicSpline(x, y), xs) && passed;
+
+        // Both build the same polynomial through equispaced nodes
+        std::vector<double> ex, ey;
+        for (int i = 0; i < 8; ++i) {
+            ex.push_back(-1.0 + 0.5 * i);
+            ey.push_back(sampleFunction(ex.back()));
+        }
+        Check newton{ "newton vs lagrange" };
+        for (int i = 0; i <= 200; ++i) {
+            double xi = -1.5 + 5.0 * i / 200;
+            newton.record(relativeError(MathUtils::newtonInterpolate(ex, ey, xi), MathUtils::lagrangeInterpolate(ex, ey, xi)), FORMULA_TOLERANCE);
+        }
+        passed = newton.report(FORMULA_TOLERANCE) && passed;
+
+        // The closed form may differ from 1 / prod(x_i - x_j) by a factor common to all weights
+        Check weights{ "chebyshevWeights vs product" };
+        for (auto [n, a, b] : { std::tuple{ 1, -1.0, 1.0 }, std::tuple{ 2, -1.0, 1.0 }, std::tuple{ 12, -1.0, 1.0 }, std::tuple{ 12, 2.0, 7.0 } }) {
+            std::vector<double> nodes = MathUtils::chebyshevNodes(n, a, b);
+            std::vector<double> closed = MathUtils::chebyshevWeights(nodes);
+            double factor = 0.0;
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                double direct = 1.0;
+                for (size_t j = 0; j < nodes.size(); ++j) {
+                    if (i != j) {
+                        direct *= nodes[i] - nodes[j];
+                    }
+                }
+                direct = 1.0 / direct;
+                if (i == 0) {
+                    factor = closed[0] / direct;
+                }
+                weights.record(relativeError(closed[i], factor * direct), FORMULA_TOLERANCE);
+            }
+        }
+        passed = weights.report(FORMULA_TOLERANCE) && passed;
+        return passed;
+    }
+}
+
+int main() {
+    bool passed = testRgbToHsv();
+    passed = testHsvToRgb() && passed;
+    passed = testInterpolants() && passed;
+    return passed ? 0 : 1;
+}